@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace hal::stm32f1 {
+/**
+ * @brief Result of a single benchmark
+ *
+ */
+struct benchmark_result
+{
+  /// Name of the code path measured, e.g. "uart::driver_read"
+  std::string_view name;
+  /// Number of times the operation was executed
+  std::uint64_t iterations;
+  /// Average wall time per operation in nanoseconds
+  double ns_per_op;
+  /// Bytes moved per operation, 0 if the operation is not about throughput
+  std::uint64_t bytes_per_op = 0;
+};
+
+/// Collection of results that each benchmark appends to
+using benchmark_results = std::vector<benchmark_result>;
+
+/**
+ * @brief Prevent the compiler from optimizing away a value
+ *
+ * @param p_value - value that must be considered "used"
+ */
+template<typename T>
+inline void do_not_optimize(T const& p_value)
+{
+  asm volatile("" : : "r,m"(p_value) : "memory");
+}
+
+/**
+ * @brief Measure the average time of an operation
+ *
+ * @param p_results - results list to append the measurement to
+ * @param p_name - name of the operation
+ * @param p_iterations - number of times to call the operation
+ * @param p_operation - callable that performs one operation per call
+ */
+template<typename Operation>
+void measure(benchmark_results& p_results,
+             std::string_view p_name,
+             std::uint64_t p_iterations,
+             Operation&& p_operation)
+{
+  // Warm up caches and branch predictors before taking a measurement
+  for (std::uint64_t i = 0; i < p_iterations / 10; i++) {
+    p_operation();
+  }
+
+  auto const start = std::chrono::steady_clock::now();
+  for (std::uint64_t i = 0; i < p_iterations; i++) {
+    p_operation();
+  }
+  auto const end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::nano> const elapsed = end - start;
+
+  p_results.push_back({
+    .name = p_name,
+    .iterations = p_iterations,
+    .ns_per_op = elapsed.count() / static_cast<double>(p_iterations),
+  });
+}
+
+/**
+ * @brief Measure the throughput of an operation that moves a fixed number of
+ * bytes
+ *
+ * @param p_results - results list to append the measurement to
+ * @param p_name - name of the operation
+ * @param p_iterations - number of times to call the operation
+ * @param p_bytes - bytes moved by each call
+ * @param p_operation - callable that performs one operation per call
+ */
+template<typename Operation>
+void measure_throughput(benchmark_results& p_results,
+                        std::string_view p_name,
+                        std::uint64_t p_iterations,
+                        std::uint64_t p_bytes,
+                        Operation&& p_operation)
+{
+  measure(p_results, p_name, p_iterations, p_operation);
+  p_results.back().bytes_per_op = p_bytes;
+}
+
+/**
+ * @brief Emulate a hardware handshake on a simulated register
+ *
+ * Some drivers wait on a status bit that hardware sets in response to a
+ * control bit written by software (e.g. CAN INRQ -> INAK). Plain memory
+ * cannot do that, so while this object is alive a background thread mirrors
+ * the request bit into the acknowledge bit.
+ *
+ * Only keep this object alive during driver construction/configuration, never
+ * while timing a hot path.
+ */
+class simulated_handshake
+{
+public:
+  /**
+   * @param p_request - register holding the request bit
+   * @param p_request_bit - bit position of the request bit
+   * @param p_acknowledge - register holding the acknowledge bit
+   * @param p_acknowledge_bit - bit position of the acknowledge bit
+   */
+  simulated_handshake(std::uint32_t volatile& p_request,
+                      std::uint32_t p_request_bit,
+                      std::uint32_t volatile& p_acknowledge,
+                      std::uint32_t p_acknowledge_bit)
+    : m_thread([&p_request,
+                &p_acknowledge,
+                p_request_bit,
+                p_acknowledge_bit,
+                this]() {
+      while (m_running.load(std::memory_order_relaxed)) {
+        std::uint32_t const request = (p_request >> p_request_bit) & 1U;
+        std::uint32_t const acknowledge = p_acknowledge;
+        p_acknowledge = (acknowledge & ~(1U << p_acknowledge_bit)) |
+                        (request << p_acknowledge_bit);
+      }
+    })
+  {
+  }
+
+  simulated_handshake(simulated_handshake const&) = delete;
+  simulated_handshake& operator=(simulated_handshake const&) = delete;
+
+  ~simulated_handshake()
+  {
+    m_running.store(false, std::memory_order_relaxed);
+    m_thread.join();
+  }
+
+private:
+  std::atomic<bool> m_running{ true };
+  std::thread m_thread;
+};
+}  // namespace hal::stm32f1
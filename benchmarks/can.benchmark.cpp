@@ -0,0 +1,117 @@
+#include <libhal-stm32f1/can.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include <libhal-util/bit.hpp>
+#include <libhal/error.hpp>
+
+#include "benchmark.hpp"
+#include "can.hpp"
+#include "can_reg.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+
+namespace hal::stm32f1 {
+void can_benchmark(benchmark_results& p_results)
+{
+  constexpr std::uint64_t iterations = 1'000'000;
+
+  stub_out_registers rcc_stub(&rcc);
+  stub_out_registers afio_stub(&alternative_function_io);
+  stub_out_registers gpio_a_stub(&gpio_a_reg);
+  stub_out_registers can_stub(&can1_reg);
+
+  std::optional<can> driver;
+  {
+    // INRQ (MCR bit 0) must be acknowledged via INAK (MSR bit 0)
+    simulated_handshake initialization(can1_reg->MCR, 0, can1_reg->MSR, 0);
+    driver.emplace(can::settings{ .baud_rate = 100'000 });
+  }
+
+  // Transmit mailbox 0 is always empty, hardware would clear this bit once
+  // the mailbox is loaded.
+  can1_reg->TSR = bit_value(0U)
+                    .set<transmit_status::transmit_mailbox0_empty>()
+                    .to<std::uint32_t>();
+
+  hal::can::message_t const message{
+    .id = 0x123,
+    .payload = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 },
+    .length = 8,
+    .is_remote_request = false,
+  };
+
+  measure(p_results, "can::driver_send", iterations, [&driver, &message]() {
+    driver->send(message);
+  });
+
+  measure(p_results, "can::try_send", iterations, [&driver, &message]() {
+    do_not_optimize(driver->try_send(message));
+  });
+
+  // A burst of three frames, one per transmit mailbox
+  can1_reg->TSR = bit_value(0U)
+                    .set<transmit_status::transmit_mailbox0_empty>()
+                    .set<transmit_status::transmit_mailbox1_empty>()
+                    .set<transmit_status::transmit_mailbox2_empty>()
+                    .to<std::uint32_t>();
+  std::array<hal::can::message_t, 3> const burst{ message, message, message };
+
+  measure(p_results, "can::driver_send (3 frame burst)", iterations,
+          [&driver, &burst]() {
+            for (auto const& frame : burst) {
+              driver->send(frame);
+            }
+          });
+
+  measure(p_results, "can::try_send (3 frame burst)", iterations,
+          [&driver, &burst]() {
+            for (auto const& frame : burst) {
+              do_not_optimize(driver->try_send(frame));
+            }
+          });
+
+  measure(p_results, "can::send_batch (3 frame burst)", iterations,
+          [&driver, &burst]() {
+            do_not_optimize(driver->send_batch(burst));
+          });
+
+  // All transmit mailboxes are full, the back pressure path
+  can1_reg->TSR = 0;
+
+  measure(p_results, "can::driver_send (mailboxes full)", iterations / 10,
+          [&driver, &message]() {
+            try {
+              driver->send(message);
+            } catch (hal::resource_unavailable_try_again const&) {
+              // Expected, all mailboxes are full
+            }
+          });
+
+  measure(p_results, "can::try_send (mailboxes full)", iterations,
+          [&driver, &message]() {
+            do_not_optimize(driver->try_send(message));
+          });
+
+  // FIFO 0 always has a message pending
+  can1_reg->RF0R =
+    bit_value(0U).insert<fifo_status::messages_pending>(1U).to<std::uint32_t>();
+  can1_reg->fifo_mailbox[0].RIR =
+    bit_value(0U)
+      .insert<mailbox_identifier::standard_identifier>(0x123U)
+      .to<std::uint32_t>();
+  can1_reg->fifo_mailbox[0].RDTR =
+    bit_value(0U)
+      .insert<frame_length_and_info::data_length_code>(8U)
+      .to<std::uint32_t>();
+  can1_reg->fifo_mailbox[0].RDLR = 0x4433'2211;
+  can1_reg->fifo_mailbox[0].RDHR = 0x8877'6655;
+
+  measure(p_results, "can::read_receive_mailbox", iterations, []() {
+    do_not_optimize(read_receive_mailbox());
+  });
+}
+}  // namespace hal::stm32f1
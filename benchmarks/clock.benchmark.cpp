@@ -0,0 +1,53 @@
+#include <libhal-stm32f1/clock.hpp>
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "benchmark.hpp"
+#include "flash_reg.hpp"
+#include "helper.hpp"
+#include "rcc_reg.hpp"
+
+namespace hal::stm32f1 {
+void clock_benchmark(benchmark_results& p_results)
+{
+  constexpr std::uint64_t iterations = 1'000'000;
+
+  constexpr std::array peripherals{
+    peripheral::cpu,    peripheral::usart1, peripheral::usart2,
+    peripheral::can1,   peripheral::timer2, peripheral::timer1,
+    peripheral::adc1,   peripheral::dma1,
+  };
+  std::size_t index = 0;
+
+  measure(p_results, "frequency", iterations, [&index, &peripherals]() {
+    do_not_optimize(frequency(peripherals[index]));
+    index = (index + 1) % peripherals.size();
+  });
+
+  stub_out_registers rcc_stub(&rcc);
+  stub_out_registers flash_stub(&flash);
+
+  // Ready flags are held high and the system clock status reports the PLL so
+  // that each busy wait within configure_clocks() completes immediately.
+  rcc->cr = bit_value(0U)
+              .set<clock_control::pll_ready>()
+              .set<clock_control::external_osc_ready>()
+              .to<std::uint32_t>();
+  rcc->cfgr = bit_value(0U)
+                .insert<clock_configuration::system_clock_status>(
+                  value(system_clock_select::pll))
+                .to<std::uint32_t>();
+  rcc->bdcr = bit_value(0U)
+                .set<rtc_register::low_speed_osc_ready>()
+                .to<std::uint32_t>();
+
+  measure(p_results, "configure_clocks", iterations / 10, []() {
+    maximum_speed_using_internal_oscillator();
+  });
+}
+}  // namespace hal::stm32f1
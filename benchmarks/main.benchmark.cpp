@@ -0,0 +1,55 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+
+#include "benchmark.hpp"
+
+namespace hal::stm32f1 {
+extern void output_pin_benchmark(benchmark_results& p_results);
+extern void uart_benchmark(benchmark_results& p_results);
+extern void can_benchmark(benchmark_results& p_results);
+// NOTE: Must run last as it changes the clock rates used by other drivers.
+extern void clock_benchmark(benchmark_results& p_results);
+}  // namespace hal::stm32f1
+
+int main()
+{
+  hal::stm32f1::benchmark_results results;
+
+  hal::stm32f1::output_pin_benchmark(results);
+  hal::stm32f1::uart_benchmark(results);
+  hal::stm32f1::can_benchmark(results);
+  hal::stm32f1::clock_benchmark(results);
+
+  std::printf("{\n  \"benchmarks\": [\n");
+  for (std::size_t i = 0; i < results.size(); i++) {
+    auto const& result = results[i];
+    std::printf("    { \"name\": \"%.*s\", \"iterations\": %llu, "
+                "\"ns_per_op\": %.3f",
+                static_cast<int>(result.name.size()),
+                result.name.data(),
+                static_cast<unsigned long long>(result.iterations),
+                result.ns_per_op);
+    if (result.bytes_per_op != 0) {
+      std::printf(", \"bytes_per_us\": %.1f",
+                  static_cast<double>(result.bytes_per_op) * 1'000.0 /
+                    result.ns_per_op);
+    }
+    std::printf(" }%s\n", (i + 1 < results.size()) ? "," : "");
+  }
+  std::printf("  ]\n}\n");
+
+  return 0;
+}
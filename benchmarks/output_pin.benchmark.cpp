@@ -0,0 +1,36 @@
+#include <libhal-stm32f1/output_pin.hpp>
+
+#include <cstdint>
+
+#include "benchmark.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+
+namespace hal::stm32f1 {
+void output_pin_benchmark(benchmark_results& p_results)
+{
+  constexpr std::uint64_t iterations = 1'000'000;
+
+  stub_out_registers rcc_stub(&rcc);
+  stub_out_registers afio_stub(&alternative_function_io);
+  stub_out_registers gpio_a_stub(&gpio_a_reg);
+  stub_out_registers gpio_c_stub(&gpio_c_reg);
+
+  output_pin pin('C', 13);
+  bool level = false;
+
+  measure(p_results, "output_pin::driver_level(bool)", iterations, [&]() {
+    level = not level;
+    pin.level(level);
+  });
+
+  measure(p_results, "output_pin::driver_level()", iterations, [&pin]() {
+    do_not_optimize(pin.level());
+  });
+
+  measure(p_results, "configure_pin", iterations, []() {
+    configure_pin({ .port = 'A', .pin = 5 }, push_pull_gpio_output);
+  });
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,142 @@
+#include <libhal-stm32f1/uart.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <libhal-stm32f1/uart_framing.hpp>
+
+#include <libhal-util/bit.hpp>
+
+#include "benchmark.hpp"
+#include "dma.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+void uart_benchmark(benchmark_results& p_results)
+{
+  constexpr std::uint64_t iterations = 100'000;
+  constexpr std::size_t chunk_size = 64;
+
+  stub_out_registers rcc_stub(&rcc);
+  stub_out_registers afio_stub(&alternative_function_io);
+  stub_out_registers gpio_a_stub(&gpio_a_reg);
+  stub_out_registers dma_stub(&dma::dma1);
+  stub_out_registers usart_stub(&usart1);
+
+  constexpr std::uint32_t buffer_size = 256;
+
+  // Transmit data register is always empty
+  usart1->status =
+    bit_value(0U).set<status_reg::transit_empty>().to<std::uint32_t>();
+
+  // USART1 RX uses DMA1 channel 5
+  auto& channel = dma::dma1->channel[5 - 1];
+
+  // The driver claims the DMA channels of USART1, so it is destroyed before
+  // the ring drivers below take them over.
+  {
+    std::array<hal::byte, buffer_size> receive_buffer{};
+    uart driver(hal::runtime{}, 1, receive_buffer);
+
+    std::array<hal::byte, chunk_size> data{};
+    data.fill(0xAA);
+
+    measure(p_results, "uart::driver_write", iterations, [&driver, &data]() {
+      do_not_optimize(driver.write(data));
+    });
+
+    measure(p_results, "uart::driver_read", iterations, [&driver, &channel]() {
+      // Simulate the DMA having received another chunk of bytes
+      std::uint32_t const remaining = channel.transfer_amount;
+      if (remaining <= chunk_size) {
+        channel.transfer_amount = remaining + buffer_size - chunk_size;
+      } else {
+        channel.transfer_amount = remaining - chunk_size;
+      }
+
+      std::array<hal::byte, chunk_size> read_buffer{};
+      do_not_optimize(driver.read(read_buffer));
+    });
+
+    // One COBS frame with a 64 byte payload per operation, received through a
+    // staging copy with read() or decoded in place with read_frame()
+    std::array<hal::byte, chunk_size> payload{};
+    for (std::size_t i = 0; i < payload.size(); i++) {
+      payload[i] = static_cast<hal::byte>(i % 50);
+    }
+    std::array<hal::byte, max_cobs_frame_size(chunk_size)> encoded{};
+    auto const frame = cobs_encode(payload, encoded);
+    std::array<hal::byte, chunk_size + 2> decoded{};
+    cobs_decoder decoder(decoded);
+
+    // Simulate the DMA having received the frame
+    auto const receive_frame = [&channel, &receive_buffer, frame]() {
+      auto const cursor = buffer_size - channel.transfer_amount;
+      for (std::size_t i = 0; i < frame.size(); i++) {
+        receive_buffer[(cursor + i) % buffer_size] = frame[i];
+      }
+      auto const next = (cursor + frame.size()) % buffer_size;
+      channel.transfer_amount = static_cast<std::uint32_t>(buffer_size - next);
+    };
+
+    // The staging buffer lives outside of the loop, so only the copy is
+    // measured and not zeroing it on each operation
+    std::array<hal::byte, buffer_size> staging{};
+    driver.flush();
+    measure(p_results,
+            "uart::read + cobs_decoder",
+            iterations,
+            [&driver, &decoder, &receive_frame, &staging]() {
+              receive_frame();
+              auto const received = driver.read(staging).data;
+              (void)decoder.decode(received);
+              do_not_optimize(decoder.take_frame());
+            });
+
+    driver.flush();
+    measure(p_results,
+            "read_frame(uart, cobs_decoder)",
+            iterations,
+            [&driver, &decoder, &receive_frame]() {
+              receive_frame();
+              do_not_optimize(read_frame(driver, decoder));
+            });
+  }
+
+  // Bulk reads out of rings of a power of two size, indexed with a mask, and
+  // of other sizes. Each ring driver takes over USART1 in turn. The DMA is
+  // simulated to have received exactly one read's worth of bytes, which wrap
+  // around the end of the ring most of the time.
+  auto const read_throughput = [&p_results, &channel](
+                                 std::string_view p_name,
+                                 std::span<hal::byte> p_ring,
+                                 std::size_t p_chunk) {
+    uart ring_driver(hal::runtime{}, 1, p_ring);
+    std::array<hal::byte, 512> read_buffer{};
+    auto const chunk = std::span(read_buffer).first(p_chunk);
+    auto const size = p_ring.size();
+    channel.transfer_amount = static_cast<std::uint32_t>(size);
+    measure_throughput(p_results, p_name, iterations, p_chunk, [&]() {
+      auto const cursor = size - channel.transfer_amount;
+      auto const next = (cursor + p_chunk) % size;
+      channel.transfer_amount = static_cast<std::uint32_t>(size - next);
+      do_not_optimize(ring_driver.read(chunk));
+    });
+  };
+
+  std::array<hal::byte, 4096> ring_storage{};
+  auto const ring = std::span(ring_storage);
+  read_throughput("uart::driver_read 64 B (256 B ring)", ring.first(256), 64);
+  read_throughput("uart::driver_read 64 B (250 B ring)", ring.first(250), 64);
+  read_throughput(
+    "uart::driver_read 512 B (4096 B ring)", ring.first(4096), 512);
+  read_throughput(
+    "uart::driver_read 512 B (4000 B ring)", ring.first(4000), 512);
+}
+}  // namespace hal::stm32f1
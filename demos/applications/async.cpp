@@ -0,0 +1,74 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <string_view>
+
+#include <libhal-stm32f1/async.hpp>
+#include <libhal-stm32f1/can.hpp>
+#include <libhal-stm32f1/input_pin.hpp>
+#include <libhal-stm32f1/output_pin.hpp>
+#include <libhal-stm32f1/pin.hpp>
+#include <libhal-stm32f1/uart.hpp>
+#include <libhal/initializers.hpp>
+#include <libhal/units.hpp>
+
+namespace {
+std::span<hal::byte const> as_bytes(std::string_view p_text)
+{
+  return { reinterpret_cast<hal::byte const*>(p_text.data()), p_text.size() };
+}
+
+hal::stm32f1::task<> toggle_on_press(hal::stm32f1::input_pin& p_button,
+                                     hal::stm32f1::output_pin& p_led,
+                                     hal::stm32f1::uart& p_console)
+{
+  bool led_state = false;
+  while (true) {
+    co_await p_button.edge(hal::stm32f1::edge_trigger::falling);
+    led_state = not led_state;
+    p_led.level(led_state);
+    co_await p_console.write_async(as_bytes("button pressed\n"));
+  }
+}
+
+hal::stm32f1::task<> echo_can(hal::stm32f1::can& p_can)
+{
+  while (true) {
+    auto message = co_await p_can.receive();
+    message.id++;
+    while (p_can.try_send(message) != std::errc{}) {
+      continue;
+    }
+  }
+}
+}  // namespace
+
+void application()
+{
+  hal::stm32f1::release_jtag_pins();
+  hal::stm32f1::async_executor executor(hal::buffer<512>);
+  hal::stm32f1::output_pin led('C', 13);
+  hal::stm32f1::input_pin button('B', 4);
+  hal::stm32f1::uart console(hal::port<1>, hal::buffer<64>);
+  hal::stm32f1::can can({ .baud_rate = 100'000 });
+
+  can.bus_on();
+
+  executor.spawn(toggle_on_press(button, led, console));
+  executor.spawn(echo_can(can));
+
+  // Sleeps until the button or can interrupts resume a coroutine
+  executor.run();
+}
@@ -76,14 +76,19 @@ void application()
     hal::print(uart1, "Sending Can message: ");
     print_message(uart1, message);
 
-    try {
-      can.send(message);
-    } catch (hal::operation_not_permitted const& p_error) {
-      // hal::operation_not_permitted indicates that the device is in
-      // "bus-off" mode. Use `bus_on()` to turn the bus back on.
-      can.bus_on();
-    } catch (hal::resource_unavailable_try_again const& p_error) {
-      hal::print(uart1, "CAN outgoing mailbox is full, trying again...\n");
+    // try_send() reports back pressure as a status code rather than an
+    // exception. Use `can.send()` for the exception based API.
+    switch (can.try_send(message)) {
+      case std::errc::operation_not_permitted:
+        // The device is in "bus-off" mode. Use `bus_on()` to turn the bus
+        // back on.
+        can.bus_on();
+        break;
+      case std::errc::resource_unavailable_try_again:
+        hal::print(uart1, "CAN outgoing mailbox is full, trying again...\n");
+        break;
+      default:
+        break;
     }
 
     hal::delay(steady_clock, 1000ms);
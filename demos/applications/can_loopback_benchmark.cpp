@@ -0,0 +1,257 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include <libhal-armcortex/dwt_counter.hpp>
+#include <libhal-stm32f1/can.hpp>
+#include <libhal-stm32f1/can_statistics.hpp>
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/pin.hpp>
+#include <libhal-stm32f1/uart.hpp>
+#include <libhal-util/serial.hpp>
+#include <libhal/initializers.hpp>
+#include <libhal/units.hpp>
+
+// Measures the sustained frame rate of the can driver in self test mode at
+// each supported bit rate. Frames are sent from the transmit ready interrupt
+// and counted in the receive handler, so every frame takes the full
+// send -> bus -> receive interrupt -> handler path without the bus or another
+// node limiting the rate.
+//
+// The interrupt cost per frame is derived from how much slower an idle loop
+// runs in the foreground while frames are flowing compared to while the bus
+// is quiet. Results are printed as one JSON object per line:
+//
+//    {"mode":"loopback","baud":500000,"frames":N,"frames_per_s":N,
+//     "bus_limit_per_s":N,"isr_cycles_per_frame":N,
+//     "latency_cycles":[min,max]}
+//
+// Latency is measured from loading a frame into a mailbox to its receive
+// handler, which includes waiting behind the frames in the other mailboxes.
+namespace {
+constexpr std::array<hal::hertz, 8> baud_rates{
+  1'000'000.0f,
+  500'000.0f,
+  250'000.0f,
+  125'000.0f,
+  100'000.0f,
+  50'000.0f,
+  20'000.0f,
+  10'000.0f,
+};
+
+hal::can::message_t const frame{
+  .id = 0x123,
+  .payload = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 },
+  .length = 8,
+  .is_remote_request = false,
+};
+
+struct measurement
+{
+  std::uint32_t frames = 0;
+  std::uint64_t idle_loops = 0;
+  std::uint32_t min_latency = UINT32_MAX;
+  std::uint32_t max_latency = 0;
+};
+
+// Shared with the interrupt handlers
+bool volatile traffic_enabled = false;
+measurement volatile* active = nullptr;
+
+/// Frame carrying the low 32 bits of the cycle counter at the time it was
+/// loaded into a mailbox
+hal::can::message_t stamped_frame(hal::steady_clock& p_clock)
+{
+  auto message = frame;
+  auto const now = static_cast<std::uint32_t>(p_clock.uptime());
+  for (std::size_t i = 0; i < 4; i++) {
+    message.payload[i] = static_cast<hal::byte>(now >> (i * 8U));
+  }
+  return message;
+}
+
+std::uint32_t stamp_of(hal::can::message_t const& p_message)
+{
+  std::uint32_t stamp = 0;
+  for (std::size_t i = 0; i < 4; i++) {
+    stamp |= static_cast<std::uint32_t>(p_message.payload[i]) << (i * 8U);
+  }
+  return stamp;
+}
+
+/// Spin in the foreground for a fixed time, counting loop iterations
+std::uint64_t idle_for(hal::steady_clock& p_clock, std::uint64_t p_ticks)
+{
+  std::uint64_t loops = 0;
+  auto const deadline = p_clock.uptime() + p_ticks;
+  while (p_clock.uptime() < deadline) {
+    loops++;
+  }
+  return loops;
+}
+
+measurement run(hal::stm32f1::can& p_can,
+                hal::steady_clock& p_clock,
+                std::uint64_t p_window)
+{
+  measurement result{};
+  active = &result;
+  traffic_enabled = true;
+
+  // Fill every mailbox once, the transmit ready interrupt keeps them full
+  auto const first = stamped_frame(p_clock);
+  std::array<hal::can::message_t, 3> const burst{ first, first, first };
+  (void)p_can.send_batch(burst);
+
+  result.idle_loops = idle_for(p_clock, p_window);
+
+  traffic_enabled = false;
+  // Let the frames still in the mailboxes drain
+  idle_for(p_clock, p_window / 10);
+  active = nullptr;
+
+  return result;
+}
+
+void print_result(hal::serial& p_console,
+                  char const* p_mode,
+                  hal::hertz p_baud_rate,
+                  measurement const& p_result,
+                  std::uint64_t p_baseline_loops,
+                  std::uint64_t p_window,
+                  hal::hertz p_cpu_frequency)
+{
+  auto const window_ms = (p_window * 1000U) /
+                         static_cast<std::uint64_t>(p_cpu_frequency);
+  auto const frames_per_s = (p_result.frames * 1000ULL) / window_ms;
+  auto const bus_limit_per_s =
+    static_cast<std::uint32_t>(p_baud_rate) /
+    hal::stm32f1::can_statistics::nominal_bits(frame);
+
+  // Cycles taken from the foreground loop, split across the frames
+  std::uint64_t isr_cycles_per_frame = 0;
+  if (p_result.frames != 0 && p_baseline_loops > p_result.idle_loops) {
+    auto const stolen_loops = p_baseline_loops - p_result.idle_loops;
+    isr_cycles_per_frame =
+      (stolen_loops * p_window) / (p_baseline_loops * p_result.frames);
+  }
+
+  auto const min_latency =
+    p_result.frames != 0 ? p_result.min_latency : std::uint32_t{ 0 };
+
+  hal::print<192>(p_console,
+                  "{\"mode\":\"%s\",\"baud\":%lu,\"frames\":%lu,"
+                  "\"frames_per_s\":%lu,\"bus_limit_per_s\":%lu,"
+                  "\"isr_cycles_per_frame\":%lu,"
+                  "\"latency_cycles\":[%lu,%lu]}\n",
+                  p_mode,
+                  static_cast<unsigned long>(p_baud_rate),
+                  static_cast<unsigned long>(p_result.frames),
+                  static_cast<unsigned long>(frames_per_s),
+                  static_cast<unsigned long>(bus_limit_per_s),
+                  static_cast<unsigned long>(isr_cycles_per_frame),
+                  static_cast<unsigned long>(min_latency),
+                  static_cast<unsigned long>(p_result.max_latency));
+}
+}  // namespace
+
+void application()
+{
+  hal::stm32f1::maximum_speed_using_internal_oscillator();
+
+  auto const cpu_frequency =
+    hal::stm32f1::frequency(hal::stm32f1::peripheral::cpu);
+  hal::cortex_m::dwt_counter clock(cpu_frequency);
+
+  hal::stm32f1::uart console(hal::port<1>, hal::buffer<256>);
+  hal::stm32f1::can can({ .baud_rate = 100'000 },
+                        hal::stm32f1::can_pins::pb9_pb8);
+
+  can.on_receive([&clock](hal::can::message_t const& p_message) {
+    auto* result = active;
+    if (result == nullptr) {
+      return;
+    }
+    // Unsigned arithmetic handles the wrap of the low 32 bits
+    auto const latency =
+      static_cast<std::uint32_t>(clock.uptime()) - stamp_of(p_message);
+    result->frames = result->frames + 1;
+    if (latency < result->min_latency) {
+      result->min_latency = latency;
+    }
+    if (latency > result->max_latency) {
+      result->max_latency = latency;
+    }
+  });
+
+  // Refill every free mailbox, not just one. Completions can coalesce into a
+  // single interrupt, so a single send per interrupt lets the mailboxes run
+  // dry and caps the rate below what the driver can sustain.
+  can.on_transmit_ready([&can, &clock]() {
+    if (not traffic_enabled) {
+      return;
+    }
+    while (can.try_send(stamped_frame(clock)) == std::errc{}) {
+      continue;
+    }
+  });
+
+  // 250ms measurement window per run
+  auto const window = static_cast<std::uint64_t>(cpu_frequency) / 4U;
+
+  // Foreground speed with no interrupts firing
+  auto const baseline_loops = idle_for(clock, window);
+
+  hal::print<64>(console,
+                 "{\"cpu_hz\":%lu,\"baseline_loops\":%lu}\n",
+                 static_cast<unsigned long>(cpu_frequency),
+                 static_cast<unsigned long>(baseline_loops));
+
+  for (bool const silent : { false, true }) {
+    for (auto const baud_rate : baud_rates) {
+      char const* mode = silent ? "silent_loopback" : "loopback";
+      if (can.try_configure({ .baud_rate = baud_rate }) != std::errc{}) {
+        hal::print<96>(console,
+                       "{\"mode\":\"%s\",\"baud\":%lu,\"error\":"
+                       "\"unsupported\"}\n",
+                       mode,
+                       static_cast<unsigned long>(baud_rate));
+        continue;
+      }
+      can.enable_self_test(true);
+      can.enable_silent_mode(silent);
+
+      auto const result = run(can, clock, window);
+      print_result(console,
+                   mode,
+                   baud_rate,
+                   result,
+                   baseline_loops,
+                   window,
+                   cpu_frequency);
+    }
+  }
+
+  hal::print(console, "{\"done\":true}\n");
+
+  while (true) {
+    continue;
+  }
+}
@@ -0,0 +1,77 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+
+#include <libhal-stm32f1/can.hpp>
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/output_pin.hpp>
+#include <libhal-stm32f1/uart.hpp>
+#include <libhal/error.hpp>
+#include <libhal/initializers.hpp>
+
+// Exercises each driver operation a fixed number of times, then halts on a
+// breakpoint. Meant to be run with tools/cortex_m3_benchmark.py, which counts
+// the instructions and memory accesses of each operation.
+void application()
+{
+  constexpr int iterations = 100;
+
+  hal::stm32f1::output_pin led('C', 13);
+  hal::stm32f1::uart uart1(hal::port<1>, hal::buffer<128>);
+  hal::stm32f1::can can({ .baud_rate = 100'000 });
+  can.enable_self_test(true);
+
+  for (int i = 0; i < iterations; i++) {
+    led.level(i % 2 == 0);
+  }
+
+  std::array<hal::byte, 16> data{};
+  for (int i = 0; i < iterations; i++) {
+    uart1.write(data);
+    uart1.read(data);
+  }
+
+  hal::can::message_t const message{
+    .id = 0x123,
+    .payload = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 },
+    .length = 8,
+    .is_remote_request = false,
+  };
+  for (int i = 0; i < iterations; i++) {
+    try {
+      can.send(message);
+    } catch (hal::resource_unavailable_try_again const&) {
+      // All mailboxes are full on real hardware, skip this frame
+    }
+  }
+
+  hal::hertz clock_rate = 0.0f;
+  for (int i = 0; i < iterations; i++) {
+    clock_rate += hal::stm32f1::frequency(hal::stm32f1::peripheral::usart1);
+  }
+  // Keep the frequency() calls from being optimized away
+  asm volatile("" : : "r"(clock_rate));
+
+  hal::stm32f1::maximum_speed_using_internal_oscillator();
+
+  // Signal to the emulator (or an attached debugger) that the benchmark has
+  // completed.
+  asm volatile("bkpt");
+
+  while (true) {
+    continue;
+  }
+}
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <span>
+#include <utility>
+
+#include <libhal/error.hpp>
+#include <libhal/initializers.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::stm32f1 {
+/**
+ * @brief Completion of an operation signaled from an interrupt
+ *
+ * A single coroutine may wait on an event at a time. Interrupt service
+ * routines call `signal()` and the `async_executor` resumes the waiting
+ * coroutine from thread context, never from within the ISR itself.
+ *
+ * Events are expected to have static storage duration, like the ones owned by
+ * the stm32f1 drivers.
+ */
+class async_event
+{
+public:
+  struct awaiter
+  {
+    bool await_ready() const noexcept
+    {
+      return m_event->is_signaled();
+    }
+
+    void await_suspend(std::coroutine_handle<> p_waiter) noexcept
+    {
+      m_event->m_waiter = p_waiter;
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+    async_event* m_event;
+  };
+
+  async_event();
+  async_event(async_event const&) = delete;
+  async_event& operator=(async_event const&) = delete;
+  async_event(async_event&&) = delete;
+  async_event& operator=(async_event&&) = delete;
+  ~async_event();
+
+  /**
+   * @brief Clear a previous completion
+   *
+   * Must be called before starting the operation this event tracks.
+   */
+  void reset()
+  {
+    m_signaled.store(false, std::memory_order_release);
+  }
+
+  /**
+   * @brief Mark the operation as complete
+   *
+   * Safe to call from an interrupt service routine.
+   */
+  void signal()
+  {
+    m_signaled.store(true, std::memory_order_release);
+  }
+
+  /**
+   * @return true - the operation has completed
+   * @return false - the operation is still in progress
+   */
+  [[nodiscard]] bool is_signaled() const
+  {
+    return m_signaled.load(std::memory_order_acquire);
+  }
+
+  awaiter operator co_await() noexcept
+  {
+    return { this };
+  }
+
+private:
+  friend class async_executor;
+
+  std::coroutine_handle<> m_waiter{};
+  std::atomic<bool> m_signaled = false;
+  async_event* m_next = nullptr;
+};
+
+/**
+ * @brief Awaitable that waits on an event then returns the result of the
+ * operation
+ *
+ * @tparam T - type of the result
+ */
+template<typename T>
+class async_result
+{
+public:
+  /**
+   * @param p_event - event signaled once the result is available
+   * @param p_result - location the driver writes the result to
+   */
+  async_result(async_event& p_event, T const& p_result)
+    : m_awaiter{ &p_event }
+    , m_result(&p_result)
+  {
+  }
+
+  bool await_ready() const noexcept
+  {
+    return m_awaiter.await_ready();
+  }
+
+  void await_suspend(std::coroutine_handle<> p_waiter) noexcept
+  {
+    m_awaiter.await_suspend(p_waiter);
+  }
+
+  T await_resume() const noexcept
+  {
+    return *m_result;
+  }
+
+private:
+  async_event::awaiter m_awaiter;
+  T const* m_result;
+};
+
+template<typename T = void>
+class task;
+
+/**
+ * @brief Cooperative scheduler for coroutines driven by interrupts
+ *
+ * Coroutine frames are allocated from a statically allocated buffer, so no
+ * heap is needed. Only a single executor may exist at a time.
+ */
+class async_executor
+{
+public:
+  /// Maximum number of top level tasks that can be spawned at once
+  static constexpr std::size_t max_tasks = 8;
+
+  /**
+   * @brief Construct a new executor object
+   *
+   * @param p_frame_memory - size of the statically allocated buffer used for
+   * coroutine frames
+   */
+  async_executor(hal::buffer_param auto p_frame_memory)
+    : async_executor(hal::create_unique_static_buffer(p_frame_memory))
+  {
+  }
+
+  /**
+   * @brief Construct a new executor object using runtime values
+   *
+   * @param p_frame_memory - external buffer used for coroutine frames
+   */
+  async_executor(hal::runtime, std::span<hal::byte> p_frame_memory)
+    : async_executor(p_frame_memory)
+  {
+  }
+
+  async_executor(async_executor const&) = delete;
+  async_executor& operator=(async_executor const&) = delete;
+  async_executor(async_executor&&) = delete;
+  async_executor& operator=(async_executor&&) = delete;
+  ~async_executor();
+
+  /**
+   * @brief Start a task and run it until its first suspension point
+   *
+   * @param p_task - task to take ownership of
+   * @return true - the task was started
+   * @return false - the task could not be allocated or the maximum number of
+   * tasks are already running.
+   */
+  bool spawn(task<void>&& p_task);
+
+  /**
+   * @brief Resume every coroutine whose event has been signaled
+   *
+   * @return std::size_t - number of tasks that have not yet completed
+   */
+  std::size_t poll();
+
+  /**
+   * @brief Run until every spawned task has completed
+   *
+   * The core sleeps (WFI) while no event has been signaled.
+   */
+  void run();
+
+  /**
+   * @brief Allocate memory for a coroutine frame
+   *
+   * @param p_size - size of the frame
+   * @return void* - the frame memory or nullptr if there is no executor or
+   * not enough memory is available.
+   */
+  static void* allocate(std::size_t p_size) noexcept;
+
+  /**
+   * @brief Release the memory of a coroutine frame
+   *
+   * @param p_frame - frame returned by `allocate()`
+   */
+  static void deallocate(void* p_frame) noexcept;
+
+private:
+  explicit async_executor(std::span<hal::byte> p_frame_memory);
+
+  bool has_ready_events();
+
+  std::span<hal::byte> m_frame_memory;
+  std::array<std::coroutine_handle<>, max_tasks> m_tasks{};
+};
+
+namespace detail {
+/// Members shared between every task promise type
+struct task_promise_base
+{
+  struct final_awaiter
+  {
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> p_self) noexcept
+    {
+      // Transfer control back to the awaiting coroutine. Top level tasks
+      // return control to the executor.
+      return p_self.promise().m_continuation;
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+  };
+
+  static void* operator new(std::size_t p_size) noexcept
+  {
+    return async_executor::allocate(p_size);
+  }
+
+  static void operator delete(void* p_frame) noexcept
+  {
+    async_executor::deallocate(p_frame);
+  }
+
+  std::suspend_always initial_suspend() const noexcept
+  {
+    return {};
+  }
+
+  final_awaiter final_suspend() const noexcept
+  {
+    return {};
+  }
+
+  void unhandled_exception() noexcept
+  {
+    m_exception = std::current_exception();
+  }
+
+  void rethrow_if_exception() const
+  {
+    if (m_exception) {
+      std::rethrow_exception(m_exception);
+    }
+  }
+
+  std::coroutine_handle<> m_continuation = std::noop_coroutine();
+  std::exception_ptr m_exception{};
+};
+
+template<typename T>
+struct task_promise : task_promise_base
+{
+  task<T> get_return_object() noexcept;
+  static task<T> get_return_object_on_allocation_failure() noexcept;
+
+  void return_value(T p_value)
+  {
+    m_value.emplace(std::move(p_value));
+  }
+
+  T result()
+  {
+    rethrow_if_exception();
+    return std::move(*m_value);
+  }
+
+  std::optional<T> m_value{};
+};
+
+template<>
+struct task_promise<void> : task_promise_base
+{
+  task<void> get_return_object() noexcept;
+  static task<void> get_return_object_on_allocation_failure() noexcept;
+
+  void return_void() noexcept
+  {
+  }
+
+  void result()
+  {
+    rethrow_if_exception();
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Lazily started coroutine
+ *
+ * Tasks may `co_await` other tasks, `async_event`s and the asynchronous APIs
+ * of the stm32f1 drivers. Top level tasks are started with
+ * `async_executor::spawn()`.
+ *
+ * @tparam T - type returned by the coroutine
+ */
+template<typename T>
+class task
+{
+public:
+  using promise_type = detail::task_promise<T>;
+
+  task() = default;
+
+  explicit task(std::coroutine_handle<promise_type> p_handle)
+    : m_handle(p_handle)
+  {
+  }
+
+  task(task const&) = delete;
+  task& operator=(task const&) = delete;
+
+  task(task&& p_other) noexcept
+    : m_handle(std::exchange(p_other.m_handle, {}))
+  {
+  }
+
+  task& operator=(task&& p_other) noexcept
+  {
+    if (this != &p_other) {
+      destroy();
+      m_handle = std::exchange(p_other.m_handle, {});
+    }
+    return *this;
+  }
+
+  ~task()
+  {
+    destroy();
+  }
+
+  /**
+   * @return true - the coroutine frame was allocated
+   * @return false - the coroutine frame could not be allocated
+   */
+  [[nodiscard]] bool valid() const
+  {
+    return static_cast<bool>(m_handle);
+  }
+
+  /**
+   * @brief Run the task and resume the awaiting coroutine with its result
+   *
+   * @throws hal::resource_unavailable_try_again - the task is not valid, its
+   * coroutine frame could not be allocated
+   */
+  auto operator co_await() && noexcept
+  {
+    struct awaiter
+    {
+      bool await_ready() const noexcept
+      {
+        return not m_handle || m_handle.done();
+      }
+
+      std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> p_continuation) noexcept
+      {
+        m_handle.promise().m_continuation = p_continuation;
+        return m_handle;
+      }
+
+      T await_resume()
+      {
+        // The frame of the task could not be allocated
+        if (not m_handle) {
+          hal::safe_throw(hal::resource_unavailable_try_again(nullptr));
+        }
+        return m_handle.promise().result();
+      }
+
+      std::coroutine_handle<promise_type> m_handle;
+    };
+
+    return awaiter{ m_handle };
+  }
+
+  /**
+   * @brief Release ownership of the coroutine frame
+   *
+   * @return std::coroutine_handle<promise_type> - handle to the frame
+   */
+  std::coroutine_handle<promise_type> release()
+  {
+    return std::exchange(m_handle, {});
+  }
+
+private:
+  void destroy()
+  {
+    if (m_handle) {
+      m_handle.destroy();
+      m_handle = {};
+    }
+  }
+
+  std::coroutine_handle<promise_type> m_handle{};
+};
+
+namespace detail {
+template<typename T>
+task<T> task_promise<T>::get_return_object() noexcept
+{
+  return task<T>{ std::coroutine_handle<task_promise<T>>::from_promise(*this) };
+}
+
+template<typename T>
+task<T> task_promise<T>::get_return_object_on_allocation_failure() noexcept
+{
+  return task<T>{};
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+  return task<void>{
+    std::coroutine_handle<task_promise<void>>::from_promise(*this)
+  };
+}
+
+inline task<void>
+task_promise<void>::get_return_object_on_allocation_failure() noexcept
+{
+  return task<void>{};
+}
+}  // namespace detail
+}  // namespace hal::stm32f1
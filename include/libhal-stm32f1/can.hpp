@@ -1,16 +1,371 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+
 #include <libhal/can.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
 
+#include "async.hpp"
+#include "can_bit_timing.hpp"
+#include "can_statistics.hpp"
 #include "pin.hpp"
 
 namespace hal::stm32f1 {
 class can final : public hal::can
 {
 public:
+  /// Number of filter banks available to can1
+  static constexpr std::uint8_t filter_bank_count = 14;
+
+  /// Bit rates tried by `autobaud()` by default, most common first
+  static constexpr std::array<hal::hertz, 8> common_baud_rates{
+    500'000.0f,
+    250'000.0f,
+    125'000.0f,
+    1'000'000.0f,
+    100'000.0f,
+    50'000.0f,
+    20'000.0f,
+    10'000.0f,
+  };
+
+  /// Identifies the filter that accepted a message
+  struct filter_route
+  {
+    /// Receive FIFO the message was stored in (0 or 1)
+    std::uint8_t fifo = 0;
+    /// Filter match index (FMI) reported by the hardware. Numbered per FIFO.
+    std::uint8_t filter_match_index = 0;
+  };
+
+  /// A received message along with the filter that accepted it
+  struct filtered_message_t
+  {
+    message_t message{};
+    filter_route route{};
+  };
+
+  /// Handler for messages along with the filter that accepted them
+  using filtered_handler = void(filtered_message_t const& p_message);
+
+  /// Acceptance filter using a 32-bit identifier and mask
+  struct filter_t
+  {
+    /// Identifier to accept
+    id_t id = 0;
+    /// Bits of the identifier that must match, a set bit must match
+    id_t mask = 0;
+    /// Match extended (29-bit) identifiers instead of standard identifiers
+    bool extended = false;
+    /// Receive FIFO messages accepted by this filter are stored in (0 or 1)
+    std::uint8_t fifo = 0;
+  };
+
   can(can::settings const& p_settings = {},
       can_pins p_pins = can_pins::pa11_pa12);
   void enable_self_test(bool p_enable);
+
+  /**
+   * @brief Listen to the bus without ever driving it
+   *
+   * In silent mode the controller receives frames but sends neither
+   * acknowledgements nor error frames. Transmitted frames are only seen by
+   * the controller itself. Combined with `enable_self_test()` this runs the
+   * loopback without disturbing the bus. Reset by `configure()`.
+   *
+   * @param p_enable - true to enter silent mode
+   */
+  void enable_silent_mode(bool p_enable);
+
+  /**
+   * @brief Non-throwing version of `configure()`
+   *
+   * @param p_settings - settings to apply to the can driver
+   * @return std::errc - std::errc{} on success,
+   * std::errc::operation_not_supported if the baud rate cannot be achieved
+   * with the current can peripheral clock rate.
+   */
+  [[nodiscard]] std::errc try_configure(settings const& p_settings);
+
+  /**
+   * @brief Apply a bit timing computed ahead of time
+   *
+   * Writes the timing as is, without searching for divider values, so a
+   * timing from `solve_can_bit_timing()` costs no computation at runtime.
+   *
+   * @param p_timing - bit timing for the current can peripheral clock
+   * @return std::errc - std::errc{} on success, std::errc::invalid_argument if
+   * the timing was computed for a different can peripheral clock rate.
+   */
+  [[nodiscard]] std::errc try_configure_bit_timing(
+    can_bit_timing const& p_timing);
+
+  /**
+   * @brief Non-throwing version of `send()`
+   *
+   * A full set of transmit mailboxes is a normal condition under load. This
+   * API reports it as a status code so that callers can handle back pressure
+   * with a branch rather than unwinding an exception.
+   *
+   * @param p_message - can message to send
+   * @return std::errc - std::errc{} if the message was loaded into a mailbox,
+   * std::errc::resource_unavailable_try_again if all mailboxes are full and
+   * std::errc::operation_not_permitted if the device is in "bus-off".
+   */
+  [[nodiscard]] std::errc try_send(message_t const& p_message);
+
+  /**
+   * @brief Load as many messages as there are free transmit mailboxes
+   *
+   * The mailbox status is read once and the bus-off check is made once for
+   * the whole batch, which makes sending a burst of frames cheaper than
+   * calling `send()` for each one. Messages are loaded in order, thus the
+   * returned count is the length of the prefix of `p_messages` that was
+   * queued. The remaining messages can be passed again once mailboxes are
+   * freed, see `on_transmit_ready()`.
+   *
+   * @param p_messages - messages to send
+   * @return std::size_t - number of messages loaded into mailboxes, 0 if the
+   * mailboxes are full or the device is in "bus-off".
+   */
+  [[nodiscard]] std::size_t send_batch(std::span<message_t const> p_messages);
+
+  /**
+   * @brief Wait for the next message to be received
+   *
+   * The awaiting coroutine is resumed once a message arrives in either
+   * receive FIFO. While a coroutine is waiting, the message is delivered to
+   * it instead of the handler registered with `on_receive()`.
+   *
+   * Usage:
+   *
+   *    auto message = co_await can.receive();
+   *
+   * @return async_result<message_t> - awaitable that returns the message
+   */
+  async_result<message_t> receive();
+
+  /// Handler called once a transmit mailbox has been freed
+  using transmit_ready_handler = void();
+
+  /// Outcome of a transmit request, reported per mailbox
+  struct transmit_result
+  {
+    /// Frame that was requested, read back from the mailbox
+    message_t message{};
+    /// Transmit mailbox the frame was loaded into (0 to 2)
+    std::uint8_t mailbox = 0;
+    /// The frame was sent successfully (TXOK)
+    bool transmitted = false;
+    /// The last attempt lost arbitration (ALST)
+    bool arbitration_lost = false;
+    /// The last attempt failed with a bus error (TERR)
+    bool error = false;
+    /// Bit time counter value at the start of frame bit, only valid while
+    /// timestamps are enabled, see `enable_timestamps()`.
+    std::uint16_t timestamp = 0;
+  };
+
+  /// Handler called once a transmit request has completed
+  using transmit_complete_handler = void(transmit_result const& p_result);
+
+  /**
+   * @brief Set a handler to be called each time a transmit mailbox finishes
+   *
+   * The handler runs within the can1 transmit interrupt, which makes it a
+   * good place to load the next frame of a multi frame transfer without
+   * polling for a free mailbox.
+   *
+   * @param p_handler - handler to call when a mailbox becomes empty
+   */
+  void on_transmit_ready(hal::callback<transmit_ready_handler> p_handler);
+
+  /**
+   * @brief Set a handler to be called each time a transmit request completes
+   *
+   * A request completes once the frame has been sent or, with automatic
+   * retransmission disabled, after the first failed attempt. The handler
+   * runs within the can1 transmit interrupt before the mailbox is released.
+   *
+   * @param p_handler - handler to call with the outcome of each request
+   */
+  void on_transmit_complete(hal::callback<transmit_complete_handler> p_handler);
+
+  /**
+   * @brief Capture the bit time counter in the mailboxes at start of frame
+   *
+   * Enables time triggered communication mode, which stamps transmitted and
+   * received frames with a free running 16-bit counter incremented every
+   * bit time.
+   *
+   * @param p_enable - true to capture timestamps
+   */
+  void enable_timestamps(bool p_enable);
+
+  /**
+   * @brief Retry frames that lost arbitration or hit an error
+   *
+   * Enabled by default. When disabled each request makes a single attempt
+   * and its outcome is reported by `on_transmit_complete()`, leaving the
+   * retry policy to the application.
+   *
+   * @param p_enable - true to let the controller retry until sent
+   */
+  void enable_automatic_retransmission(bool p_enable);
+
+  /**
+   * @brief Transmit mailboxes in the order they were loaded
+   *
+   * By default the mailbox with the highest priority identifier is sent
+   * first, and among equal identifiers the lowest mailbox number. Protocols
+   * that split a message across frames with the same identifier need the
+   * frames to leave in request order.
+   *
+   * @param p_enable - true to send in request order, false to send by
+   * identifier priority.
+   */
+  void enable_transmit_fifo(bool p_enable);
+
+  /**
+   * @brief Record every received and successfully transmitted frame
+   *
+   * Frames are recorded from the can receive and transmit interrupts, which
+   * are enabled by this call. The statistics use the configured baud rate and
+   * follow later calls to `configure()`.
+   *
+   * @param p_statistics - statistics to update, must outlive the driver or be
+   * detached before it is destroyed.
+   */
+  void attach_statistics(can_statistics& p_statistics);
+
+  /**
+   * @brief Stop recording frames into the attached statistics
+   */
+  void detach_statistics();
+
+  /**
+   * @brief Configure and enable a hardware acceptance filter bank
+   *
+   * By default filter bank 0 accepts every message into FIFO 0. Configuring
+   * any filter bank replaces that default, so only messages matching a
+   * configured filter are received afterwards.
+   *
+   * @param p_bank - filter bank to configure, 0 to `filter_bank_count` - 1
+   * @param p_filter - identifier, mask and FIFO of the filter
+   * @return std::errc - std::errc{} on success,
+   * std::errc::argument_out_of_domain if the bank or FIFO does not exist.
+   */
+  [[nodiscard]] std::errc try_configure_filter(std::uint8_t p_bank,
+                                               filter_t const& p_filter);
+
+  /**
+   * @brief Disable a hardware acceptance filter bank
+   *
+   * @param p_bank - filter bank to disable
+   */
+  void disable_filter(std::uint8_t p_bank);
+
+  /**
+   * @brief The route the hardware reports for messages accepted by a bank
+   *
+   * Filter match indexes are numbered per FIFO across every bank assigned to
+   * that FIFO, whether the bank is enabled or not, thus the index depends on
+   * the configuration of the other banks.
+   *
+   * @param p_bank - filter bank
+   * @return filter_route - FIFO and filter match index of the bank
+   */
+  [[nodiscard]] filter_route route(std::uint8_t p_bank);
+
+  /**
+   * @brief Set a handler that receives messages along with their route
+   *
+   * Called from the receive interrupt in addition to the `on_receive()`
+   * handler. Pair with `can_dispatch_table` to route each filter to its own
+   * handler.
+   *
+   * @param p_handler - handler for received messages
+   */
+  void on_filtered_receive(hal::callback<filtered_handler> p_handler);
+
+  /**
+   * @brief Detect the bit rate of the bus and configure the driver for it
+   *
+   * Each candidate is tried in silent mode, so the controller never drives
+   * the bus while the rate is wrong. A candidate is accepted as soon as a
+   * frame is received without error and rejected as soon as the last error
+   * code reports a stuff, form or CRC error. A candidate that sees no traffic
+   * within the listen time is skipped. The rate configured before the call
+   * is tried first.
+   *
+   * The call returns within roughly the number of candidates times the
+   * listen time. On success the driver is left in normal mode at the
+   * detected rate. Otherwise the previous configuration is restored.
+   *
+   * @param p_clock - clock used to bound the time spent at each rate
+   * @param p_candidates - bit rates to try, in order of likelihood
+   * @param p_listen_time - time to wait for traffic at each rate
+   * @return std::optional<hal::hertz> - the detected bit rate or
+   * std::nullopt if no candidate received a frame without error.
+   */
+  [[nodiscard]] std::optional<hal::hertz> autobaud(
+    hal::steady_clock& p_clock,
+    std::span<hal::hertz const> p_candidates = common_baud_rates,
+    hal::time_duration p_listen_time = std::chrono::milliseconds(100));
+
+  /// Handler called once bus activity has woken the controller
+  using wakeup_handler = void();
+
+  /**
+   * @brief Put the controller into sleep mode with automatic wake-up
+   *
+   * The controller enters sleep mode once the frame currently on the bus, if
+   * any, has finished. See `is_sleeping()`. Bus activity wakes the
+   * controller, which then calls the `on_wakeup()` handler from the can1
+   * status change interrupt.
+   *
+   * The falling edge of the receive line is also armed as an EXTI event, so
+   * the core can be kept in Stop mode with `enter_stop_mode()` while the bus
+   * is idle.
+   *
+   * The controller has to resynchronize with the bus after waking, thus the
+   * frame whose start of frame bit caused the wake-up is not received.
+   * Networks using wake-up frames commonly repeat them until they are
+   * answered.
+   *
+   * @return std::errc - std::errc{} if sleep was requested,
+   * std::errc::device_or_resource_busy if a transmit mailbox is still
+   * pending.
+   */
+  [[nodiscard]] std::errc try_sleep();
+
+  /**
+   * @return true - the controller acknowledged the sleep request
+   * @return false - the controller is awake or still finishing bus activity
+   */
+  [[nodiscard]] bool is_sleeping();
+
+  /**
+   * @brief Leave sleep mode without waiting for bus activity
+   *
+   * The controller resumes once it has synchronized with the bus.
+   */
+  void wake();
+
+  /**
+   * @brief Set a handler called when bus activity wakes the controller
+   *
+   * @param p_handler - handler called from the can1 status change interrupt
+   */
+  void on_wakeup(hal::callback<wakeup_handler> p_handler);
+
   ~can() override;
 
 private:
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace hal::stm32f1 {
+/// Requirements for the bit timing of the can peripheral
+struct can_bit_timing_request
+{
+  /// Frequency of the can peripheral clock (APB1) in Hz
+  std::uint32_t peripheral_frequency = 0;
+  /// Bit rate of the bus in bit/s
+  std::uint32_t baud_rate = 0;
+  /// Position of the sample point within a bit in 1/1000th of a bit. 875 is
+  /// the CANopen and ARINC 825 recommendation.
+  std::uint16_t sample_point = 875;
+  /// Resynchronization jump width in time quanta, 1 to 4
+  std::uint8_t sync_jump_width = 1;
+};
+
+/// Bit timing of the can peripheral and the register value that selects it
+struct can_bit_timing
+{
+  /// Frequency of the can peripheral clock the timing was computed for
+  std::uint32_t peripheral_frequency = 0;
+  /// Value of the bit timing register (BTR) with loop back and silent mode
+  /// cleared
+  std::uint32_t btr = 0;
+  /// Peripheral clock cycles per time quantum, 1 to 1024
+  std::uint16_t prescaler = 0;
+  /// Time quanta per bit
+  std::uint8_t time_quanta = 0;
+  /// Time quanta between the synchronization segment and the sample point
+  std::uint8_t segment1 = 0;
+  /// Time quanta between the sample point and the end of the bit
+  std::uint8_t segment2 = 0;
+  /// Resynchronization jump width in time quanta
+  std::uint8_t sync_jump_width = 0;
+  /// Resulting sample point in 1/1000th of a bit
+  std::uint16_t sample_point = 0;
+  /// Resulting bit rate in bit/s, rounded down
+  std::uint32_t baud_rate = 0;
+  /// Deviation of the resulting bit rate from the requested one in parts per
+  /// million
+  std::int32_t baud_rate_error = 0;
+};
+
+/**
+ * @brief Find the bit timing closest to the requirements
+ *
+ * Every prescaler and time quanta per bit combination supported by the
+ * hardware is considered. The combination with the smallest bit rate error
+ * wins, ties are broken by the smallest sample point error and then by the
+ * most time quanta per bit, which gives the finest resynchronization.
+ *
+ * Segment 2 is derived from the sample point directly, rather than by moving
+ * quanta between the segments after the fact, thus the reported sample point
+ * is the one that the register value produces.
+ *
+ * @param p_request - peripheral clock, bit rate, sample point and SJW
+ * @return std::optional<can_bit_timing> - the best timing or std::nullopt if
+ * the bit rate cannot be generated within 1% or the SJW is out of range.
+ */
+constexpr std::optional<can_bit_timing> find_can_bit_timing(
+  can_bit_timing_request const& p_request)
+{
+  // Hardware limits of CAN_BTR
+  constexpr std::uint32_t max_prescaler = 1024;
+  constexpr std::uint32_t max_segment1 = 16;
+  constexpr std::uint32_t max_segment2 = 8;
+  constexpr std::uint32_t max_sync_jump_width = 4;
+  // Fewer quanta make the sample point too coarse to be useful
+  constexpr std::uint32_t min_time_quanta = 8;
+  constexpr std::uint32_t max_time_quanta = 1 + max_segment1 + max_segment2;
+  constexpr std::int64_t max_error_ppm = 10'000;
+
+  auto const frequency =
+    static_cast<std::int64_t>(p_request.peripheral_frequency);
+  auto const baud_rate = static_cast<std::int64_t>(p_request.baud_rate);
+  auto const sync_jump_width = std::uint32_t{ p_request.sync_jump_width };
+
+  if (frequency == 0 || baud_rate == 0 || sync_jump_width == 0 ||
+      sync_jump_width > max_sync_jump_width) {
+    return std::nullopt;
+  }
+
+  std::optional<can_bit_timing> best{};
+  std::int64_t best_error = 0;
+  std::int64_t best_sample_point_error = 0;
+
+  for (std::uint32_t quanta = min_time_quanta; quanta <= max_time_quanta;
+       quanta++) {
+    // Round to the nearest prescaler for this number of quanta
+    auto const cycles_per_bit = baud_rate * quanta;
+    auto const prescaler = static_cast<std::uint32_t>(
+      (frequency + cycles_per_bit / 2) / cycles_per_bit);
+    if (prescaler == 0 || prescaler > max_prescaler) {
+      continue;
+    }
+
+    auto const actual_cycles = std::int64_t{ prescaler } * quanta * baud_rate;
+    auto const error =
+      ((frequency - actual_cycles) * 1'000'000) / actual_cycles;
+    auto const abs_error = error < 0 ? -error : error;
+    if (abs_error > max_error_ppm) {
+      continue;
+    }
+
+    // Segment 2 spans from the sample point to the end of the bit
+    auto segment2 =
+      (quanta * (1000U - p_request.sample_point) + 500U) / 1000U;
+    if (segment2 < 1) {
+      segment2 = 1;
+    }
+    if (segment2 > max_segment2) {
+      segment2 = max_segment2;
+    }
+    auto const segment1 = quanta - 1U - segment2;
+    if (segment1 < 1 || segment1 > max_segment1 ||
+        sync_jump_width > segment2) {
+      continue;
+    }
+
+    auto const sample_point = ((1U + segment1) * 1000U) / quanta;
+    auto const sample_point_error =
+      static_cast<std::int64_t>(sample_point) - p_request.sample_point;
+    auto const abs_sample_point_error =
+      sample_point_error < 0 ? -sample_point_error : sample_point_error;
+
+    bool const better =
+      not best || abs_error < best_error ||
+      (abs_error == best_error &&
+       abs_sample_point_error <= best_sample_point_error);
+    if (not better) {
+      continue;
+    }
+
+    best_error = abs_error;
+    best_sample_point_error = abs_sample_point_error;
+    best = can_bit_timing{
+      .peripheral_frequency = p_request.peripheral_frequency,
+      // BRP is bits 0-9, TS1 bits 16-19, TS2 bits 20-22 and SJW bits 24-25,
+      // each holding its value minus one.
+      .btr = (prescaler - 1U) | ((segment1 - 1U) << 16U) |
+             ((segment2 - 1U) << 20U) | ((sync_jump_width - 1U) << 24U),
+      .prescaler = static_cast<std::uint16_t>(prescaler),
+      .time_quanta = static_cast<std::uint8_t>(quanta),
+      .segment1 = static_cast<std::uint8_t>(segment1),
+      .segment2 = static_cast<std::uint8_t>(segment2),
+      .sync_jump_width = static_cast<std::uint8_t>(sync_jump_width),
+      .sample_point = static_cast<std::uint16_t>(sample_point),
+      .baud_rate =
+        static_cast<std::uint32_t>(frequency / (prescaler * quanta)),
+      .baud_rate_error = static_cast<std::int32_t>(error),
+    };
+  }
+
+  return best;
+}
+
+namespace detail {
+/// Not constexpr on purpose, calling it from a constant expression fails the
+/// compilation with this function's name in the diagnostic.
+inline void no_can_bit_timing_within_one_percent()
+{
+}
+}  // namespace detail
+
+/**
+ * @brief Compute the bit timing of the can peripheral at compile time
+ *
+ * Usage:
+ *
+ *    constexpr auto timing = hal::stm32f1::solve_can_bit_timing({
+ *      .peripheral_frequency = 36'000'000,
+ *      .baud_rate = 500'000,
+ *      .sample_point = 875,
+ *    });
+ *    static_assert(timing.baud_rate_error == 0);
+ *    (void)can.try_configure_bit_timing(timing);
+ *
+ * @param p_request - peripheral clock, bit rate, sample point and SJW
+ * @return can_bit_timing - the best timing, see `find_can_bit_timing()`.
+ * Fails to compile if there is none.
+ */
+consteval can_bit_timing solve_can_bit_timing(
+  can_bit_timing_request const& p_request)
+{
+  auto const timing = find_can_bit_timing(p_request);
+  if (not timing) {
+    detail::no_can_bit_timing_within_one_percent();
+  }
+  return timing.value_or(can_bit_timing{});
+}
+}  // namespace hal::stm32f1
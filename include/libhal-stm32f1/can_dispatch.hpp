@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <libhal/can.hpp>
+#include <libhal/functional.hpp>
+
+#include "can.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Routes received messages to a handler per hardware filter
+ *
+ * Handlers are looked up by the FIFO and filter match index reported by the
+ * hardware, so routing a message is a single indexed call rather than a
+ * chain of identifier comparisons.
+ *
+ * Usage:
+ *
+ *    hal::stm32f1::can_dispatch_table<4> table;
+ *    (void)can.try_configure_filter(0, { .id = 0x100, .mask = 0x7F0 });
+ *    table.set(can.route(0), engine_handler);
+ *    table.attach(can);
+ *
+ * @tparam routes_per_fifo - number of filter match indexes per FIFO that can
+ * have a handler
+ */
+template<std::size_t routes_per_fifo>
+class can_dispatch_table
+{
+public:
+  /**
+   * @brief Set the handler for messages accepted through a route
+   *
+   * @param p_route - FIFO and filter match index, see `can::route()`
+   * @param p_handler - handler for messages of the route
+   * @return true - the handler was set
+   * @return false - the filter match index does not fit into the table
+   */
+  bool set(can::filter_route p_route, hal::callback<hal::can::handler> p_handler)
+  {
+    if (p_route.fifo >= m_handlers.size() ||
+        p_route.filter_match_index >= routes_per_fifo) {
+      return false;
+    }
+    m_handlers[p_route.fifo][p_route.filter_match_index] = p_handler;
+    return true;
+  }
+
+  /**
+   * @brief Set the handler for messages without a handler of their own
+   *
+   * @param p_handler - handler for unrouted messages
+   */
+  void fallback(hal::callback<can::filtered_handler> p_handler)
+  {
+    m_fallback = p_handler;
+  }
+
+  /**
+   * @brief Route a message to its handler
+   *
+   * @param p_message - message and the route it was accepted through
+   */
+  void dispatch(can::filtered_message_t const& p_message)
+  {
+    auto const& route = p_message.route;
+    if (route.fifo < m_handlers.size() &&
+        route.filter_match_index < routes_per_fifo) {
+      auto& handler = m_handlers[route.fifo][route.filter_match_index];
+      if (handler) {
+        handler(p_message.message);
+        return;
+      }
+    }
+
+    if (m_fallback) {
+      m_fallback(p_message);
+    }
+  }
+
+  /**
+   * @brief Dispatch every message the can driver receives through this table
+   *
+   * @param p_can - can driver to receive messages from. The table must
+   * outlive the registration.
+   */
+  void attach(can& p_can)
+  {
+    p_can.on_filtered_receive(
+      [this](can::filtered_message_t const& p_message) {
+        dispatch(p_message);
+      });
+  }
+
+private:
+  std::array<std::array<hal::callback<hal::can::handler>, routes_per_fifo>, 2>
+    m_handlers{};
+  hal::callback<can::filtered_handler> m_fallback{};
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <libhal/can.hpp>
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief A frame sent periodically by a `can_schedule`
+ *
+ * The frame is encoded into transmit mailbox register images once, when it is
+ * constructed. Producers change the data with `update_payload()`, which
+ * writes into the images directly, so sending the frame is reduced to four
+ * register writes.
+ */
+class can_cyclic_frame
+{
+public:
+  /**
+   * @param p_message - identifier, length and initial data of the frame
+   * @param p_period - time between two transmissions in schedule ticks,
+   * must be at least 1.
+   */
+  can_cyclic_frame(hal::can::message_t const& p_message,
+                   std::uint16_t p_period);
+
+  can_cyclic_frame(can_cyclic_frame const&) = delete;
+  can_cyclic_frame& operator=(can_cyclic_frame const&) = delete;
+  can_cyclic_frame(can_cyclic_frame&&) = delete;
+  can_cyclic_frame& operator=(can_cyclic_frame&&) = delete;
+
+  /**
+   * @brief Replace data bytes of the frame
+   *
+   * Safe to call while the schedule is running. The next transmission sends
+   * either the old or the new data, never a mix of both.
+   *
+   * @param p_data - new data bytes, bytes beyond the 8th are ignored
+   * @param p_offset - index of the first data byte to replace
+   */
+  void update_payload(std::span<hal::byte const> p_data,
+                      std::size_t p_offset = 0);
+
+  /**
+   * @return std::uint16_t - time between two transmissions in schedule ticks
+   */
+  [[nodiscard]] std::uint16_t period() const
+  {
+    return m_period;
+  }
+
+  /**
+   * @return std::uint16_t - tick within the period the frame is released in,
+   * assigned by `can_schedule::plan()`.
+   */
+  [[nodiscard]] std::uint16_t offset() const
+  {
+    return m_offset;
+  }
+
+  /**
+   * @return std::uint32_t - number of times the frame was released again
+   * before its previous release made it into a mailbox
+   */
+  [[nodiscard]] std::uint32_t overruns() const
+  {
+    return m_overruns;
+  }
+
+private:
+  friend class can_schedule;
+
+  std::uint32_t m_identifier_image = 0;
+  std::uint32_t m_length_image = 0;
+  std::array<std::uint32_t, 2> m_data_image{};
+  std::uint16_t m_period = 1;
+  std::uint16_t m_offset = 0;
+  std::uint16_t m_countdown = 1;
+  bool m_pending = false;
+  std::uint32_t m_overruns = 0;
+};
+
+/**
+ * @brief Time triggered transmit schedule for periodic can frames
+ *
+ * A single hardware timer drives the schedule. On each tick every frame whose
+ * period has elapsed is released and released frames are loaded into free
+ * transmit mailboxes straight from their register images. Frames that find
+ * no free mailbox stay pending until the next tick or `transmit_ready()`.
+ *
+ * Before starting, `plan()` assigns each frame an offset within its period so
+ * that frames are spread across ticks instead of being released together,
+ * which flattens peaks in the bus load.
+ *
+ * Usage:
+ *
+ *    hal::stm32f1::can_cyclic_frame engine_speed({ .id = 0x100,
+ *                                                  .length = 8 }, 10);
+ *    hal::stm32f1::can_schedule schedule;
+ *    (void)schedule.add(engine_speed);
+ *    (void)schedule.try_start(hal::stm32f1::peripheral::timer2);
+ *    // ...
+ *    engine_speed.update_payload(rpm_bytes);
+ */
+class can_schedule
+{
+public:
+  /// Maximum number of frames that can be added to a schedule
+  static constexpr std::size_t max_frames = 48;
+
+  can_schedule() = default;
+  can_schedule(can_schedule const&) = delete;
+  can_schedule& operator=(can_schedule const&) = delete;
+  can_schedule(can_schedule&&) = delete;
+  can_schedule& operator=(can_schedule&&) = delete;
+
+  /**
+   * @brief Add a frame to the schedule
+   *
+   * Frames can only be added while the schedule is stopped.
+   *
+   * @param p_frame - frame to send periodically, must outlive the schedule or
+   * be removed before it is destroyed.
+   * @return std::errc - std::errc{} on success,
+   * std::errc::not_enough_memory if `max_frames` are already added,
+   * std::errc::address_in_use if the frame was already added and
+   * std::errc::device_or_resource_busy if the schedule is running.
+   */
+  [[nodiscard]] std::errc add(can_cyclic_frame& p_frame);
+
+  /**
+   * @brief Remove a frame from the schedule
+   *
+   * @param p_frame - frame to stop sending
+   */
+  void remove(can_cyclic_frame& p_frame);
+
+  /**
+   * @brief Assign the release offset of each frame
+   *
+   * Frames are placed in order of increasing period. Each frame gets the
+   * offset that collides least often with the frames already placed,
+   * weighting each collision by how often it recurs. Called by
+   * `try_start()`, the runtime is proportional to the number of frames
+   * squared times the longest period.
+   */
+  void plan();
+
+  /**
+   * @brief Plan the schedule and start the timer driving it
+   *
+   * Only one schedule can run at a time.
+   *
+   * @param p_timer - general purpose timer to use, timer2 to timer4
+   * @param p_tick - time of one schedule tick, periods are multiples of it
+   * @return std::errc - std::errc{} on success,
+   * std::errc::argument_out_of_domain if the timer is not supported,
+   * std::errc::operation_not_supported if the tick cannot be generated by the
+   * timer and std::errc::device_or_resource_busy if a schedule is already
+   * running or the timer is in use by another driver.
+   */
+  [[nodiscard]] std::errc try_start(
+    peripheral p_timer,
+    hal::time_duration p_tick = std::chrono::milliseconds(1));
+
+  /**
+   * @brief Stop the timer, pending frames are dropped
+   */
+  void stop();
+
+  /**
+   * @brief Advance the schedule by one tick
+   *
+   * Called by the timer interrupt.
+   */
+  void tick();
+
+  /**
+   * @brief Load pending frames now that a transmit mailbox is free
+   *
+   * Optional, call from `can::on_transmit_ready()` to send frames that found
+   * every mailbox full without waiting for the next tick.
+   */
+  void transmit_ready();
+
+  ~can_schedule();
+
+private:
+  void load_pending();
+
+  std::array<can_cyclic_frame*, max_frames> m_frames{};
+  std::size_t m_count = 0;
+  peripheral m_timer = peripheral::timer2;
+  bool m_running = false;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <libhal/can.hpp>
+#include <libhal/serial.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::stm32f1 {
+/**
+ * @brief Bus load and per ID traffic statistics for a can bus
+ *
+ * Frames are recorded from the can interrupts with a constant, bounded cost.
+ * Per ID statistics are kept in an open addressing table supplied by the
+ * derived `static_can_statistics` class. Frames whose ID does not fit into
+ * the table are still counted towards the bus load.
+ *
+ * Attach to the stm32f1 can driver with `can::attach_statistics()`.
+ */
+class can_statistics
+{
+public:
+  /// Number of table slots probed before an ID is considered untracked
+  static constexpr std::size_t max_probe_length = 8;
+
+  /// Statistics for a single can ID
+  struct id_statistics
+  {
+    /// Can ID of the frames
+    hal::can::id_t id = 0;
+    /// Number of frames received or transmitted with this ID
+    std::uint32_t frames = 0;
+    /// Shortest time between two frames in clock ticks
+    std::uint32_t min_interval = 0;
+    /// Longest time between two frames in clock ticks
+    std::uint32_t max_interval = 0;
+    /// Uptime of the most recent frame in clock ticks
+    std::uint64_t last_seen = 0;
+  };
+
+  /// Totals across every frame on the bus
+  struct totals
+  {
+    /// Time the statistics have been collected over in clock ticks
+    std::uint64_t duration = 0;
+    /// Frequency of the clock used for timestamps
+    hal::hertz clock_frequency = 0.0f;
+    /// Bit rate of the bus
+    hal::hertz baud_rate = 0.0f;
+    /// Number of frames received
+    std::uint64_t received_frames = 0;
+    /// Number of frames transmitted
+    std::uint64_t transmitted_frames = 0;
+    /// Frames whose ID could not be stored in the table
+    std::uint64_t untracked_frames = 0;
+    /// Frame bits including interframe space, excluding stuff bits
+    std::uint64_t nominal_bits = 0;
+    /// Upper bound of stuff bits inserted into the recorded frames
+    std::uint64_t worst_case_stuff_bits = 0;
+
+    /**
+     * @return float - fraction of the bus time used, assuming no stuff bits
+     */
+    [[nodiscard]] float minimum_bus_load() const;
+
+    /**
+     * @return float - fraction of the bus time used, assuming every frame
+     * needed the worst case number of stuff bits.
+     */
+    [[nodiscard]] float maximum_bus_load() const;
+  };
+
+  /**
+   * @brief Number of bits of a frame on the bus excluding stuff bits
+   *
+   * Includes the 3 bit interframe space.
+   *
+   * @param p_message - frame to measure
+   * @return std::uint32_t - length of the frame in bits
+   */
+  static constexpr std::uint32_t nominal_bits(
+    hal::can::message_t const& p_message)
+  {
+    return (is_extended(p_message) ? 67U : 47U) + data_bits(p_message);
+  }
+
+  /**
+   * @brief Maximum number of stuff bits the frame can contain
+   *
+   * Stuffing applies from the start of frame bit to the end of the CRC.
+   *
+   * @param p_message - frame to measure
+   * @return std::uint32_t - worst case number of stuff bits
+   */
+  static constexpr std::uint32_t worst_case_stuff_bits(
+    hal::can::message_t const& p_message)
+  {
+    auto const stuffed_bits =
+      (is_extended(p_message) ? 54U : 34U) + data_bits(p_message);
+    return (stuffed_bits - 1U) / 4U;
+  }
+
+  can_statistics(can_statistics const&) = delete;
+  can_statistics& operator=(can_statistics const&) = delete;
+  can_statistics(can_statistics&&) = delete;
+  can_statistics& operator=(can_statistics&&) = delete;
+
+  /**
+   * @brief Set the bit rate used to compute the bus load
+   *
+   * @param p_baud_rate - bit rate of the bus
+   */
+  void baud_rate(hal::hertz p_baud_rate);
+
+  /**
+   * @brief Record a frame received from the bus
+   *
+   * @param p_message - received frame
+   */
+  void record_receive(hal::can::message_t const& p_message);
+
+  /**
+   * @brief Record a frame transmitted onto the bus
+   *
+   * @param p_message - transmitted frame
+   */
+  void record_transmit(hal::can::message_t const& p_message);
+
+  /**
+   * @brief Clear all statistics and restart the measurement period
+   */
+  void reset();
+
+  /**
+   * @return totals - consistent copy of the bus wide totals
+   */
+  [[nodiscard]] totals snapshot();
+
+  /**
+   * @brief Copy the statistics of an ID
+   *
+   * @param p_id - can ID to look up
+   * @return id_statistics - statistics of the ID, frames is 0 if the ID has
+   * not been seen.
+   */
+  [[nodiscard]] id_statistics find(hal::can::id_t p_id);
+
+  /**
+   * @brief Write a snapshot of the statistics as a single line of JSON
+   *
+   * Format:
+   *
+   *    {"duration_us":N,"baud_rate":N,"rx":N,"tx":N,"untracked":N,
+   *     "bus_load_ppm":[min,max],
+   *     "ids":[{"id":N,"frames":N,"min_us":N,"max_us":N},...]}
+   *
+   * @param p_serial - serial port to write the snapshot to
+   */
+  void export_snapshot(hal::serial& p_serial);
+
+protected:
+  /**
+   * @param p_table - storage for the per ID statistics, the size must be a
+   * power of two.
+   * @param p_clock - clock used to timestamp frames
+   */
+  can_statistics(std::span<id_statistics> p_table, hal::steady_clock& p_clock);
+
+private:
+  static constexpr bool is_extended(hal::can::message_t const& p_message)
+  {
+    return p_message.id >= (1UL << 11UL);
+  }
+
+  static constexpr std::uint32_t data_bits(
+    hal::can::message_t const& p_message)
+  {
+    if (p_message.is_remote_request) {
+      return 0;
+    }
+    return 8U * (p_message.length > 8 ? 8U : p_message.length);
+  }
+
+  void record(hal::can::message_t const& p_message);
+  id_statistics* slot_of(hal::can::id_t p_id, bool p_insert);
+
+  std::span<id_statistics> m_table;
+  hal::steady_clock* m_clock;
+  totals m_totals{};
+  std::uint64_t m_start = 0;
+};
+
+/**
+ * @brief can_statistics with a table sized at compile time
+ *
+ * @tparam capacity - number of distinct IDs that can be tracked, must be a
+ * power of two. Keep the table at most 3/4 full for short probe sequences.
+ */
+template<std::size_t capacity>
+class static_can_statistics : public can_statistics
+{
+public:
+  static_assert(capacity != 0 && (capacity & (capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+  /**
+   * @param p_clock - clock used to timestamp frames
+   */
+  explicit static_can_statistics(hal::steady_clock& p_clock)
+    : can_statistics(m_storage, p_clock)
+  {
+  }
+
+private:
+  std::array<id_statistics, capacity> m_storage{};
+};
+}  // namespace hal::stm32f1
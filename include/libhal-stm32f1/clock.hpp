@@ -195,6 +195,22 @@ void configure_clocks(clock_tree p_clock_tree);
 /// @return the clock rate frequency of a peripheral
 hal::hertz frequency(peripheral p_id);
 
+/**
+ * @brief Enter Stop mode until an event or interrupt wakes the core
+ *
+ * Every clock of the 1.8V domain is stopped while SRAM and registers are
+ * retained. The core wakes on any EXTI line configured as an event, such as
+ * the one armed by `can::try_sleep()`, and on any pending interrupt. The
+ * system clock is the internal oscillator after waking, thus the clock tree
+ * is reapplied before returning.
+ *
+ * The call may return early on a stale event, callers that wait for a
+ * specific condition should check it and call again.
+ *
+ * @param p_clock_tree - clock configuration to restore after waking
+ */
+void enter_stop_mode(clock_tree const& p_clock_tree);
+
 /**
  * @brief Sets every bus to its maximum possible frequency using the internal
  * oscillator
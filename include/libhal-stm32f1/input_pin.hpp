@@ -18,7 +18,17 @@
 
 #include <libhal/input_pin.hpp>
 
+#include "async.hpp"
+
 namespace hal::stm32f1 {
+/// Pin transitions that complete an `input_pin::edge()` wait
+enum class edge_trigger : std::uint8_t
+{
+  rising,
+  falling,
+  both,
+};
+
 /**
  * @brief Input pin implementation for the stm32f10x
  *
@@ -39,6 +49,23 @@ public:
   input_pin(std::uint8_t p_port,  // NOLINT
             std::uint8_t p_pin);  // NOLINT
 
+  /**
+   * @brief Wait for the pin to transition
+   *
+   * Routes the pin to its EXTI line and arms a one-shot interrupt. The
+   * awaiting coroutine is resumed after the first matching edge. EXTI lines
+   * are shared between ports, so only one pin per pin number can wait on an
+   * edge at a time.
+   *
+   * Usage:
+   *
+   *    co_await button.edge(edge_trigger::falling);
+   *
+   * @param p_trigger - which transitions complete the wait
+   * @return async_event& - event signaled on the edge
+   */
+  async_event& edge(edge_trigger p_trigger = edge_trigger::both);
+
 private:
   void driver_configure([[maybe_unused]] settings const& p_settings) override;
   bool driver_level() override;
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <libhal/can.hpp>
+#include <libhal/functional.hpp>
+
+#include "uart.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Readiness of several ports in one word, like select/poll
+ *
+ * Each watched port is given a bit that its interrupts set in a single
+ * atomic word: the idle line and DMA fill interrupts of a uart and the
+ * receive FIFO interrupt of a can. The main loop takes the whole set of
+ * ready ports at once and sleeps with WFI while it is empty, instead of
+ * calling `read()` on every port each iteration.
+ *
+ * Usage:
+ *
+ *    hal::stm32f1::io_multiplexer mux;
+ *    auto const gps = mux.watch(uart1);
+ *    auto const modem = mux.watch(uart2);
+ *    auto const bus = mux.watch(can, can_handler);
+ *    while (true) {
+ *      auto const ready = mux.wait();
+ *      if (ready & gps) { ... uart1.read(...) ... }
+ *      if (ready & modem) { ... uart2.read(...) ... }
+ *      if (ready & bus) { ... handle queued messages ... }
+ *    }
+ *
+ * A bit reports that data has arrived since the set was last taken. Read
+ * each ready port until it is empty, since several bursts may have been
+ * merged into one bit.
+ */
+class io_multiplexer
+{
+public:
+  /// Set of ports, one bit each
+  using ready_set = std::uint32_t;
+
+  io_multiplexer() = default;
+  io_multiplexer(io_multiplexer const&) = delete;
+  io_multiplexer& operator=(io_multiplexer const&) = delete;
+  io_multiplexer(io_multiplexer&&) = delete;
+  io_multiplexer& operator=(io_multiplexer&&) = delete;
+
+  /**
+   * @brief Watch a uart for received data
+   *
+   * Takes over the uart's `on_receive_idle()` and `on_receive_progress()`
+   * handlers, so it cannot be combined with a `modbus_rtu_server` on the same
+   * port.
+   *
+   * @param p_uart - uart to watch, must outlive the multiplexer's use
+   * @return ready_set - bit of the uart, 0 if all 32 bits are taken
+   */
+  [[nodiscard]] ready_set watch(uart& p_uart);
+
+  /**
+   * @brief Watch a can for received messages
+   *
+   * Messages are still read out by the receive interrupt, which passes them
+   * to the handler before marking the can as ready. Replaces the handler
+   * registered with `on_receive()`.
+   *
+   * @param p_can - can to watch, must outlive the multiplexer's use
+   * @param p_handler - handler for each received message
+   * @return ready_set - bit of the can, 0 if all 32 bits are taken
+   */
+  [[nodiscard]] ready_set watch(hal::can& p_can,
+                                hal::callback<hal::can::handler> p_handler);
+
+  /**
+   * @brief Reserve a bit for another interrupt source
+   *
+   * @return ready_set - the bit, to be passed to `signal()`. 0 if all 32 bits
+   * are taken.
+   */
+  [[nodiscard]] ready_set allocate();
+
+  /**
+   * @brief Mark ports as ready
+   *
+   * Safe to call from an interrupt service routine.
+   *
+   * @param p_ready - bits of the ports with pending work
+   */
+  void signal(ready_set p_ready)
+  {
+    m_ready.fetch_or(p_ready, std::memory_order_release);
+  }
+
+  /**
+   * @brief Take the ready set without waiting
+   *
+   * @return ready_set - ports that became ready since the set was last taken,
+   * 0 if none
+   */
+  [[nodiscard]] ready_set poll()
+  {
+    return m_ready.exchange(0, std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Sleep until a port is ready and take the ready set
+   *
+   * The core waits with WFI, any interrupt wakes it to check the set again.
+   *
+   * @return ready_set - ports that became ready since the set was last taken,
+   * never 0
+   */
+  [[nodiscard]] ready_set wait();
+
+private:
+  std::atomic<ready_set> m_ready{ 0 };
+  ready_set m_allocated = 0;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <libhal/can.hpp>
+#include <libhal/functional.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+#include "can.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief A single ISO 15765-2 (ISO-TP) connection with a peer
+ *
+ * A session is identified by the pair of can IDs used by each side. Messages
+ * are reassembled directly into the receive buffer supplied by the caller and
+ * transmitted directly from the caller's data, thus no intermediate copies
+ * are made.
+ */
+class iso_tp_session
+{
+public:
+  struct settings
+  {
+    /// Can ID used for frames sent by this node
+    hal::can::id_t transmit_id = 0;
+    /// Can ID used for frames sent by the peer
+    hal::can::id_t receive_id = 0;
+    /// Number of consecutive frames the peer may send before waiting for the
+    /// next flow control frame. 0 means no limit.
+    std::uint8_t block_size = 0;
+    /// Minimum time between consecutive frames requested from the peer using
+    /// the ISO-TP STmin encoding: 0x00 to 0x7F is 0 to 127ms and 0xF1 to 0xF9
+    /// is 100us to 900us.
+    std::uint8_t separation_time = 0;
+    /// Value of the unused bytes of a frame
+    hal::byte padding = 0xCC;
+  };
+
+  /// State of a transfer in one direction
+  enum class status : std::uint8_t
+  {
+    /// No transfer has been started
+    idle,
+    /// Transfer has started but has not finished
+    in_progress,
+    /// Transfer finished successfully
+    complete,
+    /// Message is larger than the receiving side's buffer
+    overflow,
+    /// Peer did not respond in time
+    timeout,
+    /// Peer sent an out of sequence or invalid frame
+    protocol_error,
+  };
+
+  /// Handler called once a message has been completely received
+  using receive_handler = void(iso_tp_session& p_session,
+                               std::span<hal::byte const> p_message);
+
+  /**
+   * @brief Construct a new iso tp session object
+   *
+   * @param p_settings - IDs and flow control parameters of the session
+   * @param p_receive_buffer - buffer that received messages are reassembled
+   * into. Messages larger than this buffer are rejected.
+   */
+  iso_tp_session(settings const& p_settings,
+                 std::span<hal::byte> p_receive_buffer);
+
+  iso_tp_session(iso_tp_session const&) = delete;
+  iso_tp_session& operator=(iso_tp_session const&) = delete;
+  iso_tp_session(iso_tp_session&&) = delete;
+  iso_tp_session& operator=(iso_tp_session&&) = delete;
+
+  /**
+   * @brief Set the handler for completely received messages
+   *
+   * The handler is called from the context that delivered the last frame,
+   * typically the can receive interrupt. The message is only valid until the
+   * next message starts arriving.
+   *
+   * @param p_handler - handler for received messages
+   */
+  void on_receive(hal::callback<receive_handler> p_handler);
+
+  /**
+   * @return status - state of the most recent transmission
+   */
+  [[nodiscard]] status transmit_status() const
+  {
+    return m_transmit_status;
+  }
+
+  /**
+   * @return status - state of the most recent reception
+   */
+  [[nodiscard]] status receive_status() const
+  {
+    return m_receive_status;
+  }
+
+  /**
+   * @return std::span<hal::byte const> - the most recently completed message
+   * or an empty span if no message has been completely received.
+   */
+  [[nodiscard]] std::span<hal::byte const> received() const;
+
+  /**
+   * @return settings const& - the settings of this session
+   */
+  [[nodiscard]] settings const& configuration() const
+  {
+    return m_settings;
+  }
+
+private:
+  friend class iso_tp;
+
+  enum class transmit_phase : std::uint8_t
+  {
+    idle,
+    send_first_frame,
+    wait_for_flow_control,
+    send_consecutive_frames,
+  };
+
+  settings m_settings;
+  std::span<hal::byte> m_receive_buffer;
+  hal::callback<receive_handler> m_receive_handler{};
+
+  // Transmit state
+  std::span<hal::byte const> m_transmit_data{};
+  std::size_t m_transmit_offset = 0;
+  std::uint64_t m_transmit_deadline = 0;
+  std::uint64_t m_next_frame_time = 0;
+  std::uint64_t m_peer_separation = 0;
+  std::uint8_t m_transmit_sequence = 0;
+  std::uint8_t m_peer_block_size = 0;
+  std::uint8_t m_block_remaining = 0;
+  transmit_phase m_phase = transmit_phase::idle;
+  status m_transmit_status = status::idle;
+
+  // Receive state
+  std::size_t m_receive_length = 0;
+  std::size_t m_receive_offset = 0;
+  std::uint64_t m_receive_deadline = 0;
+  std::uint8_t m_receive_sequence = 0;
+  std::uint8_t m_block_count = 0;
+  std::uint8_t m_flow_status = 0;
+  bool m_flow_control_pending = false;
+  status m_receive_status = status::idle;
+};
+
+/**
+ * @brief ISO 15765-2 (ISO-TP) transport engine
+ *
+ * Handles segmentation, reassembly and flow control for a set of sessions
+ * sharing a can bus. Frames are handed to the engine with `handle_frame()`
+ * and consecutive frames are paced by `transmit_ready()`, which should be
+ * called each time a transmit mailbox is freed. When bound to an
+ * `stm32f1::can` both are called from the can interrupts.
+ *
+ * `poll()` must be called periodically to enforce timeouts and to send
+ * consecutive frames when the peer requested a separation time greater than
+ * zero.
+ */
+class iso_tp
+{
+public:
+  /// Maximum number of sessions that can be added to an engine
+  static constexpr std::size_t max_sessions = 8;
+
+  /// Time allowed for the peer to send a flow control or consecutive frame
+  static constexpr std::uint32_t timeout_ms = 1000;
+
+  /// Function that attempts to load a frame into the can controller
+  using transmitter = std::errc(hal::can::message_t const& p_message);
+
+  /**
+   * @brief Construct an engine on top of the stm32f1 can peripheral
+   *
+   * Takes over the can receive and transmit ready handlers and switches the
+   * transmit mailboxes to request order so frames of a session are never
+   * reordered.
+   *
+   * @param p_can - can peripheral to transfer messages over
+   * @param p_clock - clock used for timeouts and separation times
+   */
+  iso_tp(can& p_can, hal::steady_clock& p_clock);
+
+  /**
+   * @brief Construct an engine using a custom frame transmitter
+   *
+   * @param p_transmitter - function that loads a frame for transmission and
+   * returns std::errc{} on success.
+   * @param p_clock - clock used for timeouts and separation times
+   */
+  iso_tp(hal::callback<transmitter> p_transmitter, hal::steady_clock& p_clock);
+
+  iso_tp(iso_tp const&) = delete;
+  iso_tp& operator=(iso_tp const&) = delete;
+  iso_tp(iso_tp&&) = delete;
+  iso_tp& operator=(iso_tp&&) = delete;
+
+  /**
+   * @brief Register a session with the engine
+   *
+   * @param p_session - session to register, must outlive the engine or be
+   * removed before it is destroyed.
+   * @return std::errc - std::errc{} on success,
+   * std::errc::not_enough_memory if `max_sessions` are already registered and
+   * std::errc::address_in_use if a session with the same receive ID exists.
+   */
+  [[nodiscard]] std::errc add(iso_tp_session& p_session);
+
+  /**
+   * @brief Unregister a session from the engine
+   *
+   * @param p_session - session to remove
+   */
+  void remove(iso_tp_session& p_session);
+
+  /**
+   * @brief Start transmitting a message
+   *
+   * The data is not copied and must remain valid until the session's
+   * transmit status is no longer `in_progress`.
+   *
+   * @param p_session - session to send the message over
+   * @param p_data - message to send, at most 2^32 - 1 bytes
+   * @return std::errc - std::errc{} if the transfer started,
+   * std::errc::device_or_resource_busy if a transfer is already in progress
+   * and std::errc::invalid_argument if the data is empty.
+   */
+  [[nodiscard]] std::errc send(iso_tp_session& p_session,
+                               std::span<hal::byte const> p_data);
+
+  /**
+   * @brief Process a received can frame
+   *
+   * @param p_frame - frame received from the can bus
+   * @return true - the frame belonged to a registered session
+   * @return false - the frame was not for this engine
+   */
+  bool handle_frame(hal::can::message_t const& p_frame);
+
+  /**
+   * @brief Load any pending frames now that a transmit mailbox is free
+   */
+  void transmit_ready();
+
+  /**
+   * @brief Enforce timeouts and send frames delayed by a separation time
+   */
+  void poll();
+
+private:
+  iso_tp_session* find(hal::can::id_t p_receive_id);
+  void service(iso_tp_session& p_session, std::uint64_t p_now);
+  bool transmit(iso_tp_session& p_session,
+                std::span<hal::byte const> p_frame_data);
+  void receive_single_frame(iso_tp_session& p_session,
+                            hal::can::message_t const& p_frame);
+  void receive_first_frame(iso_tp_session& p_session,
+                           hal::can::message_t const& p_frame,
+                           std::uint64_t p_now);
+  void receive_consecutive_frame(iso_tp_session& p_session,
+                                 hal::can::message_t const& p_frame,
+                                 std::uint64_t p_now);
+  void receive_flow_control(iso_tp_session& p_session,
+                            hal::can::message_t const& p_frame,
+                            std::uint64_t p_now);
+  std::uint64_t separation_ticks(std::uint8_t p_separation_time) const;
+
+  hal::callback<transmitter> m_transmitter;
+  hal::steady_clock* m_clock;
+  std::uint64_t m_ticks_per_ms;
+  std::array<iso_tp_session*, max_sessions> m_sessions{};
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include <libhal/functional.hpp>
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/// Settings of a `matrix_scanner`
+struct matrix_scanner_settings
+{
+  /// Port of the row select pins and LED pins, 'A' to 'E'
+  std::uint8_t row_port = 'B';
+  /// First of the 8 consecutive row select pins
+  std::uint8_t first_row_pin = 8;
+  /// Port of the column pins, 'A' to 'E'
+  std::uint8_t column_port = 'A';
+  /// First of the 8 consecutive column pins
+  std::uint8_t first_column_pin = 0;
+  /// Drive the 8 consecutive LED pins from `first_led_pin` of the row port
+  /// together with each row
+  bool drive_leds = false;
+  /// First of the 8 consecutive LED pins, on the row port
+  std::uint8_t first_led_pin = 0;
+  /// Rows scanned per second, a frame is 8 rows
+  hal::hertz row_rate = 8'000.0f;
+  /// Consecutive frames a key must read the same before its state changes
+  std::uint8_t debounce_frames = 4;
+  /// General purpose timer pacing the scan, timer2 to timer4. The default
+  /// leaves timer3 to `modbus_rtu_server` and timer4 to
+  /// `uart_receive_timeout`.
+  peripheral timer = peripheral::timer2;
+};
+
+/// Change of a key of a `matrix_scanner`
+struct matrix_key_event
+{
+  /// Row of the key, 0 to 7
+  std::uint8_t row;
+  /// Column of the key, 0 to 7
+  std::uint8_t column;
+  /// true if the key was pressed, false if it was released
+  bool pressed;
+};
+
+/**
+ * @brief Scanner for an 8x8 key matrix and multiplexed LED display
+ *
+ * The scan runs without CPU time per row. The timer's update event requests a
+ * DMA transfer of the next row's pattern to the row port's BSRR, which pulls
+ * the row low and releases the others, and sets the LED pins for the row. Half
+ * a row period later a capture/compare event requests a DMA transfer of the
+ * column port's IDR into the sample buffer, once the row has settled.
+ *
+ * Both DMA channels are circular. The sample buffer holds two frames, and the
+ * DMA half and full transfer interrupts fire once per frame of 8 rows. That
+ * interrupt debounces the keys and reports the changes to the handler.
+ *
+ * Rows are open drain outputs, active low. Columns are inputs with pull-ups,
+ * so a pressed key reads low. LED pins are push-pull outputs and are high for
+ * a lit LED while its row is low.
+ *
+ * DMA1 channels used by each timer, update then capture/compare: timer2
+ * uses 2 and 1 (compare 3), timer3 uses 3 and 6 (compare 1), timer4 uses 7
+ * and 1 (compare 1). The timer and channels are claimed, so a usart or
+ * another driver holding one of them makes the start fail.
+ */
+class matrix_scanner
+{
+public:
+  using handler = void(matrix_key_event p_event);
+
+  /// Rows and columns of the matrix
+  static constexpr std::size_t size = 8;
+
+  matrix_scanner() = default;
+
+  matrix_scanner(matrix_scanner const&) = delete;
+  matrix_scanner& operator=(matrix_scanner const&) = delete;
+  matrix_scanner(matrix_scanner&&) = delete;
+  matrix_scanner& operator=(matrix_scanner&&) = delete;
+
+  /**
+   * @brief Configure the pins and start scanning
+   *
+   * One scanner can run per timer.
+   *
+   * @param p_settings - pins, timing and timer
+   * @param p_handler - called from the DMA interrupt for each key change
+   * @return std::errc - std::errc{} on success,
+   * std::errc::argument_out_of_domain if the timer, a port or the pins are
+   * not supported or overlap, std::errc::operation_not_supported if the row
+   * rate cannot be generated by the timer and
+   * std::errc::device_or_resource_busy if the timer or a DMA channel is
+   * already in use by this or another driver.
+   */
+  [[nodiscard]] std::errc try_start(matrix_scanner_settings const& p_settings,
+                                    hal::callback<handler> p_handler);
+
+  /**
+   * @brief Stop scanning, the timer is powered off and the rows released
+   */
+  void stop();
+
+  /**
+   * @brief Set the LEDs of a row, shown from the next time the row is scanned
+   *
+   * Has no visible effect unless `drive_leds` is set.
+   *
+   * @param p_row - row, 0 to 7
+   * @param p_leds - one bit per LED pin, bit 0 is `first_led_pin`
+   */
+  void set_leds(std::size_t p_row, std::uint8_t p_leds);
+
+  /**
+   * @return std::uint64_t - debounced key state, bit `row * 8 + column` is
+   * set while the key is pressed
+   */
+  [[nodiscard]] std::uint64_t keys() const
+  {
+    return m_keys;
+  }
+
+  /**
+   * @brief Debounce a completed frame of samples
+   *
+   * Called by the DMA interrupt.
+   *
+   * @param p_frame - frame of the sample buffer, 0 or 1
+   */
+  void frame_complete(std::size_t p_frame);
+
+  ~matrix_scanner();
+
+private:
+  /// BSRR word of each row
+  std::array<std::uint32_t, size> m_patterns{};
+  /// IDR sample of each row, two frames
+  std::array<std::uint16_t, size * 2> m_samples{};
+  /// Frames each key has read differently from its state
+  std::array<std::uint8_t, size * size> m_counts{};
+  std::array<std::uint8_t, size> m_leds{};
+  hal::callback<handler> m_handler{};
+  std::uint64_t m_keys = 0;
+  /// Keys with a non-zero count
+  std::uint64_t m_counting = 0;
+  matrix_scanner_settings m_settings{};
+  bool m_running = false;
+};
+}  // namespace hal::stm32f1
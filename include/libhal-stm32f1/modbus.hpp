@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+#include "uart.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Update a CRC-16/MODBUS
+ *
+ * Polynomial 0x8005 reflected, initial value 0xFFFF. Frames carry the CRC
+ * little endian after the frame, so the CRC over a whole intact frame is 0.
+ *
+ * @param p_data - bytes to add to the CRC
+ * @param p_crc - CRC of the bytes before p_data
+ * @return std::uint16_t - CRC including p_data
+ */
+[[nodiscard]] std::uint16_t crc16_modbus(std::span<hal::byte const> p_data,
+                                         std::uint16_t p_crc = 0xFFFF);
+
+/// A register served by a `modbus_rtu_server`
+struct modbus_register
+{
+  /// Register address on the bus, the 0 based protocol address
+  std::uint16_t address = 0;
+  /// Storage of the register, read and written from interrupt context
+  std::uint16_t* value = nullptr;
+  /// Accepts writes from the master, holding registers only
+  bool writable = false;
+};
+
+namespace detail {
+/// Not constexpr on purpose, calling it from a constant expression fails the
+/// compilation with this function's name in the diagnostic.
+inline void duplicate_modbus_register_address()
+{
+}
+}  // namespace detail
+
+/**
+ * @brief Register table sorted and checked at compile time
+ *
+ * The registers must have static storage duration, as their addresses are
+ * part of the constant. Usage:
+ *
+ *    // At namespace scope, or static in a function
+ *    std::uint16_t speed = 0;
+ *    std::uint16_t setpoint = 0;
+ *
+ *    constexpr hal::stm32f1::modbus_register_map holding{ std::array{
+ *      hal::stm32f1::modbus_register{ .address = 0x10, .value = &setpoint,
+ *                                     .writable = true },
+ *      hal::stm32f1::modbus_register{ .address = 0x00, .value = &speed },
+ *    } };
+ *
+ * @tparam count - number of registers in the table
+ */
+template<std::size_t count>
+struct modbus_register_map
+{
+  /**
+   * @param p_registers - registers in any order. Fails to compile if two
+   * registers share an address.
+   */
+  consteval modbus_register_map(std::array<modbus_register, count> p_registers)
+    : registers(p_registers)
+  {
+    std::ranges::sort(registers, {}, &modbus_register::address);
+    for (std::size_t i = 1; i < registers.size(); i++) {
+      if (registers[i - 1].address == registers[i].address) {
+        detail::duplicate_modbus_register_address();
+      }
+    }
+  }
+
+  /// Registers in order of increasing address
+  std::array<modbus_register, count> registers;
+};
+
+/// Sorted view of a `modbus_register_map`
+class modbus_register_table
+{
+public:
+  constexpr modbus_register_table() = default;
+
+  /**
+   * @param p_map - register map, must outlive the table
+   */
+  template<std::size_t count>
+  constexpr modbus_register_table(modbus_register_map<count> const& p_map)
+    : m_registers(p_map.registers)
+  {
+  }
+
+  /**
+   * @brief Look up a run of consecutive registers
+   *
+   * @param p_address - address of the first register
+   * @param p_count - number of registers
+   * @return std::span<modbus_register const> - the registers, empty if any
+   * address in the range is missing from the table.
+   */
+  [[nodiscard]] constexpr std::span<modbus_register const> find(
+    std::uint16_t p_address,
+    std::size_t p_count) const
+  {
+    auto const first = std::ranges::lower_bound(
+      m_registers, p_address, {}, &modbus_register::address);
+    auto const index =
+      static_cast<std::size_t>(first - m_registers.begin());
+    if (p_count == 0 || index + p_count > m_registers.size()) {
+      return {};
+    }
+    auto const run = m_registers.subspan(index, p_count);
+    // Addresses are sorted and unique, so the run is consecutive if its last
+    // address is where the first one says it should be.
+    if (run.front().address != p_address ||
+        run.back().address != p_address + p_count - 1U) {
+      return {};
+    }
+    return run;
+  }
+
+private:
+  std::span<modbus_register const> m_registers{};
+};
+
+/// Settings of a `modbus_rtu_server`
+struct modbus_rtu_settings
+{
+  /// Address of this server on the bus, 1 to 247
+  std::uint8_t address = 1;
+  /// Baud rate the uart is configured for, used for the frame timing
+  hal::hertz baud_rate = 19'200.0f;
+  /// General purpose timer measuring the t1.5 and t3.5 gaps, timer2 to timer4
+  peripheral timer = peripheral::timer3;
+};
+
+/// Event counters of a `modbus_rtu_server`
+struct modbus_rtu_counters
+{
+  /// Frames addressed to this server or broadcast
+  std::uint32_t requests = 0;
+  /// Frames dropped due to a CRC mismatch
+  std::uint32_t crc_errors = 0;
+  /// Frames dropped due to their length or a gap of more than t1.5 within
+  /// them
+  std::uint32_t framing_errors = 0;
+  /// Requests answered with an exception response
+  std::uint32_t exceptions = 0;
+};
+
+/**
+ * @brief Modbus RTU server (slave) on a uart
+ *
+ * The end of a request is detected in hardware rather than by polling. The
+ * usart idle line interrupt fires one character after the last byte and
+ * starts a one shot timer for the rest of the t3.5 gap, with a compare
+ * event at t1.5. Data arriving between t1.5 and t3.5 voids the frame, data
+ * before t1.5 continues it.
+ *
+ * Once t3.5 has passed the request is handled in the timer interrupt: the CRC
+ * is checked on the uart's DMA receive buffer in place, registers are looked
+ * up in the compile time tables and the response is sent with DMA. The
+ * turnaround does not depend on the application's main loop.
+ *
+ * Supported functions: read holding registers (0x03), read input registers
+ * (0x04), write single register (0x06) and write multiple registers (0x10).
+ * Others are answered with the illegal function exception.
+ *
+ * The server takes over the uart's receive buffer and idle handler.
+ */
+class modbus_rtu_server
+{
+public:
+  /// Largest RTU frame, address to CRC
+  static constexpr std::size_t max_frame_size = 256;
+
+  /**
+   * @param p_uart - uart connected to the bus
+   * @param p_holding_registers - registers for functions 0x03, 0x06 and 0x10
+   * @param p_input_registers - registers for function 0x04
+   */
+  modbus_rtu_server(uart& p_uart,
+                    modbus_register_table p_holding_registers,
+                    modbus_register_table p_input_registers = {});
+
+  modbus_rtu_server(modbus_rtu_server const&) = delete;
+  modbus_rtu_server& operator=(modbus_rtu_server const&) = delete;
+  modbus_rtu_server(modbus_rtu_server&&) = delete;
+  modbus_rtu_server& operator=(modbus_rtu_server&&) = delete;
+
+  /**
+   * @brief Start serving requests
+   *
+   * Only one server can run at a time.
+   *
+   * @param p_settings - address, baud rate and timer
+   * @return std::errc - std::errc{} on success,
+   * std::errc::argument_out_of_domain if the timer or address is not
+   * supported, std::errc::operation_not_supported if the gaps cannot be
+   * timed by the timer and std::errc::device_or_resource_busy if a server is
+   * already running or the timer is in use by another driver.
+   */
+  [[nodiscard]] std::errc try_start(modbus_rtu_settings const& p_settings);
+
+  /**
+   * @brief Stop serving requests
+   */
+  void stop();
+
+  /**
+   * @return modbus_rtu_counters const& - event counters
+   */
+  [[nodiscard]] modbus_rtu_counters const& counters() const
+  {
+    return m_counters;
+  }
+
+  /**
+   * @brief Handle a request frame
+   *
+   * Called by the timer interrupt once t3.5 has passed after a frame.
+   *
+   * @param p_frame - the frame from the address to the CRC, in up to two
+   * pieces
+   * @return std::span<hal::byte const> - response to send, empty if there is
+   * none
+   */
+  std::span<hal::byte const> handle(
+    std::array<std::span<hal::byte const>, 2> p_frame);
+
+  /**
+   * @brief Note the end of a burst of received bytes
+   *
+   * Called by the usart idle line interrupt.
+   */
+  void receive_idle();
+
+  /**
+   * @brief Handle a timer event after a burst
+   *
+   * Called by the timer interrupt.
+   *
+   * @param p_t1_5 - true for the t1.5 event, false for t3.5
+   */
+  void gap_elapsed(bool p_t1_5);
+
+  ~modbus_rtu_server();
+
+private:
+  std::size_t unread_bytes();
+
+  uart* m_uart;
+  modbus_register_table m_holding_registers;
+  modbus_register_table m_input_registers;
+  modbus_rtu_counters m_counters{};
+  std::array<hal::byte, max_frame_size> m_response{};
+  std::size_t m_size_at_idle = 0;
+  std::size_t m_size_at_t1_5 = 0;
+  peripheral m_timer = peripheral::timer3;
+  std::uint8_t m_address = 1;
+  bool m_running = false;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <libhal/initializers.hpp>
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+#include "pin.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Update a CRC-8/MAXIM as used by 1-Wire ROM codes and scratchpads
+ *
+ * Polynomial 0x31 reflected, initial value 0. The CRC over data followed by
+ * its CRC byte is 0.
+ *
+ * @param p_data - bytes to add to the CRC
+ * @param p_crc - CRC of the bytes before p_data
+ * @return std::uint8_t - CRC including p_data
+ */
+[[nodiscard]] std::uint8_t crc8_maxim(std::span<hal::byte const> p_data,
+                                      std::uint8_t p_crc = 0);
+
+/**
+ * @brief 1-Wire bus master on a usart in half-duplex mode
+ *
+ * Each 1-Wire time slot is one usart byte at 115200 baud sent on the TX pin,
+ * which is wired to the bus with an external pull-up. 0xFF holds the bus low
+ * for the start bit only, a write 1 or read slot, and 0x00 for 78us, a
+ * write 0 slot. The echo received on the same pin reads back the bus, any
+ * bit pulled low by a device turns a 0xFF into a 0 bit. The reset pulse is a
+ * 0xF0 at 9600 baud whose echo is changed by the presence pulses.
+ *
+ * Whole transactions of slots are moved by the usart's DMA channels while
+ * the core sleeps with WFI and interrupts enabled, so nothing is timed by the
+ * CPU and other interrupts are never held off. The receive DMA complete
+ * interrupt ends each transfer.
+ *
+ * The usart port and its DMA channels are used exclusively, a `uart` cannot be
+ * constructed on the same port while the `one_wire` exists.
+ */
+class one_wire
+{
+public:
+  /// 64-bit ROM code: family code, 48-bit serial number and CRC
+  using rom_code = std::array<hal::byte, 8>;
+
+  /**
+   * @brief Construct a 1-Wire master
+   *
+   * @param p_port - usart port, 1 to 3
+   * @param p_pins - pins of the port, the bus is on the TX pin
+   */
+  one_wire(hal::port_param auto p_port, uart_pins p_pins = uart_pins::standard)
+    : one_wire(p_port(), p_pins)
+  {
+    static_assert(1 <= p_port() and p_port() <= 3,
+                  "stm32f1 only supports ports from 1 to 3");
+  }
+
+  /**
+   * @brief Construct a 1-Wire master using runtime values
+   *
+   * @param p_port - usart port, 1 to 3
+   * @param p_pins - pins of the port, the bus is on the TX pin
+   * @throws hal::operation_not_supported - if the port or pins are not
+   * supported or the slot timing cannot be generated from the usart clock.
+   * @throws hal::device_or_resource_busy - if the port's DMA channels are
+   * claimed, by a `uart` on the same port for example.
+   */
+  one_wire(hal::runtime,
+           std::uint8_t p_port,
+           uart_pins p_pins = uart_pins::standard);
+
+  one_wire(one_wire const&) = delete;
+  one_wire& operator=(one_wire const&) = delete;
+  one_wire(one_wire&&) = delete;
+  one_wire& operator=(one_wire&&) = delete;
+  ~one_wire();
+
+  /**
+   * @brief Send a reset pulse
+   *
+   * @return true - at least one device answered with a presence pulse
+   * @return false - no device is on the bus
+   */
+  [[nodiscard]] bool reset();
+
+  /**
+   * @brief Write bytes, least significant bit first
+   *
+   * @param p_data - bytes to write
+   */
+  void write(std::span<hal::byte const> p_data);
+
+  /**
+   * @brief Read bytes, least significant bit first
+   *
+   * @param p_data - buffer to fill
+   * @return std::span<hal::byte> - the bytes read, all of p_data
+   */
+  std::span<hal::byte> read(std::span<hal::byte> p_data);
+
+  /**
+   * @brief Reset the bus and address a single device (Match ROM)
+   *
+   * @param p_rom - ROM code of the device
+   * @return true - a device answered the reset
+   * @return false - no device is on the bus
+   */
+  [[nodiscard]] bool select(rom_code const& p_rom);
+
+  /**
+   * @brief Reset the bus and address every device (Skip ROM)
+   *
+   * @return true - a device answered the reset
+   * @return false - no device is on the bus
+   */
+  [[nodiscard]] bool select_all();
+
+  /**
+   * @brief Find the ROM codes of the devices on the bus (Search ROM)
+   *
+   * Runs the binary tree search of Maxim application note 187. Each ROM bit
+   * takes one DMA transfer of three slots: the direction chosen for the bit
+   * before and the two reads of the bit.
+   *
+   * @param p_roms - buffer for the ROM codes found
+   * @param p_alarm_only - find only the devices with an alarm condition
+   * (Alarm Search)
+   * @return std::size_t - number of ROM codes written to p_roms. The search
+   * stops early if the buffer is full, no device answers or a ROM code fails
+   * its CRC.
+   */
+  std::size_t search(std::span<rom_code> p_roms, bool p_alarm_only = false);
+
+private:
+  one_wire(std::uint8_t p_port, uart_pins p_pins);
+
+  void transfer(std::span<hal::byte> p_slots);
+
+  void* m_usart;
+  std::size_t m_index;
+  peripheral m_id;
+  std::uint8_t m_tx_dma;
+  std::uint8_t m_rx_dma;
+  std::uint16_t m_reset_divider;
+  std::uint16_t m_slot_divider;
+  /// One slot per bit of up to 8 bytes
+  std::array<hal::byte, 64> m_slots{};
+};
+}  // namespace hal::stm32f1
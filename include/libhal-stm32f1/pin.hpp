@@ -57,4 +57,24 @@ enum class can_pins : std::uint8_t
   pb9_pb8 = 0b10,
   pd0_pd1 = 0b11,
 };
+
+/**
+ * @brief Remap pins for the usart peripherals
+ *
+ *    | port | pins       | TX   | RX   | CTS  | RTS  |
+ *    |------|------------|------|------|------|------|
+ *    | 1    | standard   | PA9  | PA10 | PA11 | PA12 |
+ *    | 1    | remap      | PB6  | PB7  | PA11 | PA12 |
+ *    | 2    | standard   | PA2  | PA3  | PA0  | PA1  |
+ *    | 2    | remap      | PD5  | PD6  | PD3  | PD4  |
+ *    | 3    | standard   | PB10 | PB11 | PB13 | PB14 |
+ *    | 3    | remap      | PC10 | PC11 | PB13 | PB14 |
+ *    | 3    | full_remap | PD8  | PD9  | PD11 | PD12 |
+ */
+enum class uart_pins : std::uint8_t
+{
+  standard = 0b00,
+  remap = 0b01,
+  full_remap = 0b11,
+};
 }  // namespace hal::stm32f1
@@ -1,31 +1,90 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <system_error>
 
+#include <libhal/functional.hpp>
 #include <libhal/initializers.hpp>
 #include <libhal/serial.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
 
+#include "async.hpp"
 #include "constants.hpp"
 #include "dma.hpp"
+#include "pin.hpp"
 
 namespace hal::stm32f1 {
+/// Flow control modes of the uart
+enum class uart_flow_control : std::uint8_t
+{
+  /// Received bytes are lost if the buffer is not read in time
+  none,
+  /// The transmitter waits for CTS and RTS is deasserted while the receive
+  /// buffer is above its high water mark
+  rts_cts,
+};
+
+/// uart options beyond `hal::serial::settings`
+struct uart_options
+{
+  /// Pins of the port, see `uart_pins`
+  uart_pins pins = uart_pins::standard;
+  /// Flow control mode
+  uart_flow_control flow_control = uart_flow_control::none;
+  /// Unread bytes in the receive buffer at which RTS is deasserted. RTS is
+  /// asserted again once half of them have been read. The fill level is
+  /// only checked at every half and full buffer, or segment of a large
+  /// buffer, written by the DMA and on every read. Up to half of the buffer
+  /// may thus arrive between two checks, on top of the mark, and the bytes
+  /// the sender has in flight once RTS is deasserted need room after that.
+  /// The mark is therefore capped at 3/8 of the buffer, which is also what 0
+  /// selects, leaving 1/8 of the buffer for bytes in flight.
+  std::uint16_t high_water_mark = 0;
+};
+
+/// Patterns `uart::autobaud()` measures the bit time from
+enum class uart_autobaud_pattern : std::uint8_t
+{
+  /// The start bit of the first byte, which must have its least significant
+  /// bit set. The byte is dropped.
+  start_bit,
+  /// A 0x55 sync byte, measured across the 8 bit times between its first and
+  /// last falling edge. The sync byte is consumed, the bytes after it are
+  /// received at the detected rate.
+  sync_byte,
+};
+
 class uart final : public hal::serial
 {
 public:
   /**
    * @brief Construct a new uart object
    *
+   * Receive buffers larger than `max_dma_length` are split into segments of
+   * equal size. The DMA fills them one after another and its transfer
+   * complete interrupt moves it on to the next segment, the buffer is still
+   * read as one ring. The interrupt must be served within a character time.
+   *
    * @param p_port - desired port number
    * @param p_buffer - receive buffer size (statically allocated buffer)
    * @param p_settings - initial serial settings
+   * @param p_options - pins and flow control
    */
   uart(hal::port_param auto p_port,
        hal::buffer_param auto p_buffer,
-       serial::settings const& p_settings = {})
-    : uart(p_port(), hal::create_unique_static_buffer(p_buffer), p_settings)
+       serial::settings const& p_settings = {},
+       uart_options const& p_options = {})
+    : uart(p_port(),
+           hal::create_unique_static_buffer(p_buffer),
+           p_settings,
+           p_options)
   {
-    static_assert(p_buffer() <= max_dma_length,
-                  "Buffer size cannot exceed 65,535 bytes,");
+    static_assert(p_buffer() > 0, "Buffer size must be at least 1 byte");
     static_assert(1 <= p_port() and p_port() <= 3,
                   "stm32f1 only supports ports from 1 to 3");
   }
@@ -34,32 +93,153 @@ public:
    * @brief Construct a new uart object using runtime values
    *
    * @param p_port - runtime value for p_port
-   * @param p_buffer - external buffer to be used as the receive buffer
+   * @param p_buffer - external buffer to be used as the receive buffer, may
+   * exceed `max_dma_length`, see the constructor above
    * @param p_settings - initial serial settings
-   * @throws hal::operation_not_supported - if the port is not supported or the
-   * buffer is outside of the maximum dma length.
+   * @param p_options - pins and flow control
+   * @throws hal::operation_not_supported - if the port is not supported, the
+   * buffer is empty or the pins are not available on the port.
+   * @throws hal::device_or_resource_busy - if the port's DMA channels are
+   * claimed by another driver.
    */
   uart(hal::runtime,
        std::uint8_t p_port,
        std::span<hal::byte> p_buffer,
-       serial::settings const& p_settings = {});
+       serial::settings const& p_settings = {},
+       uart_options const& p_options = {});
+
+  uart(uart const&) = delete;
+  uart& operator=(uart const&) = delete;
+  uart(uart&&) = delete;
+  uart& operator=(uart&&) = delete;
+  ~uart() override;
+
+  /**
+   * @brief Non-throwing version of `configure()`
+   *
+   * @param p_settings - serial settings to apply
+   * @return std::errc - std::errc{} on success,
+   * std::errc::operation_not_supported if the baud rate cannot be generated
+   * from the uart peripheral clock. The current settings are kept on failure.
+   */
+  [[nodiscard]] std::errc try_configure(serial::settings const& p_settings);
+
+  /**
+   * @brief Measure the baud rate of the peer and switch to it
+   *
+   * The receiver is turned off while a timer captures the edges of the
+   * pattern on the RX pin. The baud rate register is then computed from the
+   * measured bit time in whole usart clock cycles and the receiver is turned
+   * back on at the end of the pattern. The receive buffer is emptied.
+   *
+   * The RX pin is shared with timer1 channel 3 on port 1, timer4 channel 2 on
+   * port 1 remapped and timer2 channel 4 on ports 2 and 3. The timer is
+   * claimed for the duration of the call. Other pin maps have no timer channel
+   * on RX.
+   *
+   * Edges are collected by polling, which keeps up with rates of about
+   * 1 Mbit/s at 72 MHz.
+   *
+   * @param p_clock - clock used for the timeout
+   * @param p_pattern - what the peer sends first
+   * @param p_timeout - time to wait for the pattern
+   * @return std::optional<hal::hertz> - measured baud rate, std::nullopt if
+   * the pattern did not arrive in time, an edge was missed, the rate cannot be
+   * generated, the RX pin has no timer channel or the timer is in use by
+   * another driver. The settings are kept on failure.
+   */
+  [[nodiscard]] std::optional<hal::hertz> autobaud(
+    hal::steady_clock& p_clock,
+    uart_autobaud_pattern p_pattern = uart_autobaud_pattern::sync_byte,
+    hal::time_duration p_timeout = std::chrono::seconds(1));
+
+  /**
+   * @brief Write data using DMA without blocking the CPU
+   *
+   * The awaiting coroutine is resumed once the DMA transfer complete interrupt
+   * fires. The data must remain valid until the transfer has completed.
+   *
+   * Usage:
+   *
+   *    auto sent = co_await uart.write_async(data);
+   *
+   * @param p_data - data to be transmitted, at most `max_dma_length` bytes
+   * are transmitted.
+   * @return async_result<std::span<hal::byte const>> - awaitable that returns
+   * the portion of the data that was transmitted.
+   */
+  async_result<std::span<hal::byte const>> write_async(
+    std::span<hal::byte const> p_data);
+
+  /**
+   * @brief Set the handler called when the RX line goes idle
+   *
+   * Called from the usart interrupt once the line has stayed high for a
+   * whole character after receiving data, which marks the end of a burst.
+   * The received bytes are already in the receive buffer by then.
+   *
+   * @param p_handler - handler for the idle line, an empty callback turns the
+   * interrupt off.
+   */
+  void on_receive_idle(hal::callback<void()> p_handler);
+
+  /**
+   * @brief Set the handler called as the DMA fills the receive buffer
+   *
+   * Called from the DMA interrupt each time half of the receive buffer, or of
+   * a segment of a large buffer, has been filled. Together with
+   * `on_receive_idle()` this notices received data without polling, even
+   * when a continuous stream never lets the line go idle.
+   *
+   * @param p_handler - handler for the fill events, an empty callback turns
+   * the events off.
+   */
+  void on_receive_progress(hal::callback<void()> p_handler);
+
+  /**
+   * @brief Unread bytes of the receive buffer, in place
+   *
+   * Lets parsers work on the bytes the DMA has written without copying them
+   * out with `read()`. The bytes stay valid until they are consumed or the
+   * DMA laps the buffer.
+   *
+   * @return std::array<std::span<hal::byte const>, 2> - unread bytes in the
+   * order received. The second span holds the bytes from the start of the
+   * buffer when the unread bytes wrap around its end and is empty otherwise.
+   */
+  [[nodiscard]] std::array<std::span<hal::byte const>, 2> receive_view();
+
+  /**
+   * @brief Mark bytes of `receive_view()` as read
+   *
+   * @param p_count - number of bytes to release, capped at the number of
+   * unread bytes
+   */
+  void consume(std::size_t p_count);
 
 private:
   uart(std::uint8_t p_port,
        std::span<hal::byte> p_receive_buffer,
-       serial::settings const& p_settings);
+       serial::settings const& p_settings,
+       uart_options const& p_options);
 
   void driver_configure(settings const& p_settings) override;
   write_t driver_write(std::span<hal::byte const> p_data) override;
   read_t driver_read(std::span<hal::byte> p_data) override;
   void driver_flush() override;
 
-  std::uint32_t dma_cursor_position();
+  std::size_t dma_cursor_position();
+  std::size_t wrap(std::size_t p_index) const;
 
   void* m_uart;
   std::span<hal::byte> m_receive_buffer;
-  std::uint16_t m_read_index;
+  std::size_t m_read_index;
+  /// Size of the receive buffer minus one if it is a power of two, else 0
+  std::size_t m_receive_mask;
   std::uint8_t m_dma;
+  std::uint8_t m_tx_dma;
   peripheral m_id;
+  uart_pins m_pins;
+  bool m_flow_control;
 };
 }  // namespace hal::stm32f1
\ No newline at end of file
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/units.hpp>
+
+#include "uart.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Update a CRC-16/CCITT-FALSE
+ *
+ * Polynomial 0x1021, initial value 0xFFFF, not reflected. Frames carry the
+ * CRC of their payload big endian after the payload, so the CRC over a whole
+ * intact frame is 0.
+ *
+ * @param p_data - bytes to add to the CRC
+ * @param p_crc - CRC of the bytes before p_data
+ * @return std::uint16_t - CRC including p_data
+ */
+[[nodiscard]] std::uint16_t crc16_ccitt(std::span<hal::byte const> p_data,
+                                        std::uint16_t p_crc = 0xFFFF);
+
+/// A frame decoded by a `cobs_decoder` or `slip_decoder`
+struct received_frame
+{
+  /// Decoded bytes of the frame, payload followed by its CRC
+  std::span<hal::byte> data{};
+  /// The CRC over the frame checks out
+  bool crc_valid = false;
+  /// The frame was malformed or longer than the destination. Its data is
+  /// incomplete.
+  bool error = false;
+
+  /**
+   * @return std::span<hal::byte> - the frame without its CRC
+   */
+  [[nodiscard]] std::span<hal::byte> payload() const
+  {
+    return data.first(data.size() < 2 ? 0 : data.size() - 2);
+  }
+};
+
+/**
+ * @brief Incremental decoder of COBS frames delimited by 0x00
+ *
+ * Bytes are fed in as many pieces as they arrive in, a frame may be split at
+ * any byte. Runs of data bytes are copied in blocks and the CRC is updated as
+ * the frame is decoded, so no pass over the frame is needed once its
+ * delimiter arrives. Empty frames are skipped.
+ */
+class cobs_decoder
+{
+public:
+  /**
+   * @param p_destination - buffer frames are decoded into, must outlive the
+   * decoder
+   */
+  explicit cobs_decoder(std::span<hal::byte> p_destination);
+
+  /**
+   * @brief Decode bytes up to the end of the next frame
+   *
+   * @param p_input - encoded bytes
+   * @return std::size_t - number of bytes decoded. Less than the size of
+   * p_input only if a frame was completed, the rest belongs to the next
+   * frame.
+   */
+  std::size_t decode(std::span<hal::byte const> p_input);
+
+  /**
+   * @brief Take the frame completed by `decode()`
+   *
+   * @return std::optional<received_frame> - the frame or std::nullopt if its
+   * delimiter has not been decoded yet. The frame's data is valid until the
+   * next call to `decode()`.
+   */
+  std::optional<received_frame> take_frame();
+
+private:
+  std::span<hal::byte> m_destination;
+  std::size_t m_length = 0;
+  std::uint16_t m_crc = 0xFFFF;
+  std::uint8_t m_block_remaining = 0;
+  bool m_zero_pending = false;
+  bool m_error = false;
+  bool m_complete = false;
+
+  void append(std::span<hal::byte const> p_data);
+};
+
+/**
+ * @brief Incremental decoder of SLIP (RFC 1055) frames
+ *
+ * Same interface and guarantees as `cobs_decoder`. Runs of bytes without
+ * END or ESC are copied in blocks.
+ */
+class slip_decoder
+{
+public:
+  /**
+   * @param p_destination - buffer frames are decoded into, must outlive the
+   * decoder
+   */
+  explicit slip_decoder(std::span<hal::byte> p_destination);
+
+  /**
+   * @brief Decode bytes up to the end of the next frame
+   *
+   * @param p_input - encoded bytes
+   * @return std::size_t - number of bytes decoded, see
+   * `cobs_decoder::decode()`
+   */
+  std::size_t decode(std::span<hal::byte const> p_input);
+
+  /**
+   * @brief Take the frame completed by `decode()`
+   *
+   * @return std::optional<received_frame> - see `cobs_decoder::take_frame()`
+   */
+  std::optional<received_frame> take_frame();
+
+private:
+  std::span<hal::byte> m_destination;
+  std::size_t m_length = 0;
+  std::uint16_t m_crc = 0xFFFF;
+  bool m_escape = false;
+  bool m_error = false;
+  bool m_complete = false;
+
+  void append(std::span<hal::byte const> p_data);
+};
+
+/**
+ * @brief Decode the next frame straight out of the uart's receive buffer
+ *
+ * Scans the unread part of the DMA receive buffer, across its wrap around,
+ * and releases the bytes as they are decoded. Nothing is copied apart from
+ * the decoded bytes into the decoder's destination.
+ *
+ * Usage:
+ *
+ *    std::array<hal::byte, 256> frame_buffer;
+ *    hal::stm32f1::cobs_decoder decoder(frame_buffer);
+ *    while (true) {
+ *      if (auto frame = read_frame(uart, decoder); frame && frame->crc_valid) {
+ *        handle(frame->payload());
+ *      }
+ *    }
+ *
+ * @tparam decoder - `cobs_decoder` or `slip_decoder`
+ * @param p_uart - uart to read from
+ * @param p_decoder - decoder holding the partial frame between calls
+ * @return std::optional<received_frame> - the next frame or std::nullopt if
+ * its end has not been received yet.
+ */
+template<class decoder>
+std::optional<received_frame> read_frame(uart& p_uart, decoder& p_decoder)
+{
+  for (auto const part : p_uart.receive_view()) {
+    if (part.empty()) {
+      break;
+    }
+    p_uart.consume(p_decoder.decode(part));
+    if (auto frame = p_decoder.take_frame()) {
+      return frame;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Encode a frame with COBS
+ *
+ * Writes the encoded payload, its CRC and the 0x00 delimiter into the
+ * destination, which can be handed to `uart::write_async()` as is so that the
+ * DMA sends the frame from where it was encoded.
+ *
+ * @param p_payload - bytes to send
+ * @param p_destination - buffer for the encoded frame, at most
+ * `max_cobs_frame_size(p_payload.size())` bytes are used.
+ * @return std::span<hal::byte const> - the encoded frame or an empty span if
+ * the destination is too small.
+ */
+[[nodiscard]] std::span<hal::byte const> cobs_encode(
+  std::span<hal::byte const> p_payload,
+  std::span<hal::byte> p_destination);
+
+/**
+ * @param p_payload_size - number of payload bytes
+ * @return constexpr std::size_t - worst case size of the COBS encoded frame
+ * with its CRC and delimiter
+ */
+constexpr std::size_t max_cobs_frame_size(std::size_t p_payload_size)
+{
+  auto const size = p_payload_size + 2;
+  return size + (size / 254) + 2;
+}
+
+/**
+ * @brief Encode a frame with SLIP
+ *
+ * Writes an END, the escaped payload and CRC and a closing END into the
+ * destination, see `cobs_encode()`.
+ *
+ * @param p_payload - bytes to send
+ * @param p_destination - buffer for the encoded frame, at most
+ * `max_slip_frame_size(p_payload.size())` bytes are used.
+ * @return std::span<hal::byte const> - the encoded frame or an empty span if
+ * the destination is too small.
+ */
+[[nodiscard]] std::span<hal::byte const> slip_encode(
+  std::span<hal::byte const> p_payload,
+  std::span<hal::byte> p_destination);
+
+/**
+ * @param p_payload_size - number of payload bytes
+ * @return constexpr std::size_t - worst case size of the SLIP encoded frame
+ * with its CRC and END bytes
+ */
+constexpr std::size_t max_slip_frame_size(std::size_t p_payload_size)
+{
+  return ((p_payload_size + 2) * 2) + 2;
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+
+#include <libhal/functional.hpp>
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/// Settings of a `uart_receive_timeout`
+struct uart_receive_timeout_settings
+{
+  /// Baud rate the uart is configured for
+  hal::hertz baud_rate = 115'200.0f;
+  /// Bit times of silence that end a message
+  std::uint32_t silence_bits = 30;
+  /// Bits of a character on the wire: start, data, parity and stop bits
+  std::uint32_t character_bits = 10;
+  /// General purpose timer timing the silence, timer2 to timer4
+  peripheral timer = peripheral::timer4;
+  /// Input channel of the timer wired to the RX line, 1 or 2. The default is
+  /// PB7, the RX pin of usart1 with its pins remapped.
+  std::uint8_t channel = 2;
+};
+
+/**
+ * @brief Receiver timeout for a usart, which the stm32f1 usart lacks
+ *
+ * The idle line interrupt marks the end of a message after a single idle
+ * character. Protocols with longer gaps between messages than within them
+ * need a longer timeout, which this times in hardware: the RX line is wired
+ * to input channel 1 or 2 of a general purpose timer in slave reset mode, so
+ * every falling edge on the line restarts the count without the CPU. The
+ * timer overflows only once the line has been silent for the timeout, and
+ * its interrupt reports the message as complete.
+ *
+ * There are two interrupts per message and none per byte: the overflow at
+ * the end, and a trigger interrupt on the first edge of the next message
+ * that arms the overflow interrupt again.
+ *
+ * Silence is counted from the last falling edge, which is within the last
+ * character, so the timeout is the silence plus one character. A message is
+ * complete after between `silence_bits` and `silence_bits` plus one
+ * character of idle line.
+ *
+ * The RX pin of usart1 with its pins remapped, PB7, is channel 2 of timer4
+ * and needs no wiring. On the other ports the RX line must also be wired to
+ * the channel's pin, which is set up as an input with pull-up.
+ */
+class uart_receive_timeout
+{
+public:
+  uart_receive_timeout() = default;
+
+  uart_receive_timeout(uart_receive_timeout const&) = delete;
+  uart_receive_timeout& operator=(uart_receive_timeout const&) = delete;
+  uart_receive_timeout(uart_receive_timeout&&) = delete;
+  uart_receive_timeout& operator=(uart_receive_timeout&&) = delete;
+
+  /**
+   * @brief Start timing the silence on the RX line
+   *
+   * One receive timeout can run per timer.
+   *
+   * @param p_settings - timing and timer
+   * @param p_handler - called from the timer interrupt when a message is
+   * complete
+   * @return std::errc - std::errc{} on success,
+   * std::errc::argument_out_of_domain if the timer or channel is not
+   * supported, std::errc::operation_not_supported if the timeout cannot be
+   * generated by the timer and std::errc::device_or_resource_busy if the
+   * timer is already in use by this or another driver.
+   */
+  [[nodiscard]] std::errc try_start(
+    uart_receive_timeout_settings const& p_settings,
+    hal::callback<void()> p_handler);
+
+  /**
+   * @brief Stop timing, the timer is powered off
+   */
+  void stop();
+
+  /**
+   * @return std::uint32_t - number of messages completed since the start
+   */
+  [[nodiscard]] std::uint32_t completed() const
+  {
+    return m_completed;
+  }
+
+  /**
+   * @brief Arm the timeout on the first edge of a message
+   *
+   * Called by the timer interrupt.
+   */
+  void line_active();
+
+  /**
+   * @brief Report the end of a message
+   *
+   * Called by the timer interrupt once the line has been silent for the
+   * timeout.
+   */
+  void silence_elapsed();
+
+  ~uart_receive_timeout();
+
+private:
+  hal::callback<void()> m_handler{};
+  std::uint32_t m_completed = 0;
+  peripheral m_timer = peripheral::timer4;
+  bool m_running = false;
+};
+}  // namespace hal::stm32f1
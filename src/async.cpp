@@ -0,0 +1,210 @@
+#include <libhal-stm32f1/async.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-armcortex/system_control.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+/// Header placed in front of every coroutine frame allocated by the executor
+struct frame_header
+{
+  std::size_t size;
+  bool in_use;
+};
+
+constexpr std::size_t frame_alignment = alignof(std::max_align_t);
+
+constexpr std::size_t align_up(std::size_t p_value)
+{
+  return (p_value + frame_alignment - 1) & ~(frame_alignment - 1);
+}
+
+constexpr std::size_t header_size = align_up(sizeof(frame_header));
+
+async_event* event_list = nullptr;
+async_executor* active_executor = nullptr;
+std::span<hal::byte> frame_arena{};
+
+frame_header* header_at(std::size_t p_offset)
+{
+  return reinterpret_cast<frame_header*>(frame_arena.data() + p_offset);
+}
+}  // namespace
+
+async_event::async_event()
+  : m_next(event_list)
+{
+  event_list = this;
+}
+
+async_event::~async_event()
+{
+  for (auto** link = &event_list; *link != nullptr; link = &(*link)->m_next) {
+    if (*link == this) {
+      *link = m_next;
+      break;
+    }
+  }
+}
+
+async_executor::async_executor(std::span<hal::byte> p_frame_memory)
+  : m_frame_memory(p_frame_memory)
+{
+  // Align the start of the arena so every frame is suitably aligned
+  auto* start = static_cast<void*>(p_frame_memory.data());
+  auto space = p_frame_memory.size();
+  if (not std::align(frame_alignment, header_size, start, space)) {
+    space = 0;
+  }
+
+  frame_arena = { static_cast<hal::byte*>(start),
+                  space & ~(frame_alignment - 1) };
+
+  if (frame_arena.size() >= header_size) {
+    *header_at(0) = { .size = frame_arena.size(), .in_use = false };
+  } else {
+    frame_arena = {};
+  }
+
+  active_executor = this;
+}
+
+async_executor::~async_executor()
+{
+  for (auto* event = event_list; event != nullptr; event = event->m_next) {
+    event->m_waiter = {};
+  }
+  for (auto& handle : m_tasks) {
+    if (handle) {
+      handle.destroy();
+      handle = {};
+    }
+  }
+  active_executor = nullptr;
+  frame_arena = {};
+}
+
+void* async_executor::allocate(std::size_t p_size) noexcept
+{
+  if (active_executor == nullptr) {
+    return nullptr;
+  }
+
+  auto const required = header_size + align_up(p_size);
+
+  // First fit search through the arena, merging neighbouring free blocks
+  for (std::size_t offset = 0; offset < frame_arena.size();) {
+    auto* block = header_at(offset);
+
+    if (not block->in_use) {
+      auto next = offset + block->size;
+      while (next < frame_arena.size() && not header_at(next)->in_use) {
+        block->size += header_at(next)->size;
+        next = offset + block->size;
+      }
+
+      if (block->size >= required) {
+        auto const remaining = block->size - required;
+        if (remaining > header_size) {
+          block->size = required;
+          *header_at(offset + required) = { .size = remaining,
+                                            .in_use = false };
+        }
+        block->in_use = true;
+        return reinterpret_cast<hal::byte*>(block) + header_size;
+      }
+    }
+
+    offset += block->size;
+  }
+
+  return nullptr;
+}
+
+void async_executor::deallocate(void* p_frame) noexcept
+{
+  if (p_frame == nullptr) {
+    return;
+  }
+  auto* block = reinterpret_cast<frame_header*>(static_cast<hal::byte*>(p_frame) -
+                                                header_size);
+  block->in_use = false;
+}
+
+bool async_executor::spawn(task<void>&& p_task)
+{
+  if (not p_task.valid()) {
+    return false;
+  }
+
+  auto slot = std::find(m_tasks.begin(), m_tasks.end(), nullptr);
+  if (slot == m_tasks.end()) {
+    return false;
+  }
+
+  *slot = p_task.release();
+  slot->resume();
+  poll();
+  return true;
+}
+
+bool async_executor::has_ready_events()
+{
+  for (auto* event = event_list; event != nullptr; event = event->m_next) {
+    if (event->m_waiter && event->is_signaled()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t async_executor::poll()
+{
+  bool resumed = true;
+
+  // Resuming a coroutine may signal or wait on other events, so restart the
+  // scan after each resumption.
+  while (resumed) {
+    resumed = false;
+    for (auto* event = event_list; event != nullptr; event = event->m_next) {
+      if (event->m_waiter && event->is_signaled()) {
+        auto waiter = std::exchange(event->m_waiter, {});
+        waiter.resume();
+        resumed = true;
+        break;
+      }
+    }
+  }
+
+  std::size_t live_tasks = 0;
+  for (auto& handle : m_tasks) {
+    if (handle && handle.done()) {
+      handle.destroy();
+      handle = {};
+    }
+    if (handle) {
+      live_tasks++;
+    }
+  }
+
+  return live_tasks;
+}
+
+void async_executor::run()
+{
+  while (poll() != 0) {
+    // Interrupts are masked while checking for work so that an event signaled
+    // between the check and WFI still wakes the core.
+    cortex_m::disable_all_interrupts();
+    if (not has_ready_events()) {
+      cortex_m::wait_for_interrupt();
+    }
+    cortex_m::enable_all_interrupts();
+  }
+}
+}  // namespace hal::stm32f1
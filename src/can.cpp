@@ -1,4 +1,8 @@
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <span>
+#include <system_error>
 
 #include <libhal-armcortex/interrupt.hpp>
 #include <libhal-stm32f1/can.hpp>
@@ -6,12 +10,14 @@
 #include <libhal-stm32f1/interrupt.hpp>
 #include <libhal-util/bit.hpp>
 #include <libhal-util/bit_limits.hpp>
-#include <libhal-util/can.hpp>
 #include <libhal-util/enum.hpp>
 #include <libhal-util/static_callable.hpp>
 #include <libhal/error.hpp>
 
+#include "can.hpp"
 #include "can_reg.hpp"
+#include "critical_section.hpp"
+#include "exti_reg.hpp"
 #include "libhal-stm32f1/clock.hpp"
 #include "libhal-stm32f1/constants.hpp"
 #include "libhal-stm32f1/pin.hpp"
@@ -19,7 +25,15 @@
 #include "power.hpp"
 
 namespace hal::stm32f1 {
+hal::hertz can_baud_rate = 0.0f;
+can_statistics_hooks_t can_statistics_hooks{};
+
 namespace {
+/// Set once a filter bank has been configured with can::try_configure_filter
+bool can_custom_filters = false;
+/// Pins selected when the driver was constructed
+can_pins can_selected_pins = can_pins::pa11_pa12;
+
 /// Enable/Disable controller modes
 ///
 /// @param mode - which mode to enable/disable
@@ -56,42 +70,13 @@ void exit_initialization()
   }
 }
 
-void configure_baud_rate(stm32f1::can* p_can, can::settings const& p_settings)
+void write_bit_timing(can_bit_timing const& p_timing)
 {
-  auto const can_frequency = frequency(peripheral::can1);
-  auto const valid_divider =
-    calculate_can_bus_divider(can_frequency, p_settings.baud_rate);
-
-  if (not valid_divider) {
-    hal::safe_throw(hal::operation_not_supported(p_can));
-  }
-
-  auto const divisors = valid_divider.value();
-
-  auto const prescale = divisors.clock_divider - 1U;
-  auto const sync_jump_width = divisors.synchronization_jump_width - 1U;
-
-  auto phase_segment1 =
-    (divisors.phase_segment1 + divisors.propagation_delay) - 1U;
-  auto phase_segment2 = divisors.phase_segment2 - 1U;
-
-  constexpr auto segment2_bit_limit =
-    hal::bit_limits<bus_timing::time_segment2.width, std::uint32_t>::max();
-
-  // Check if phase segment 2 does not fit
-  if (phase_segment2 > segment2_bit_limit) {
-    // Take the extra time quanta and add it to the phase 1 segment
-    auto const phase_segment2_remainder = phase_segment2 - segment2_bit_limit;
-    phase_segment1 += phase_segment2_remainder;
-    // Cap phase segment 2 to the max available in the bit field
-    phase_segment2 = segment2_bit_limit;
-  }
-
   bit_modify(can1_reg->BTR)
-    .insert<bus_timing::prescalar>(prescale)
-    .insert<bus_timing::time_segment1>(phase_segment1)
-    .insert<bus_timing::time_segment2>(phase_segment2)
-    .insert<bus_timing::sync_jump_width>(sync_jump_width)
+    .insert<bus_timing::prescalar>(p_timing.prescaler - 1U)
+    .insert<bus_timing::time_segment1>(p_timing.segment1 - 1U)
+    .insert<bus_timing::time_segment2>(p_timing.segment2 - 1U)
+    .insert<bus_timing::sync_jump_width>(p_timing.sync_jump_width - 1U)
     .clear<bus_timing::silent_mode>()
     .clear<bus_timing::loop_back_mode>();
 }
@@ -170,19 +155,35 @@ void enable_acceptance_filter()
   set_filter_bank_mode(filter_bank_master_control::active);
 }
 
-struct can_data_registers_t
+}  // namespace
+
+std::errc configure_can_baud_rate(hal::hertz p_baud_rate)
 {
-  /// TFI register contents
-  uint32_t frame = 0;
-  /// TID register contents
-  uint32_t id = 0;
-  /// TDA register contents
-  uint32_t data_a = 0;
-  /// TDB register contents
-  uint32_t data_b = 0;
-};
+  // Same search as the compile time solver, so the sample point stays where
+  // it was asked for instead of moving with the segment 2 limit.
+  auto const timing = find_can_bit_timing({
+    .peripheral_frequency =
+      static_cast<std::uint32_t>(frequency(peripheral::can1)),
+    .baud_rate = static_cast<std::uint32_t>(p_baud_rate),
+  });
+
+  if (not timing || timing->baud_rate_error != 0) {
+    return std::errc::operation_not_supported;
+  }
+
+  write_bit_timing(*timing);
+
+  return {};
+}
+
+void update_can_baud_rate(hal::hertz p_baud_rate)
+{
+  can_baud_rate = p_baud_rate;
+  if (can_statistics_hooks.baud_rate) {
+    can_statistics_hooks.baud_rate(p_baud_rate);
+  }
+}
 
-/// Converts desired message to the CANx registers
 can_data_registers_t convert_message_to_stm_can(
   hal::can::message_t const& message)
 {
@@ -202,7 +203,7 @@ can_data_registers_t convert_message_to_stm_can(
         .insert<mailbox_identifier::remote_request>(message.is_remote_request)
         .insert<mailbox_identifier::identifier_type>(
           value(mailbox_identifier::id_type::extended))
-        .insert<mailbox_identifier::standard_identifier>(message.id)
+        .insert<mailbox_identifier::extended_identifier>(message.id)
         .to<std::uint32_t>();
   } else {
     frame_id =
@@ -235,9 +236,60 @@ can_data_registers_t convert_message_to_stm_can(
   return registers;
 }
 
-can::message_t read_receive_mailbox()
+namespace {
+bool is_bus_off()
+{
+  return bit_extract<error_status::bus_off>(can1_reg->ESR);
+}
+}  // namespace
+
+can::transmit_result read_transmit_result(std::uint8_t p_mailbox,
+                                          std::uint32_t p_status)
 {
-  can::message_t message;
+  auto const& registers = can1_reg->transmit_mailbox[p_mailbox];
+  auto const id = registers.TIR;
+  auto const frame = registers.TDTR;
+  auto const format = bit_extract<mailbox_identifier::identifier_type>(id);
+
+  can::transmit_result result{};
+  auto& message = result.message;
+  message.is_remote_request =
+    bit_extract<mailbox_identifier::remote_request>(id);
+  message.length = static_cast<std::uint8_t>(
+    bit_extract<frame_length_and_info::data_length_code>(frame));
+
+  if (format == value(mailbox_identifier::id_type::extended)) {
+    message.id = bit_extract<mailbox_identifier::extended_identifier>(id);
+  } else {
+    message.id = bit_extract<mailbox_identifier::standard_identifier>(id);
+  }
+
+  auto const data = std::array{ registers.TDLR, registers.TDHR };
+  for (std::size_t i = 0; i < message.payload.size(); i++) {
+    message.payload[i] =
+      static_cast<hal::byte>((data[i / 4] >> ((i % 4) * 8)) & 0xFF);
+  }
+
+  // Each mailbox has a byte of status flags in TSR, in the same layout as
+  // the flags of mailbox 0.
+  auto const flags = p_status >> (p_mailbox * 8U);
+  result.mailbox = p_mailbox;
+  result.transmitted =
+    bit_extract<transmit_status::transmission_ok_mailbox0>(flags);
+  result.arbitration_lost =
+    bit_extract<transmit_status::arbitration_lost_mailbox0>(flags);
+  result.error =
+    bit_extract<transmit_status::transmission_error_mailbox0>(flags);
+  result.timestamp = static_cast<std::uint16_t>(
+    bit_extract<frame_length_and_info::message_time_stamp>(frame));
+
+  return result;
+}
+
+can::filtered_message_t read_filtered_receive_mailbox()
+{
+  can::filtered_message_t filtered{};
+  auto& message = filtered.message;
 
   uint32_t fifo0_status = can1_reg->RF0R;
   uint32_t fifo1_status = can1_reg->RF1R;
@@ -250,7 +302,7 @@ can::message_t read_receive_mailbox()
     fifo_select = fifo_assignment::fifo2;
   } else {
     // Error, tried to receive when there were no pending messages.
-    return message;
+    return filtered;
   }
 
   uint32_t frame = can1_reg->fifo_mailbox[value(fifo_select)].RDTR;
@@ -263,6 +315,11 @@ can::message_t read_receive_mailbox()
 
   message.is_remote_request = is_remote_request;
   message.length = static_cast<std::uint8_t>(length);
+  filtered.route = {
+    .fifo = value(fifo_select),
+    .filter_match_index = static_cast<std::uint8_t>(
+      bit_extract<frame_length_and_info::filter_match_index>(frame)),
+  };
 
   // Get the frame ID
   if (format == value(mailbox_identifier::id_type::extended)) {
@@ -292,18 +349,14 @@ can::message_t read_receive_mailbox()
     bit_modify(can1_reg->RF1R).set<fifo_status::release_output_mailbox>();
   }
 
-  return message;
+  return filtered;
 }
 
-bool is_bus_off()
+can::message_t read_receive_mailbox()
 {
-  // True = Bus is in sleep mode
-  // False = Bus has left sleep mode.
-  return bit_extract<master_status::sleep_acknowledge>(can1_reg->MCR);
+  return read_filtered_receive_mailbox().message;
 }
 
-}  // namespace
-
 can::can(can::settings const& p_settings, can_pins p_pins)
 {
   power_on(peripheral::can1);
@@ -330,12 +383,34 @@ can::can(can::settings const& p_settings, can_pins p_pins)
   }
 
   remap_pins(p_pins);
+  can_selected_pins = p_pins;
 
   // Ensure we have left initialization phase so the peripheral can operate
   // correctly.
   exit_initialization();
 }
 
+void can::enable_timestamps(bool p_enable)
+{
+  enter_initialization();
+  set_master_mode(master_control::time_triggered_comm_mode, p_enable);
+  exit_initialization();
+}
+
+void can::enable_automatic_retransmission(bool p_enable)
+{
+  enter_initialization();
+  set_master_mode(master_control::no_automatic_retransmission, not p_enable);
+  exit_initialization();
+}
+
+void can::enable_transmit_fifo(bool p_enable)
+{
+  enter_initialization();
+  set_master_mode(master_control::transmit_fifo_priority, p_enable);
+  exit_initialization();
+}
+
 void can::enable_self_test(bool p_enable)
 {
   enter_initialization();
@@ -349,20 +424,58 @@ void can::enable_self_test(bool p_enable)
   exit_initialization();
 }
 
-can::~can()
+void can::enable_silent_mode(bool p_enable)
 {
-  hal::cortex_m::disable_interrupt(irq::can1_rx0);
-  power_off(peripheral::can1);
+  enter_initialization();
+  bit_modify(can1_reg->BTR).insert<bus_timing::silent_mode>(p_enable);
+  exit_initialization();
 }
 
-void can::driver_configure(can::settings const& p_settings)
+
+std::errc can::try_configure(can::settings const& p_settings)
+{
+  enter_initialization();
+
+  auto const status = configure_can_baud_rate(p_settings.baud_rate);
+  if (status == std::errc{}) {
+    if (not can_custom_filters) {
+      enable_acceptance_filter();
+    }
+    update_can_baud_rate(p_settings.baud_rate);
+  }
+
+  exit_initialization();
+
+  return status;
+}
+
+std::errc can::try_configure_bit_timing(can_bit_timing const& p_timing)
 {
+  auto const can_frequency =
+    static_cast<std::uint32_t>(frequency(peripheral::can1));
+  if (p_timing.peripheral_frequency != can_frequency ||
+      p_timing.prescaler == 0) {
+    return std::errc::invalid_argument;
+  }
+
   enter_initialization();
 
-  configure_baud_rate(this, p_settings);
-  enable_acceptance_filter();
+  write_bit_timing(p_timing);
+  if (not can_custom_filters) {
+    enable_acceptance_filter();
+  }
+  update_can_baud_rate(static_cast<hal::hertz>(p_timing.baud_rate));
 
   exit_initialization();
+
+  return {};
+}
+
+void can::driver_configure(can::settings const& p_settings)
+{
+  if (try_configure(p_settings) != std::errc{}) {
+    hal::safe_throw(hal::operation_not_supported(this));
+  }
 }
 
 void can::driver_bus_on()
@@ -375,65 +488,440 @@ void can::driver_bus_on()
   exit_initialization();
 }
 
-void can::driver_send(can::message_t const& p_message)
+namespace {
+void load_transmit_mailbox(std::size_t p_mailbox,
+                           can::message_t const& p_message)
+{
+  auto const registers = convert_message_to_stm_can(p_message);
+  auto& mailbox = can1_reg->transmit_mailbox[p_mailbox];
+
+  bit_modify(mailbox.TDTR)
+    .insert<frame_length_and_info::data_length_code>(p_message.length);
+  mailbox.TDLR = registers.data_a;
+  mailbox.TDHR = registers.data_b;
+  // Writing the identifier with the transmit request bit set goes last
+  mailbox.TIR = registers.id;
+}
+
+constexpr std::array transmit_mailbox_empty{
+  transmit_status::transmit_mailbox0_empty,
+  transmit_status::transmit_mailbox1_empty,
+  transmit_status::transmit_mailbox2_empty,
+};
+}  // namespace
+
+std::size_t load_transmit_mailboxes(std::span<can::message_t const> p_messages)
+{
+  // can_schedule loads mailboxes from its timer interrupt, so the empty
+  // mailboxes are read and filled without it running in between.
+  critical_section guard;
+  auto const status_register = can1_reg->TSR;
+  std::size_t queued = 0;
+
+  for (std::size_t mailbox = 0; mailbox < transmit_mailbox_empty.size();
+       mailbox++) {
+    if (queued == p_messages.size()) {
+      break;
+    }
+    if (bit_extract(transmit_mailbox_empty[mailbox], status_register)) {
+      load_transmit_mailbox(mailbox, p_messages[queued]);
+      queued++;
+    }
+  }
+
+  return queued;
+}
+
+std::errc can::try_send(can::message_t const& p_message)
 {
   if (is_bus_off()) {
-    hal::safe_throw(hal::operation_not_permitted(this));
+    return std::errc::operation_not_permitted;
   }
 
-  can_data_registers_t registers = convert_message_to_stm_can(p_message);
-  uint32_t status_register = can1_reg->TSR;
+  if (load_transmit_mailboxes(std::span(&p_message, 1)) == 0) {
+    return std::errc::resource_unavailable_try_again;
+  }
 
-  // Check if any buffer is available.
-  if (bit_extract<transmit_status::transmit_mailbox0_empty>(status_register)) {
-    bit_modify(can1_reg->transmit_mailbox[0].TDTR)
-      .insert<frame_length_and_info::data_length_code>(p_message.length);
-    can1_reg->transmit_mailbox[0].TDLR = registers.data_a;
-    can1_reg->transmit_mailbox[0].TDHR = registers.data_b;
-    can1_reg->transmit_mailbox[0].TIR = registers.id;
-    return;
-  } else if (bit_extract<transmit_status::transmit_mailbox1_empty>(
-               status_register)) {
-    bit_modify(can1_reg->transmit_mailbox[1].TDTR)
-      .insert<frame_length_and_info::data_length_code>(p_message.length);
-    can1_reg->transmit_mailbox[1].TDLR = registers.data_a;
-    can1_reg->transmit_mailbox[1].TDHR = registers.data_b;
-    can1_reg->transmit_mailbox[1].TIR = registers.id;
-    return;
-  } else if (bit_extract<transmit_status::transmit_mailbox2_empty>(
-               status_register)) {
-    bit_modify(can1_reg->transmit_mailbox[2].TDTR)
-      .insert<frame_length_and_info::data_length_code>(p_message.length);
-    can1_reg->transmit_mailbox[2].TDLR = registers.data_a;
-    can1_reg->transmit_mailbox[2].TDHR = registers.data_b;
-    can1_reg->transmit_mailbox[2].TIR = registers.id;
-    return;
+  return {};
+}
+
+std::size_t can::send_batch(std::span<message_t const> p_messages)
+{
+  if (is_bus_off()) {
+    return 0;
   }
 
-  hal::safe_throw(hal::resource_unavailable_try_again(this));
+  return load_transmit_mailboxes(p_messages);
+}
+
+void can::driver_send(can::message_t const& p_message)
+{
+  auto const status = try_send(p_message);
+
+  if (status == std::errc::operation_not_permitted) {
+    hal::safe_throw(hal::operation_not_permitted(this));
+  } else if (status == std::errc::resource_unavailable_try_again) {
+    hal::safe_throw(hal::resource_unavailable_try_again(this));
+  }
 }
 
 hal::callback<can::handler> can_receive_handler{};
+hal::callback<can::filtered_handler> can_filtered_receive_handler{};
+hal::callback<can::wakeup_handler> can_wakeup_handler{};
+
+namespace {
+async_event can_receive_event{};
+can::message_t can_received_message{};
+bool volatile can_receive_awaiting = false;
+}  // namespace
+
+bool is_can_message_pending()
+{
+  return bit_extract<fifo_status::messages_pending>(can1_reg->RF0R) ||
+         bit_extract<fifo_status::messages_pending>(can1_reg->RF1R);
+}
+
+namespace {
+/// Port and pin of the receive line of the selected pins
+pin_select_t receive_pin(can_pins p_pins)
+{
+  switch (p_pins) {
+    case can_pins::pb9_pb8:
+      return { .port = 'B', .pin = 8 };
+    case can_pins::pd0_pd1:
+      return { .port = 'D', .pin = 0 };
+    case can_pins::pa11_pa12:
+    default:
+      return { .port = 'A', .pin = 11 };
+  }
+}
+
+/// Set or clear the EXTI event for a falling edge on the receive line. The
+/// dominant start of frame bit of the first frame then wakes the core from
+/// Stop mode, during which the can controller itself is not clocked.
+void set_receive_line_event(bool p_enable)
+{
+  auto const pin = receive_pin(can_selected_pins);
+  auto const line = bit_mask::from(pin.pin);
+
+  if (p_enable) {
+    power_on(peripheral::afio);
+    auto const source_position = (pin.pin % 4U) * 4U;
+    auto const source = bit_mask::from(source_position, source_position + 3U);
+    bit_modify(alternative_function_io->exticr[pin.pin / 4U])
+      .insert(source, static_cast<std::uint32_t>(pin.port - 'A'));
+    bit_modify(exti_reg->ftsr).set(line);
+  }
+
+  bit_modify(exti_reg->emr).insert(line, p_enable);
+}
+
+void status_change_interrupt()
+{
+  auto const status = can1_reg->MSR;
+
+  if (not bit_extract<master_status::wakeup_interrupt>(status)) {
+    return;
+  }
+
+  // Status interrupt flags are cleared by writing a 1 to them
+  can1_reg->MSR = bit_value()
+                    .set<master_status::wakeup_interrupt>()
+                    .to<std::uint32_t>();
+  set_receive_line_event(false);
+
+  if (can_wakeup_handler) {
+    can_wakeup_handler();
+  }
+}
+}  // namespace
 
 void handler_interrupt()
 {
-  auto const message = read_receive_mailbox();
-  can_receive_handler(message);
+  if (not is_can_message_pending()) {
+    return;
+  }
+
+  auto const filtered = read_filtered_receive_mailbox();
+  auto const& message = filtered.message;
+
+  if (can_filtered_receive_handler) {
+    can_filtered_receive_handler(filtered);
+  }
+
+  if (can_statistics_hooks.record_receive) {
+    can_statistics_hooks.record_receive(message);
+  }
+
+  if (can_receive_awaiting) {
+    can_received_message = message;
+    can_receive_awaiting = false;
+    can_receive_event.signal();
+    return;
+  }
+
+  if (can_receive_handler) {
+    can_receive_handler(message);
+  }
 }
 
-void can::driver_on_receive(hal::callback<handler> p_handler)
+void enable_can_receive_interrupts()
 {
   initialize_interrupts();
-  can_receive_handler = p_handler;
 
   // Enable interrupt service routine.
   cortex_m::enable_interrupt(irq::can1_rx0, handler_interrupt);
   cortex_m::enable_interrupt(irq::can1_rx1, handler_interrupt);
-  cortex_m::enable_interrupt(irq::can1_sce, handler_interrupt);
+  cortex_m::enable_interrupt(irq::can1_sce, status_change_interrupt);
 
   bit_modify(can1_reg->IER)
     .set<interrupt_enable_register::fifo0_message_pending>();
   bit_modify(can1_reg->IER)
     .set<interrupt_enable_register::fifo1_message_pending>();
 }
+
+void can::driver_on_receive(hal::callback<handler> p_handler)
+{
+  can_receive_handler = p_handler;
+  enable_can_receive_interrupts();
+}
+
+async_result<can::message_t> can::receive()
+{
+  can_receive_event.reset();
+  can_receive_awaiting = true;
+  enable_can_receive_interrupts();
+
+  return { can_receive_event, can_received_message };
+}
+
+namespace {
+hal::callback<can::transmit_ready_handler> can_transmit_ready_handler{};
+hal::callback<can::transmit_complete_handler> can_transmit_complete_handler{};
+
+void transmit_interrupt()
+{
+  auto const status = can1_reg->TSR;
+
+  for (std::uint8_t mailbox = 0; mailbox < 3; mailbox++) {
+    auto const result = read_transmit_result(mailbox, status);
+    // The request completed flag is also set for mailboxes that were aborted
+    // or are empty after reset, thus only successful frames are counted.
+    if (result.transmitted && can_statistics_hooks.record_transmit) {
+      can_statistics_hooks.record_transmit(result.message);
+    }
+    if (can_transmit_complete_handler &&
+        bit_extract(bit_mask::from(mailbox * 8U), status)) {
+      can_transmit_complete_handler(result);
+    }
+  }
+
+  constexpr auto request_completed =
+    hal::bit_value()
+      .set<transmit_status::request_completed_mailbox0>()
+      .set<transmit_status::request_completed_mailbox1>()
+      .set<transmit_status::request_completed_mailbox2>()
+      .to<std::uint32_t>();
+
+  // Writing a 1 to a request completed bit clears it along with the mailbox's
+  // status bits, which also acknowledges the interrupt.
+  can1_reg->TSR = status & request_completed;
+
+  if (can_transmit_ready_handler) {
+    can_transmit_ready_handler();
+  }
+}
+}  // namespace
+
+void enable_can_transmit_interrupt()
+{
+  initialize_interrupts();
+
+  cortex_m::enable_interrupt(irq::can1_tx, transmit_interrupt);
+
+  bit_modify(can1_reg->IER)
+    .set<interrupt_enable_register::transmit_mailbox_empty>();
+}
+
+void can::on_transmit_ready(hal::callback<transmit_ready_handler> p_handler)
+{
+  can_transmit_ready_handler = p_handler;
+  enable_can_transmit_interrupt();
+}
+
+void can::on_transmit_complete(
+  hal::callback<transmit_complete_handler> p_handler)
+{
+  can_transmit_complete_handler = p_handler;
+  enable_can_transmit_interrupt();
+}
+
+void can::on_filtered_receive(hal::callback<filtered_handler> p_handler)
+{
+  can_filtered_receive_handler = p_handler;
+  enable_can_receive_interrupts();
+}
+
+std::errc can::try_configure_filter(std::uint8_t p_bank,
+                                    filter_t const& p_filter)
+{
+  if (p_bank >= filter_bank_count || p_filter.fifo > 1) {
+    return std::errc::argument_out_of_domain;
+  }
+
+  auto const bank = bit_mask::from(p_bank);
+  std::uint32_t identifier = 0;
+  std::uint32_t mask = 0;
+
+  // The filter registers share the layout of the receive identifier register.
+  // The identifier type and remote request bits are matched as well, so that
+  // standard and extended filters never match each other's frames.
+  if (p_filter.extended) {
+    identifier = bit_value(0U)
+                   .insert<mailbox_identifier::extended_identifier>(p_filter.id)
+                   .insert<mailbox_identifier::identifier_type>(
+                     value(mailbox_identifier::id_type::extended))
+                   .to<std::uint32_t>();
+    mask = bit_value(0U)
+             .insert<mailbox_identifier::extended_identifier>(p_filter.mask)
+             .set<mailbox_identifier::identifier_type>()
+             .to<std::uint32_t>();
+  } else {
+    identifier = bit_value(0U)
+                   .insert<mailbox_identifier::standard_identifier>(p_filter.id)
+                   .to<std::uint32_t>();
+    mask = bit_value(0U)
+             .insert<mailbox_identifier::standard_identifier>(p_filter.mask)
+             .set<mailbox_identifier::identifier_type>()
+             .to<std::uint32_t>();
+  }
+
+  set_filter_bank_mode(filter_bank_master_control::initialization);
+
+  if (not can_custom_filters) {
+    // Drop the default accept all filter. Every bank is switched to a single
+    // 32-bit mask filter so that each bank accounts for one filter match
+    // index.
+    can1_reg->FA1R = 0;
+    can1_reg->FM1R = 0;
+    can1_reg->FS1R = hal::bit_limits<filter_bank_count, std::uint32_t>::max();
+    can_custom_filters = true;
+  }
+
+  bit_modify(can1_reg->FA1R).clear(bank);
+  can1_reg->sFilterRegister[p_bank].FR1 = identifier;
+  can1_reg->sFilterRegister[p_bank].FR2 = mask;
+  bit_modify(can1_reg->FFA1R).insert(bank, p_filter.fifo);
+  bit_modify(can1_reg->FA1R).set(bank);
+
+  set_filter_bank_mode(filter_bank_master_control::active);
+
+  return {};
+}
+
+void can::disable_filter(std::uint8_t p_bank)
+{
+  if (p_bank >= filter_bank_count) {
+    return;
+  }
+
+  set_filter_bank_mode(filter_bank_master_control::initialization);
+  bit_modify(can1_reg->FA1R).clear(bit_mask::from(p_bank));
+  set_filter_bank_mode(filter_bank_master_control::active);
+}
+
+can::filter_route can::route(std::uint8_t p_bank)
+{
+  auto const assignments = can1_reg->FFA1R;
+  auto const scales = can1_reg->FS1R;
+  auto const modes = can1_reg->FM1R;
+  auto const fifo = static_cast<std::uint8_t>(
+    bit_extract(bit_mask::from(p_bank), assignments));
+
+  std::uint32_t index = 0;
+  for (std::uint8_t bank = 0; bank < p_bank; bank++) {
+    auto const bank_mask = bit_mask::from(bank);
+    if (bit_extract(bank_mask, assignments) != fifo) {
+      continue;
+    }
+    // A bank holds 1 to 4 filters depending on its scale and mode
+    bool const single_32_bit = bit_extract(bank_mask, scales);
+    bool const list_mode = bit_extract(bank_mask, modes);
+    std::uint32_t filters = single_32_bit ? 1U : 2U;
+    index += list_mode ? filters * 2U : filters;
+  }
+
+  return {
+    .fifo = fifo,
+    .filter_match_index = static_cast<std::uint8_t>(index),
+  };
+}
+
+std::errc can::try_sleep()
+{
+  constexpr auto all_mailboxes_empty =
+    hal::bit_value()
+      .set<transmit_status::transmit_mailbox0_empty>()
+      .set<transmit_status::transmit_mailbox1_empty>()
+      .set<transmit_status::transmit_mailbox2_empty>()
+      .to<std::uint32_t>();
+
+  if ((can1_reg->TSR & all_mailboxes_empty) != all_mailboxes_empty) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  set_master_mode(master_control::automatic_wakeup_mode, true);
+
+  initialize_interrupts();
+  cortex_m::enable_interrupt(irq::can1_sce, status_change_interrupt);
+  bit_modify(can1_reg->IER).set<interrupt_enable_register::wakeup>();
+  set_receive_line_event(true);
+
+  bit_modify(can1_reg->MCR)
+    .clear<master_control::initialization_request>()
+    .set<master_control::sleep_mode_request>();
+
+  return {};
+}
+
+bool can::is_sleeping()
+{
+  return get_master_status(master_status::sleep_acknowledge);
+}
+
+void can::wake()
+{
+  set_master_mode(master_control::sleep_mode_request, false);
+  set_receive_line_event(false);
+}
+
+can::~can()
+{
+  // The receive line event is only armed by try_sleep(), along with the
+  // wakeup interrupt
+  if (bit_extract<interrupt_enable_register::wakeup>(can1_reg->IER)) {
+    set_receive_line_event(false);
+  }
+  can1_reg->IER = 0;
+  hal::cortex_m::disable_interrupt(irq::can1_rx0);
+  hal::cortex_m::disable_interrupt(irq::can1_rx1);
+  hal::cortex_m::disable_interrupt(irq::can1_sce);
+  hal::cortex_m::disable_interrupt(irq::can1_tx);
+  power_off(peripheral::can1);
+
+  // The handlers and statistics belong to the application of this driver,
+  // a later driver must not call into them.
+  can_receive_handler = {};
+  can_filtered_receive_handler = {};
+  can_wakeup_handler = {};
+  can_transmit_ready_handler = {};
+  can_transmit_complete_handler = {};
+  can_statistics_hooks = {};
+  can_receive_awaiting = false;
+}
+
+void can::on_wakeup(hal::callback<wakeup_handler> p_handler)
+{
+  can_wakeup_handler = p_handler;
+}
 }  // namespace hal::stm32f1
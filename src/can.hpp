@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+
+#include <libhal/can.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+#include <libhal-stm32f1/can.hpp>
+
+namespace hal::stm32f1 {
+/// Baud rate of the most recent successful configuration
+extern hal::hertz can_baud_rate;
+
+/// Hooks feeding the statistics attached with `can::attach_statistics()`.
+/// Only `can_statistics.cpp` sets them, so drivers without statistics do not
+/// link the statistics code.
+struct can_statistics_hooks_t
+{
+  void (*record_receive)(hal::can::message_t const& p_message) = nullptr;
+  void (*record_transmit)(hal::can::message_t const& p_message) = nullptr;
+  void (*baud_rate)(hal::hertz p_baud_rate) = nullptr;
+};
+
+extern can_statistics_hooks_t can_statistics_hooks;
+
+/**
+ * @brief Program the bit timing of a baud rate
+ *
+ * The controller must be in initialization mode.
+ *
+ * @param p_baud_rate - baud rate to program
+ * @return std::errc - std::errc::operation_not_supported if the baud rate
+ * cannot be reached exactly from the can peripheral clock
+ */
+std::errc configure_can_baud_rate(hal::hertz p_baud_rate);
+
+/**
+ * @brief Record the baud rate the controller now runs at
+ *
+ * Passes the baud rate on to the attached statistics.
+ *
+ * @param p_baud_rate - baud rate programmed into the controller
+ */
+void update_can_baud_rate(hal::hertz p_baud_rate);
+
+/**
+ * @brief Check the receive FIFOs for messages
+ *
+ * @return true - a message is pending in FIFO 0 or FIFO 1
+ */
+bool is_can_message_pending();
+
+/**
+ * @brief Enable the receive FIFO and status change interrupts
+ */
+void enable_can_receive_interrupts();
+
+/**
+ * @brief Enable the transmit mailbox empty interrupt
+ */
+void enable_can_transmit_interrupt();
+
+/// Contents of the registers of a transmit mailbox
+struct can_data_registers_t
+{
+  /// TDTR register contents
+  std::uint32_t frame = 0;
+  /// TIR register contents including the transmit request bit
+  std::uint32_t id = 0;
+  /// TDLR register contents
+  std::uint32_t data_a = 0;
+  /// TDHR register contents
+  std::uint32_t data_b = 0;
+};
+
+/**
+ * @brief Encode a message into the registers of a transmit mailbox
+ *
+ * @param message - message to encode
+ * @return can_data_registers_t - register contents, writing the id register
+ * last requests the transmission.
+ */
+can_data_registers_t convert_message_to_stm_can(
+  hal::can::message_t const& message);
+
+/**
+ * @brief Read back the frame and the outcome of a transmit request
+ *
+ * @param p_mailbox - transmit mailbox, 0 to 2
+ * @param p_status - contents of the transmit status register (TSR)
+ * @return can::transmit_result - frame in the mailbox and its status flags
+ */
+can::transmit_result read_transmit_result(std::uint8_t p_mailbox,
+                                          std::uint32_t p_status);
+
+/**
+ * @brief Load messages into the empty transmit mailboxes
+ *
+ * The mailboxes are picked and loaded with interrupts masked, so a
+ * `can_schedule` tick cannot take the same mailbox in between.
+ *
+ * @param p_messages - messages to load, in order
+ * @return std::size_t - number of messages loaded, the rest found every
+ * mailbox full
+ */
+std::size_t load_transmit_mailboxes(
+  std::span<hal::can::message_t const> p_messages);
+
+/**
+ * @brief Read the oldest message out of the receive FIFOs
+ *
+ * FIFO 0 is checked before FIFO 1. The FIFO output mailbox is released after
+ * the message has been read out.
+ *
+ * @return can::message_t - the received message. If no messages are pending,
+ * a default initialized message is returned.
+ */
+hal::can::message_t read_receive_mailbox();
+
+/**
+ * @brief Read the oldest message out of the receive FIFOs along with the
+ * filter that accepted it
+ *
+ * Behaves like `read_receive_mailbox()`.
+ *
+ * @return can::filtered_message_t - the received message and its route
+ */
+can::filtered_message_t read_filtered_receive_mailbox();
+
+/**
+ * @brief Implementation of `can::autobaud()`
+ *
+ * @param p_clock - clock used to bound the time spent at each rate
+ * @param p_candidates - bit rates to try, in order of likelihood
+ * @param p_listen_time - time to wait for traffic at each rate
+ * @return std::optional<hal::hertz> - the detected bit rate
+ */
+std::optional<hal::hertz> detect_baud_rate(
+  hal::steady_clock& p_clock,
+  std::span<hal::hertz const> p_candidates,
+  hal::time_duration p_listen_time);
+}  // namespace hal::stm32f1
@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+
+#include <libhal-stm32f1/can.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+#include <libhal/steady_clock.hpp>
+
+#include "can.hpp"
+#include "can_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Wait for the controller to acknowledge entering or leaving initialization
+/// mode. Leaving requires 11 recessive bits on the bus, which a busy bus at
+/// the wrong bit rate may never provide, hence the deadline.
+bool wait_for_initialization(bool p_initialization,
+                             hal::steady_clock& p_clock,
+                             std::uint64_t p_deadline)
+{
+  bit_modify(can1_reg->MCR)
+    .insert<master_control::initialization_request>(p_initialization);
+  while (bit_extract<master_status::initialization_acknowledge>(
+           can1_reg->MSR) != p_initialization) {
+    if (p_clock.uptime() >= p_deadline) {
+      return false;
+    }
+  }
+  return true;
+}
+
+enum class autobaud_result : std::uint8_t
+{
+  /// A frame was received without error
+  match,
+  /// A frame was received with a stuff, form or CRC error
+  mismatch,
+  /// No traffic within the listen time
+  silent,
+};
+
+autobaud_result listen_at(hal::hertz p_baud_rate,
+                          hal::steady_clock& p_clock,
+                          std::uint64_t p_listen_ticks)
+{
+  auto const deadline = p_clock.uptime() + p_listen_ticks;
+
+  if (not wait_for_initialization(true, p_clock, deadline)) {
+    return autobaud_result::silent;
+  }
+
+  if (configure_can_baud_rate(p_baud_rate) != std::errc{}) {
+    return autobaud_result::mismatch;
+  }
+  bit_modify(can1_reg->BTR).set<bus_timing::silent_mode>();
+
+  // Hardware only ever writes error codes 0 to 6, thus a value of 7 shows
+  // that no frame has been seen since.
+  bit_modify(can1_reg->ESR)
+    .insert<error_status::last_error_code>(
+      value(error_status::error_code::set_by_software));
+
+  if (not wait_for_initialization(false, p_clock, deadline)) {
+    return autobaud_result::silent;
+  }
+
+  while (p_clock.uptime() < deadline) {
+    if (is_can_message_pending()) {
+      return autobaud_result::match;
+    }
+
+    auto const error_code = static_cast<error_status::error_code>(
+      bit_extract<error_status::last_error_code>(can1_reg->ESR));
+
+    switch (error_code) {
+      case error_status::error_code::no_error:
+        return autobaud_result::match;
+      case error_status::error_code::stuff_error:
+      case error_status::error_code::form_error:
+      case error_status::error_code::crc_error:
+        return autobaud_result::mismatch;
+      default:
+        break;
+    }
+  }
+
+  return autobaud_result::silent;
+}
+}  // namespace
+
+std::optional<hal::hertz> detect_baud_rate(
+  hal::steady_clock& p_clock,
+  std::span<hal::hertz const> p_candidates,
+  hal::time_duration p_listen_time)
+{
+  auto const clock_frequency = static_cast<std::uint64_t>(p_clock.frequency());
+  auto const listen_ticks =
+    (clock_frequency * static_cast<std::uint64_t>(p_listen_time.count())) /
+    1'000'000'000ULL;
+  auto const previous_baud_rate = can_baud_rate;
+  std::optional<hal::hertz> detected{};
+
+  auto const try_candidate = [&](hal::hertz p_baud_rate) {
+    if (listen_at(p_baud_rate, p_clock, listen_ticks) ==
+        autobaud_result::match) {
+      detected = p_baud_rate;
+    }
+  };
+
+  // The rate used before is the most likely one
+  if (previous_baud_rate > 0.0f) {
+    try_candidate(previous_baud_rate);
+  }
+
+  for (auto const candidate : p_candidates) {
+    if (detected) {
+      break;
+    }
+    if (candidate != previous_baud_rate) {
+      try_candidate(candidate);
+    }
+  }
+
+  // Leave silent mode at the detected rate, or return to where we started
+  auto const baud_rate = detected.value_or(previous_baud_rate);
+  auto const deadline = p_clock.uptime() + listen_ticks;
+  if (wait_for_initialization(true, p_clock, deadline)) {
+    if (configure_can_baud_rate(baud_rate) == std::errc{}) {
+      update_can_baud_rate(baud_rate);
+    }
+    (void)wait_for_initialization(false, p_clock, deadline);
+  }
+
+  return detected;
+}
+
+std::optional<hal::hertz> can::autobaud(
+  hal::steady_clock& p_clock,
+  std::span<hal::hertz const> p_candidates,
+  hal::time_duration p_listen_time)
+{
+  return detect_baud_rate(p_clock, p_candidates, p_listen_time);
+}
+}  // namespace hal::stm32f1
@@ -8,24 +8,24 @@ namespace hal::stm32f1 {
 
 struct can_tx_mailbox_t
 {
-  std::uint32_t TIR;
-  std::uint32_t TDTR;
-  std::uint32_t TDLR;
-  std::uint32_t TDHR;
+  std::uint32_t volatile TIR;
+  std::uint32_t volatile TDTR;
+  std::uint32_t volatile TDLR;
+  std::uint32_t volatile TDHR;
 };
 
 struct can_fifo_mailbox_t
 {
-  std::uint32_t RIR;
-  std::uint32_t RDTR;
-  std::uint32_t RDLR;
-  std::uint32_t RDHR;
+  std::uint32_t volatile RIR;
+  std::uint32_t volatile RDTR;
+  std::uint32_t volatile RDLR;
+  std::uint32_t volatile RDHR;
 };
 
 struct can_filter_register_t
 {
-  std::uint32_t FR1;
-  std::uint32_t FR2;
+  std::uint32_t volatile FR1;
+  std::uint32_t volatile FR2;
 };
 
 /**
@@ -34,26 +34,26 @@ struct can_filter_register_t
 
 struct can_reg_t
 {
-  std::uint32_t MCR;
-  std::uint32_t MSR;
-  std::uint32_t TSR;
-  std::uint32_t RF0R;
-  std::uint32_t RF1R;
-  std::uint32_t IER;
-  std::uint32_t ESR;
-  std::uint32_t BTR;
+  std::uint32_t volatile MCR;
+  std::uint32_t volatile MSR;
+  std::uint32_t volatile TSR;
+  std::uint32_t volatile RF0R;
+  std::uint32_t volatile RF1R;
+  std::uint32_t volatile IER;
+  std::uint32_t volatile ESR;
+  std::uint32_t volatile BTR;
   std::uint32_t reserved0[88];
   can_tx_mailbox_t transmit_mailbox[3];
   can_fifo_mailbox_t fifo_mailbox[2];
   std::uint32_t reserved1[12];
-  std::uint32_t FMR;
-  std::uint32_t FM1R;
+  std::uint32_t volatile FMR;
+  std::uint32_t volatile FM1R;
   std::uint32_t reserved2;
-  std::uint32_t FS1R;
+  std::uint32_t volatile FS1R;
   std::uint32_t reserved3;
-  std::uint32_t FFA1R;
+  std::uint32_t volatile FFA1R;
   std::uint32_t reserved4;
-  std::uint32_t FA1R;
+  std::uint32_t volatile FA1R;
   std::uint32_t reserved5[8];
   // Limited to only 14 on connectivity line devices
   can_filter_register_t sFilterRegister[28];
@@ -223,6 +223,37 @@ struct interrupt_enable_register  // NOLINT
   static constexpr auto sleep = bit_mask::from<17>();
 };
 
+/// This struct holds the bitmap for the error status register.
+/// It is represents 32-bit register: CAN_ESR (pg. 684).
+struct error_status  // NOLINT
+{
+  enum class error_code : std::uint8_t
+  {
+    no_error = 0b000,
+    stuff_error = 0b001,
+    form_error = 0b010,
+    acknowledgment_error = 0b011,
+    bit_recessive_error = 0b100,
+    bit_dominant_error = 0b101,
+    crc_error = 0b110,
+    /// Never set by hardware, written by software to detect updates
+    set_by_software = 0b111,
+  };
+
+  /// Set when either error counter reaches the warning limit of 96
+  static constexpr auto error_warning = bit_mask::from<0>();
+  /// Set when either error counter exceeds 127
+  static constexpr auto error_passive = bit_mask::from<1>();
+  /// Set when the controller enters the bus-off state
+  static constexpr auto bus_off = bit_mask::from<2>();
+  /// Error of the last message transferred on the bus, see error_code
+  static constexpr auto last_error_code = bit_mask::from<4, 6>();
+  /// Transmit error counter
+  static constexpr auto transmit_error_counter = bit_mask::from<16, 23>();
+  /// Receive error counter
+  static constexpr auto receive_error_counter = bit_mask::from<24, 31>();
+};
+
 /// This struct holds the bitmap for the mailbox identifier.
 /// It is represents 32-bit register: CAN_TIxR(0 - 2) (pg. 685).
 /// It is represents 32-bit register: CAN_RIxR(0 - 1) (pg. 688).
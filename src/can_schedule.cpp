@@ -0,0 +1,265 @@
+#include <libhal-stm32f1/can_schedule.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "can.hpp"
+#include "can_reg.hpp"
+#include "critical_section.hpp"
+#include "power.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Schedule driven by the running timer
+can_schedule* running_schedule = nullptr;
+/// Registers of the timer driving the running schedule
+general_purpose_timer_t* schedule_timer = nullptr;
+
+void schedule_interrupt()
+{
+  bit_modify(schedule_timer->SR).clear<timer_status::update>();
+  if (running_schedule) {
+    running_schedule->tick();
+  }
+}
+}  // namespace
+
+can_cyclic_frame::can_cyclic_frame(hal::can::message_t const& p_message,
+                                   std::uint16_t p_period)
+  : m_period(std::max<std::uint16_t>(p_period, 1))
+{
+  auto const registers = convert_message_to_stm_can(p_message);
+  m_identifier_image = registers.id;
+  m_length_image = registers.frame;
+  m_data_image = { registers.data_a, registers.data_b };
+}
+
+void can_cyclic_frame::update_payload(std::span<hal::byte const> p_data,
+                                      std::size_t p_offset)
+{
+  constexpr std::size_t payload_size = 8;
+  if (p_offset >= payload_size) {
+    return;
+  }
+  auto const length = std::min(p_data.size(), payload_size - p_offset);
+
+  // Merge the new bytes into copies of the images first so that the interrupt
+  // is only held off for the two stores.
+  auto images = std::array<std::uint32_t, 2>{};
+  {
+    critical_section guard;
+    images = m_data_image;
+  }
+
+  for (std::size_t i = 0; i < length; i++) {
+    auto const position = p_offset + i;
+    auto& word = images[position / 4];
+    auto const shift = (position % 4) * 8;
+    word = (word & ~(0xFFU << shift)) |
+           (static_cast<std::uint32_t>(p_data[i]) << shift);
+  }
+
+  critical_section guard;
+  m_data_image = images;
+}
+
+std::errc can_schedule::add(can_cyclic_frame& p_frame)
+{
+  if (m_running) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  auto const frames = std::span(m_frames).first(m_count);
+  if (std::ranges::find(frames, &p_frame) != frames.end()) {
+    return std::errc::address_in_use;
+  }
+
+  if (m_count == m_frames.size()) {
+    return std::errc::not_enough_memory;
+  }
+
+  m_frames[m_count++] = &p_frame;
+  return {};
+}
+
+void can_schedule::remove(can_cyclic_frame& p_frame)
+{
+  critical_section guard;
+  auto const frames = std::span(m_frames).first(m_count);
+  auto const position = std::ranges::find(frames, &p_frame);
+  if (position == frames.end()) {
+    return;
+  }
+  // Shift the remaining frames down to keep them in period order
+  std::copy(position + 1, frames.end(), position);
+  m_frames[--m_count] = nullptr;
+}
+
+void can_schedule::plan()
+{
+  auto const frames = std::span(m_frames).first(m_count);
+  std::ranges::stable_sort(frames, {}, &can_cyclic_frame::m_period);
+
+  for (std::size_t placed = 0; placed < frames.size(); placed++) {
+    auto& frame = *frames[placed];
+    std::uint16_t best_offset = 0;
+    std::uint32_t best_cost = UINT32_MAX;
+
+    for (std::uint32_t offset = 0; offset < frame.m_period; offset++) {
+      // Two frames with periods p and q and offsets a and b are released in
+      // the same tick once every lcm(p, q) ticks if a and b are congruent
+      // modulo gcd(p, q), and never otherwise. The candidate's own period is
+      // common to every term, so each collision is weighted by gcd/q.
+      std::uint32_t cost = 0;
+      for (auto const* other : frames.first(placed)) {
+        auto const divisor =
+          std::gcd<std::uint32_t>(frame.m_period, other->m_period);
+        if ((offset + divisor - (other->m_offset % divisor)) % divisor == 0) {
+          cost += (divisor << 16U) / other->m_period;
+        }
+      }
+
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_offset = static_cast<std::uint16_t>(offset);
+        if (cost == 0) {
+          break;
+        }
+      }
+    }
+
+    frame.m_offset = best_offset;
+  }
+
+  for (auto* frame : frames) {
+    frame->m_countdown = static_cast<std::uint16_t>(frame->m_offset + 1U);
+    frame->m_pending = false;
+  }
+}
+
+std::errc can_schedule::try_start(peripheral p_timer,
+                                  hal::time_duration p_tick)
+{
+  if (running_schedule != nullptr) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  auto const claimed = claim_timer(p_timer);
+  if (claimed != std::errc{}) {
+    return claimed;
+  }
+
+  auto const status = configure_periodic_timer(p_timer, p_tick);
+  if (status != std::errc{}) {
+    release_timer(p_timer);
+    return status;
+  }
+
+  plan();
+
+  m_timer = p_timer;
+  m_running = true;
+  running_schedule = this;
+  schedule_timer = general_purpose_timer(p_timer);
+
+  initialize_interrupts();
+  cortex_m::enable_interrupt(general_purpose_timer_irq(p_timer),
+                             schedule_interrupt);
+  bit_modify(schedule_timer->DIER).set<timer_interrupt_enable::update>();
+  bit_modify(schedule_timer->CR1).set<timer_control::counter_enable>();
+
+  return {};
+}
+
+void can_schedule::stop()
+{
+  if (not m_running) {
+    return;
+  }
+
+  bit_modify(schedule_timer->CR1).clear<timer_control::counter_enable>();
+  cortex_m::disable_interrupt(general_purpose_timer_irq(m_timer));
+  power_off(m_timer);
+  release_timer(m_timer);
+
+  m_running = false;
+  running_schedule = nullptr;
+  schedule_timer = nullptr;
+}
+
+void can_schedule::tick()
+{
+  for (auto* frame : std::span(m_frames).first(m_count)) {
+    if (--frame->m_countdown != 0) {
+      continue;
+    }
+    frame->m_countdown = frame->m_period;
+    if (frame->m_pending) {
+      frame->m_overruns++;
+    }
+    frame->m_pending = true;
+  }
+
+  load_pending();
+}
+
+void can_schedule::transmit_ready()
+{
+  critical_section guard;
+  load_pending();
+}
+
+void can_schedule::load_pending()
+{
+  constexpr std::array mailbox_empty{
+    transmit_status::transmit_mailbox0_empty,
+    transmit_status::transmit_mailbox1_empty,
+    transmit_status::transmit_mailbox2_empty,
+  };
+
+  auto const status = can1_reg->TSR;
+  std::size_t mailbox = 0;
+
+  // Frames are in period order, so the most frequent frames get the free
+  // mailboxes first.
+  for (auto* frame : std::span(m_frames).first(m_count)) {
+    if (not frame->m_pending) {
+      continue;
+    }
+
+    while (mailbox < mailbox_empty.size() &&
+           not bit_extract(mailbox_empty[mailbox], status)) {
+      mailbox++;
+    }
+
+    if (mailbox == mailbox_empty.size()) {
+      return;
+    }
+
+    auto& registers = can1_reg->transmit_mailbox[mailbox];
+    registers.TDTR = frame->m_length_image;
+    registers.TDLR = frame->m_data_image[0];
+    registers.TDHR = frame->m_data_image[1];
+    // Writing the identifier with the transmit request bit set goes last
+    registers.TIR = frame->m_identifier_image;
+    frame->m_pending = false;
+    mailbox++;
+  }
+}
+
+can_schedule::~can_schedule()
+{
+  stop();
+}
+}  // namespace hal::stm32f1
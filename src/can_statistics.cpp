@@ -0,0 +1,282 @@
+#include <libhal-stm32f1/can_statistics.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+
+#include "can.hpp"
+#include "critical_section.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Statistics attached with can::attach_statistics()
+can_statistics* can_attached_statistics = nullptr;
+
+std::size_t hash(hal::can::id_t p_id)
+{
+  // Fibonacci hashing spreads sequential IDs across the table
+  return (p_id * 0x9E37'79B1U) >> 16U;
+}
+
+float bus_load(can_statistics::totals const& p_totals,
+               std::uint64_t p_stuff_bits)
+{
+  if (p_totals.duration == 0 || p_totals.baud_rate <= 0.0f ||
+      p_totals.clock_frequency <= 0.0f) {
+    return 0.0f;
+  }
+
+  auto const seconds = static_cast<float>(p_totals.duration) /
+                       p_totals.clock_frequency;
+  auto const bits = static_cast<float>(p_totals.nominal_bits + p_stuff_bits);
+  return bits / (seconds * p_totals.baud_rate);
+}
+
+std::uint64_t to_microseconds(std::uint64_t p_ticks, hal::hertz p_frequency)
+{
+  auto const frequency = static_cast<std::uint64_t>(p_frequency);
+  if (frequency == 0) {
+    return 0;
+  }
+  // Whole seconds first, so that the product cannot overflow
+  return ((p_ticks / frequency) * 1'000'000U) +
+         (((p_ticks % frequency) * 1'000'000U) / frequency);
+}
+
+void write_text(hal::serial& p_serial, std::string_view p_text)
+{
+  p_serial.write(std::span(reinterpret_cast<hal::byte const*>(p_text.data()),
+                           p_text.size()));
+}
+
+/**
+ * @brief Write a label followed by an unsigned decimal number
+ *
+ * Formats without snprintf, which pulls in the printf machinery and its
+ * stack usage on newlib.
+ */
+void write_field(hal::serial& p_serial,
+                 std::string_view p_label,
+                 std::uint64_t p_value)
+{
+  // 20 digits hold the largest 64 bit value
+  std::array<char, 20> digits{};
+  auto index = digits.size();
+  do {
+    digits[--index] = static_cast<char>('0' + (p_value % 10U));
+    p_value /= 10U;
+  } while (p_value != 0);
+
+  write_text(p_serial, p_label);
+  write_text(p_serial,
+             std::string_view(digits.data() + index, digits.size() - index));
+}
+}  // namespace
+
+float can_statistics::totals::minimum_bus_load() const
+{
+  return bus_load(*this, 0);
+}
+
+float can_statistics::totals::maximum_bus_load() const
+{
+  return bus_load(*this, worst_case_stuff_bits);
+}
+
+can_statistics::can_statistics(std::span<id_statistics> p_table,
+                               hal::steady_clock& p_clock)
+  : m_table(p_table)
+  , m_clock(&p_clock)
+{
+  m_totals.clock_frequency = p_clock.frequency();
+  m_start = p_clock.uptime();
+}
+
+void can_statistics::baud_rate(hal::hertz p_baud_rate)
+{
+  critical_section lock;
+  m_totals.baud_rate = p_baud_rate;
+}
+
+can_statistics::id_statistics* can_statistics::slot_of(hal::can::id_t p_id,
+                                                       bool p_insert)
+{
+  auto const mask = m_table.size() - 1;
+  auto const probes = std::min(max_probe_length, m_table.size());
+  auto index = hash(p_id) & mask;
+
+  for (std::size_t i = 0; i < probes; i++) {
+    auto& slot = m_table[index];
+    if (slot.frames == 0) {
+      // IDs are never removed, so an empty slot ends the probe sequence
+      if (not p_insert) {
+        return nullptr;
+      }
+      slot.id = p_id;
+      return &slot;
+    }
+    if (slot.id == p_id) {
+      return &slot;
+    }
+    index = (index + 1) & mask;
+  }
+
+  return nullptr;
+}
+
+void can_statistics::record(hal::can::message_t const& p_message)
+{
+  auto const now = m_clock->uptime();
+
+  m_totals.nominal_bits += nominal_bits(p_message);
+  m_totals.worst_case_stuff_bits += worst_case_stuff_bits(p_message);
+
+  auto* entry = slot_of(p_message.id, true);
+  if (entry == nullptr) {
+    m_totals.untracked_frames++;
+    return;
+  }
+
+  if (entry->frames != 0) {
+    constexpr auto interval_limit = std::numeric_limits<std::uint32_t>::max();
+    auto const interval = static_cast<std::uint32_t>(
+      std::min<std::uint64_t>(now - entry->last_seen, interval_limit));
+
+    if (entry->frames == 1) {
+      entry->min_interval = interval;
+      entry->max_interval = interval;
+    } else {
+      entry->min_interval = std::min(entry->min_interval, interval);
+      entry->max_interval = std::max(entry->max_interval, interval);
+    }
+  }
+
+  entry->frames++;
+  entry->last_seen = now;
+}
+
+void can_statistics::record_receive(hal::can::message_t const& p_message)
+{
+  m_totals.received_frames++;
+  record(p_message);
+}
+
+void can_statistics::record_transmit(hal::can::message_t const& p_message)
+{
+  m_totals.transmitted_frames++;
+  record(p_message);
+}
+
+void can_statistics::reset()
+{
+  critical_section lock;
+
+  std::fill(m_table.begin(), m_table.end(), id_statistics{});
+  auto const baud_rate = m_totals.baud_rate;
+  m_totals = { .clock_frequency = m_clock->frequency(),
+               .baud_rate = baud_rate };
+  m_start = m_clock->uptime();
+}
+
+can_statistics::totals can_statistics::snapshot()
+{
+  critical_section lock;
+
+  auto copy = m_totals;
+  copy.duration = m_clock->uptime() - m_start;
+  return copy;
+}
+
+can_statistics::id_statistics can_statistics::find(hal::can::id_t p_id)
+{
+  critical_section lock;
+
+  auto const* entry = slot_of(p_id, false);
+  if (entry == nullptr) {
+    return { .id = p_id };
+  }
+  return *entry;
+}
+
+void can_statistics::export_snapshot(hal::serial& p_serial)
+{
+  auto const summary = snapshot();
+  auto const frequency = summary.clock_frequency;
+
+  write_field(p_serial,
+              "{\"duration_us\":",
+              to_microseconds(summary.duration, frequency));
+  write_field(p_serial,
+              ",\"baud_rate\":",
+              static_cast<std::uint32_t>(summary.baud_rate));
+  write_field(p_serial, ",\"rx\":", summary.received_frames);
+  write_field(p_serial, ",\"tx\":", summary.transmitted_frames);
+  write_field(p_serial, ",\"untracked\":", summary.untracked_frames);
+
+  // Bus load is reported in parts per million to avoid float formatting
+  write_field(p_serial,
+              ",\"bus_load_ppm\":[",
+              static_cast<std::uint32_t>(summary.minimum_bus_load() * 1e6f));
+  write_field(p_serial,
+              ",",
+              static_cast<std::uint32_t>(summary.maximum_bus_load() * 1e6f));
+  write_text(p_serial, "],\"ids\":[");
+
+  bool first = true;
+  for (std::size_t i = 0; i < m_table.size(); i++) {
+    id_statistics entry;
+    {
+      critical_section lock;
+      entry = m_table[i];
+    }
+
+    if (entry.frames == 0) {
+      continue;
+    }
+
+    write_field(p_serial, first ? "{\"id\":" : ",{\"id\":", entry.id);
+    write_field(p_serial, ",\"frames\":", entry.frames);
+    write_field(p_serial,
+                ",\"min_us\":",
+                to_microseconds(entry.min_interval, frequency));
+    write_field(p_serial,
+                ",\"max_us\":",
+                to_microseconds(entry.max_interval, frequency));
+    write_text(p_serial, "}");
+    first = false;
+  }
+
+  write_text(p_serial, "]}\n");
+}
+
+void can::attach_statistics(can_statistics& p_statistics)
+{
+  p_statistics.baud_rate(can_baud_rate);
+  can_attached_statistics = &p_statistics;
+  can_statistics_hooks = {
+    .record_receive =
+      [](hal::can::message_t const& p_message) {
+        can_attached_statistics->record_receive(p_message);
+      },
+    .record_transmit =
+      [](hal::can::message_t const& p_message) {
+        can_attached_statistics->record_transmit(p_message);
+      },
+    .baud_rate =
+      [](hal::hertz p_baud_rate) {
+        can_attached_statistics->baud_rate(p_baud_rate);
+      },
+  };
+  enable_can_receive_interrupts();
+  enable_can_transmit_interrupt();
+}
+
+void can::detach_statistics()
+{
+  can_statistics_hooks = {};
+  can_attached_statistics = nullptr;
+}
+}  // namespace hal::stm32f1
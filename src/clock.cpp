@@ -14,11 +14,14 @@
 
 #include <libhal-stm32f1/clock.hpp>
 
+#include <libhal-armcortex/system_control.hpp>
 #include <libhal-stm32f1/constants.hpp>
 #include <libhal-util/bit.hpp>
 #include <libhal-util/enum.hpp>
 
 #include "flash_reg.hpp"
+#include "power.hpp"
+#include "pwr_reg.hpp"
 #include "rcc_reg.hpp"
 
 namespace hal::stm32f1 {
@@ -411,6 +414,26 @@ hal::hertz frequency(peripheral p_id)
   return 0.0_Hz;
 }
 
+void enter_stop_mode(clock_tree const& p_clock_tree)
+{
+  power_on(peripheral::power);
+
+  bit_modify(pwr_reg->cr)
+    .clear<power_control::power_down_deepsleep>()
+    .set<power_control::low_power_deepsleep>()
+    .set<power_control::clear_wakeup_flag>();
+
+  bit_modify(*system_control_reg)
+    .set<system_control::sleep_deep>()
+    .set<system_control::send_event_on_pending>();
+
+  cortex_m::wait_for_event();
+
+  bit_modify(*system_control_reg).clear<system_control::sleep_deep>();
+
+  configure_clocks(p_clock_tree);
+}
+
 void maximum_speed_using_internal_oscillator()
 {
   using namespace hal::literals;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include <libhal-armcortex/interrupt.hpp>
+
+namespace hal::stm32f1 {
+#if defined(__arm__)
+/**
+ * @brief Read PRIMASK
+ *
+ * @return true - interrupts are masked
+ * @return false - interrupts are enabled
+ */
+inline bool interrupts_masked()
+{
+  std::uint32_t primask = 0;
+  asm volatile("mrs %0, primask" : "=r"(primask)::"memory");
+  return (primask & 1U) != 0;
+}
+#else
+/// Stands in for PRIMASK on host builds, where the interrupt functions do
+/// nothing
+inline bool host_interrupts_masked = false;
+
+/// Stands in for an interrupt that became pending while interrupts were
+/// masked. Tests set it, and it runs once the outermost section ends.
+inline std::function<void()> host_pending_interrupt{};
+
+inline bool interrupts_masked()
+{
+  return host_interrupts_masked;
+}
+#endif
+
+/**
+ * @brief Disables interrupts for the lifetime of the object
+ *
+ * Used by thread level APIs that share state with interrupt service routines.
+ * PRIMASK is restored rather than cleared on destruction, so sections nest
+ * and may be entered from interrupt handlers or with interrupts already
+ * masked by the caller.
+ */
+class critical_section
+{
+public:
+  critical_section()
+    : m_was_masked(interrupts_masked())
+  {
+    cortex_m::disable_all_interrupts();
+#if not defined(__arm__)
+    host_interrupts_masked = true;
+#endif
+  }
+
+  critical_section(critical_section const&) = delete;
+  critical_section& operator=(critical_section const&) = delete;
+  critical_section(critical_section&&) = delete;
+  critical_section& operator=(critical_section&&) = delete;
+
+  ~critical_section()
+  {
+    if (m_was_masked) {
+      return;
+    }
+#if not defined(__arm__)
+    host_interrupts_masked = false;
+    if (host_pending_interrupt) {
+      std::exchange(host_pending_interrupt, nullptr)();
+    }
+#endif
+    cortex_m::enable_all_interrupts();
+  }
+
+private:
+  bool m_was_masked;
+};
+}  // namespace hal::stm32f1
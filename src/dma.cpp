@@ -0,0 +1,49 @@
+#include <cstdint>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "critical_section.hpp"
+#include "dma.hpp"
+
+namespace hal::stm32f1::dma {
+namespace {
+/// Channels claimed by a driver, bit 0 is channel 1
+std::uint32_t claimed_channels = 0;
+}  // namespace
+
+std::errc claim_channel(std::uint8_t p_channel)
+{
+  if (p_channel < 1 || p_channel > dma1->channel.size()) {
+    return std::errc::argument_out_of_domain;
+  }
+
+  auto const bit = 1U << (p_channel - 1U);
+  critical_section guard;
+  if ((claimed_channels & bit) != 0) {
+    return std::errc::device_or_resource_busy;
+  }
+  claimed_channels |= bit;
+  return {};
+}
+
+void release_channel(std::uint8_t p_channel)
+{
+  if (p_channel < 1 || p_channel > dma1->channel.size()) {
+    return;
+  }
+
+  // Stop the channel so that it neither transfers nor interrupts once the
+  // next driver may claim it
+  auto const index = p_channel - 1U;
+  dma1->channel[index].configuration = 0;
+  dma1->interrupt_flag_clear = 0xFUL << (index * 4U);
+  cortex_m::disable_interrupt(
+    static_cast<irq>(hal::value(irq::dma1_channel1) + index));
+
+  critical_section guard;
+  claimed_channels &= ~(1U << index);
+}
+}  // namespace hal::stm32f1::dma
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <system_error>
 
 #include <libhal-util/bit.hpp>
 
@@ -63,6 +65,10 @@ static constexpr auto transfer_complete_interrupt_enable =
 /// Enable this DMA channel
 static constexpr auto enable = hal::bit_mask::from<0>();
 
+/// Transfer complete flag of channel 1 in the interrupt status register
+/// (ISR), the flags of each further channel are 4 bits higher.
+static constexpr auto transfer_complete_flag = hal::bit_mask::from<1>();
+
 struct dma_channel_t
 {
   std::uint32_t volatile configuration;
@@ -81,4 +87,28 @@ struct dma_t
 
 inline auto* dma1 = reinterpret_cast<dma_t*>(0x4002'0000);
 inline auto* dma2 = reinterpret_cast<dma_t*>(0x4002'0400);
+
+/**
+ * @brief Take a DMA1 channel for the exclusive use of a driver
+ *
+ * The request of each channel is shared by several peripherals, drivers
+ * claim the channels they use so that two of them never share one.
+ *
+ * @param p_channel - channel, 1 to 7
+ * @return std::errc - std::errc{} on success,
+ * std::errc::argument_out_of_domain if the channel does not exist and
+ * std::errc::device_or_resource_busy if it is claimed.
+ */
+[[nodiscard]] std::errc claim_channel(std::uint8_t p_channel);
+
+/**
+ * @brief Give back a DMA1 channel taken with `claim_channel()`
+ *
+ * The channel is disabled along with its interrupts and its interrupt
+ * request, so a transfer left running cannot write into memory of the
+ * releasing driver after it is gone.
+ *
+ * @param p_channel - channel, 1 to 7
+ */
+void release_channel(std::uint8_t p_channel);
 }  // namespace hal::stm32f1::dma
@@ -0,0 +1,38 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+namespace hal::stm32f1 {
+/// External interrupt/event controller register map
+struct external_interrupt_t
+{
+  /// Interrupt mask register
+  std::uint32_t volatile imr;
+  /// Event mask register
+  std::uint32_t volatile emr;
+  /// Rising trigger selection register
+  std::uint32_t volatile rtsr;
+  /// Falling trigger selection register
+  std::uint32_t volatile ftsr;
+  /// Software interrupt event register
+  std::uint32_t volatile swier;
+  /// Pending register, bits are cleared by writing a 1 to them
+  std::uint32_t volatile pr;
+};
+
+inline auto* exti_reg = reinterpret_cast<external_interrupt_t*>(0x4001'0400);
+}  // namespace hal::stm32f1
@@ -14,16 +14,52 @@
 
 #include <libhal-stm32f1/input_pin.hpp>
 
+#include <array>
 #include <cstdint>
 
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
 #include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
 #include <libhal/error.hpp>
 #include <libhal/units.hpp>
 
+#include "exti_reg.hpp"
 #include "pin.hpp"
 #include "power.hpp"
 
 namespace hal::stm32f1 {
+namespace {
+std::array<async_event, 16> exti_event{};
+
+void exti_handler()
+{
+  auto const pending = exti_reg->pr & exti_reg->imr;
+
+  // Edge waits are one-shot, mask the lines until they are armed again
+  exti_reg->imr = exti_reg->imr & ~pending;
+  exti_reg->pr = pending;
+
+  for (std::size_t line = 0; line < exti_event.size(); line++) {
+    if (pending & (1UL << line)) {
+      exti_event[line].signal();
+    }
+  }
+}
+
+irq exti_irq(std::uint8_t p_pin)
+{
+  if (p_pin <= 4) {
+    return static_cast<irq>(value(irq::exti0) + p_pin);
+  }
+  if (p_pin <= 9) {
+    return irq::exti9_5;
+  }
+  return irq::exti15_10;
+}
+}  // namespace
+
 input_pin::input_pin(std::uint8_t p_port,  // NOLINT
                      std::uint8_t p_pin)   // NOLINT
 
@@ -65,4 +101,34 @@ bool input_pin::driver_level()
 
   return static_cast<bool>(pin_value);
 }
+
+async_event& input_pin::edge(edge_trigger p_trigger)
+{
+  auto const line = bit_mask::from(m_pin);
+  auto& event = exti_event[m_pin];
+
+  event.reset();
+
+  // Select this pin's port as the source of the EXTI line. Each EXTICR
+  // register holds 4 bit port selections for 4 lines.
+  auto const source_position = (m_pin % 4U) * 4U;
+  auto const source = bit_mask::from(source_position, source_position + 3U);
+  bit_modify(alternative_function_io->exticr[m_pin / 4U])
+    .insert(source, static_cast<std::uint32_t>(m_port - 'A'));
+
+  bit_modify(exti_reg->rtsr)
+    .insert(line, p_trigger != edge_trigger::falling);
+  bit_modify(exti_reg->ftsr)
+    .insert(line, p_trigger != edge_trigger::rising);
+
+  // Drop any edge that occurred before the wait was armed
+  exti_reg->pr = 1UL << m_pin;
+
+  initialize_interrupts();
+  cortex_m::enable_interrupt(exti_irq(m_pin), exti_handler);
+
+  bit_modify(exti_reg->imr).set(line);
+
+  return event;
+}
 }  // namespace hal::stm32f1
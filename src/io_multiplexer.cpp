@@ -0,0 +1,70 @@
+#include <libhal-stm32f1/io_multiplexer.hpp>
+
+#include <bit>
+#include <cstdint>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-armcortex/system_control.hpp>
+
+namespace hal::stm32f1 {
+io_multiplexer::ready_set io_multiplexer::allocate()
+{
+  if (m_allocated == ~ready_set{ 0 }) {
+    return 0;
+  }
+  // Lowest free bit
+  auto const bit = ready_set{ 1 } << std::countr_one(m_allocated);
+  m_allocated |= bit;
+  return bit;
+}
+
+io_multiplexer::ready_set io_multiplexer::watch(uart& p_uart)
+{
+  auto const bit = allocate();
+  if (bit == 0) {
+    return 0;
+  }
+
+  auto const mark_ready = [this, bit]() { signal(bit); };
+  p_uart.on_receive_idle(mark_ready);
+  p_uart.on_receive_progress(mark_ready);
+  return bit;
+}
+
+io_multiplexer::ready_set io_multiplexer::watch(
+  hal::can& p_can,
+  hal::callback<hal::can::handler> p_handler)
+{
+  auto const bit = allocate();
+  if (bit == 0) {
+    return 0;
+  }
+
+  p_can.on_receive(
+    [this, bit, p_handler](hal::can::message_t const& p_message) {
+      if (p_handler) {
+        p_handler(p_message);
+      }
+      signal(bit);
+    });
+  return bit;
+}
+
+io_multiplexer::ready_set io_multiplexer::wait()
+{
+  while (true) {
+    // Interrupts are masked while checking for work so that a port becoming
+    // ready between the check and WFI still wakes the core.
+    cortex_m::disable_all_interrupts();
+    auto const ready = poll();
+    if (ready == 0) {
+      cortex_m::wait_for_interrupt();
+    }
+    cortex_m::enable_all_interrupts();
+
+    if (ready != 0) {
+      return ready;
+    }
+  }
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,507 @@
+#include <libhal-stm32f1/iso_tp.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include "critical_section.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Protocol control information frame types (upper nibble of byte 0)
+enum class frame_type : std::uint8_t
+{
+  single = 0x0,
+  first = 0x1,
+  consecutive = 0x2,
+  flow_control = 0x3,
+};
+
+/// Flow status of a flow control frame (lower nibble of byte 0)
+enum class flow_status : std::uint8_t
+{
+  continue_to_send = 0x0,
+  wait = 0x1,
+  overflow = 0x2,
+};
+
+constexpr std::size_t frame_size = 8;
+constexpr std::size_t single_frame_capacity = frame_size - 1;
+constexpr std::size_t consecutive_frame_capacity = frame_size - 1;
+/// Largest length that fits within the 12 bit first frame length field
+constexpr std::size_t short_first_frame_limit = 0xFFF;
+
+constexpr hal::byte pci_byte(frame_type p_type, std::uint32_t p_low_nibble)
+{
+  return static_cast<hal::byte>((static_cast<std::uint32_t>(p_type) << 4U) |
+                                (p_low_nibble & 0xFU));
+}
+}  // namespace
+
+iso_tp_session::iso_tp_session(settings const& p_settings,
+                               std::span<hal::byte> p_receive_buffer)
+  : m_settings(p_settings)
+  , m_receive_buffer(p_receive_buffer)
+{
+}
+
+void iso_tp_session::on_receive(hal::callback<receive_handler> p_handler)
+{
+  m_receive_handler = p_handler;
+}
+
+std::span<hal::byte const> iso_tp_session::received() const
+{
+  if (m_receive_status != status::complete) {
+    return {};
+  }
+  return m_receive_buffer.first(m_receive_length);
+}
+
+iso_tp::iso_tp(can& p_can, hal::steady_clock& p_clock)
+  : iso_tp(
+      [&p_can](hal::can::message_t const& p_message) {
+        return p_can.try_send(p_message);
+      },
+      p_clock)
+{
+  p_can.enable_transmit_fifo(true);
+  p_can.on_receive(
+    [this](hal::can::message_t const& p_message) { handle_frame(p_message); });
+  p_can.on_transmit_ready([this]() { transmit_ready(); });
+}
+
+iso_tp::iso_tp(hal::callback<transmitter> p_transmitter,
+               hal::steady_clock& p_clock)
+  : m_transmitter(p_transmitter)
+  , m_clock(&p_clock)
+  , m_ticks_per_ms(
+      std::max<std::uint64_t>(1, static_cast<std::uint64_t>(
+                                   p_clock.frequency() / 1000.0f)))
+{
+}
+
+std::errc iso_tp::add(iso_tp_session& p_session)
+{
+  critical_section lock;
+
+  if (find(p_session.m_settings.receive_id) != nullptr) {
+    return std::errc::address_in_use;
+  }
+
+  auto slot = std::find(m_sessions.begin(), m_sessions.end(), nullptr);
+  if (slot == m_sessions.end()) {
+    return std::errc::not_enough_memory;
+  }
+
+  *slot = &p_session;
+  return {};
+}
+
+void iso_tp::remove(iso_tp_session& p_session)
+{
+  critical_section lock;
+  std::replace(m_sessions.begin(),
+               m_sessions.end(),
+               &p_session,
+               static_cast<iso_tp_session*>(nullptr));
+}
+
+iso_tp_session* iso_tp::find(hal::can::id_t p_receive_id)
+{
+  for (auto* session : m_sessions) {
+    if (session && session->m_settings.receive_id == p_receive_id) {
+      return session;
+    }
+  }
+  return nullptr;
+}
+
+std::uint64_t iso_tp::separation_ticks(std::uint8_t p_separation_time) const
+{
+  if (p_separation_time <= 0x7F) {
+    return p_separation_time * m_ticks_per_ms;
+  }
+  if (0xF1 <= p_separation_time && p_separation_time <= 0xF9) {
+    return ((p_separation_time - 0xF0U) * m_ticks_per_ms) / 10U;
+  }
+  // Reserved values must be treated as the longest separation time
+  return 0x7F * m_ticks_per_ms;
+}
+
+std::errc iso_tp::send(iso_tp_session& p_session,
+                       std::span<hal::byte const> p_data)
+{
+  if (p_data.empty() ||
+      static_cast<std::uint64_t>(p_data.size()) > 0xFFFF'FFFFU) {
+    return std::errc::invalid_argument;
+  }
+
+  critical_section lock;
+
+  if (p_session.m_transmit_status == iso_tp_session::status::in_progress) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  p_session.m_transmit_data = p_data;
+  p_session.m_transmit_offset = 0;
+  p_session.m_transmit_sequence = 0;
+  p_session.m_phase = iso_tp_session::transmit_phase::send_first_frame;
+  p_session.m_transmit_status = iso_tp_session::status::in_progress;
+
+  service(p_session, m_clock->uptime());
+
+  return {};
+}
+
+bool iso_tp::transmit(iso_tp_session& p_session,
+                      std::span<hal::byte const> p_frame_data)
+{
+  hal::can::message_t message{
+    .id = p_session.m_settings.transmit_id,
+    .length = frame_size,
+  };
+
+  message.payload.fill(p_session.m_settings.padding);
+  std::copy(p_frame_data.begin(), p_frame_data.end(), message.payload.begin());
+
+  return m_transmitter(message) == std::errc{};
+}
+
+void iso_tp::service(iso_tp_session& p_session, std::uint64_t p_now)
+{
+  using status = iso_tp_session::status;
+  using transmit_phase = iso_tp_session::transmit_phase;
+  auto& session = p_session;
+
+  if (session.m_flow_control_pending) {
+    std::array<hal::byte, 3> const flow_control{
+      pci_byte(frame_type::flow_control, session.m_flow_status),
+      session.m_settings.block_size,
+      session.m_settings.separation_time,
+    };
+    if (not transmit(session, flow_control)) {
+      return;
+    }
+    session.m_flow_control_pending = false;
+  }
+
+  auto const data = session.m_transmit_data;
+
+  if (session.m_phase == transmit_phase::send_first_frame) {
+    std::array<hal::byte, frame_size> frame{};
+    std::size_t header_length = 0;
+    auto const length = static_cast<std::uint32_t>(data.size());
+
+    if (data.size() <= single_frame_capacity) {
+      frame[0] = pci_byte(frame_type::single, length);
+      header_length = 1;
+    } else if (data.size() <= short_first_frame_limit) {
+      frame[0] = pci_byte(frame_type::first, length >> 8U);
+      frame[1] = static_cast<hal::byte>(length & 0xFFU);
+      header_length = 2;
+    } else {
+      // Lengths beyond 12 bits use the escape sequence: a zero 12 bit length
+      // followed by a 32 bit length.
+      frame[0] = pci_byte(frame_type::first, 0);
+      frame[1] = 0;
+      frame[2] = static_cast<hal::byte>(length >> 24U);
+      frame[3] = static_cast<hal::byte>(length >> 16U);
+      frame[4] = static_cast<hal::byte>(length >> 8U);
+      frame[5] = static_cast<hal::byte>(length >> 0U);
+      header_length = 6;
+    }
+
+    auto const payload_length =
+      std::min(data.size(), frame_size - header_length);
+    std::copy_n(data.begin(), payload_length, frame.begin() + header_length);
+
+    if (not transmit(session, std::span(frame).first(header_length +
+                                                      payload_length))) {
+      return;
+    }
+
+    session.m_transmit_offset = payload_length;
+    if (session.m_transmit_offset == data.size()) {
+      session.m_phase = transmit_phase::idle;
+      session.m_transmit_status = status::complete;
+      return;
+    }
+
+    session.m_transmit_sequence = 1;
+    session.m_phase = transmit_phase::wait_for_flow_control;
+    session.m_transmit_deadline = p_now + timeout_ms * m_ticks_per_ms;
+    return;
+  }
+
+  while (session.m_phase == transmit_phase::send_consecutive_frames &&
+         session.m_next_frame_time <= p_now) {
+    std::array<hal::byte, frame_size> frame{};
+    auto const remaining = data.size() - session.m_transmit_offset;
+    auto const payload_length = std::min(remaining, consecutive_frame_capacity);
+
+    frame[0] = pci_byte(frame_type::consecutive, session.m_transmit_sequence);
+    std::copy_n(data.begin() + static_cast<std::ptrdiff_t>(
+                                 session.m_transmit_offset),
+                payload_length,
+                frame.begin() + 1);
+
+    if (not transmit(session, std::span(frame).first(1 + payload_length))) {
+      return;
+    }
+
+    session.m_transmit_offset += payload_length;
+    session.m_transmit_sequence = (session.m_transmit_sequence + 1U) & 0xFU;
+
+    if (session.m_transmit_offset == data.size()) {
+      session.m_phase = transmit_phase::idle;
+      session.m_transmit_status = status::complete;
+      return;
+    }
+
+    if (session.m_peer_block_size != 0 && --session.m_block_remaining == 0) {
+      session.m_phase = transmit_phase::wait_for_flow_control;
+      session.m_transmit_deadline = p_now + timeout_ms * m_ticks_per_ms;
+      return;
+    }
+
+    session.m_next_frame_time = p_now + session.m_peer_separation;
+    if (session.m_peer_separation != 0) {
+      // The next frame is sent by poll() once the separation time elapses
+      return;
+    }
+  }
+}
+
+void iso_tp::receive_single_frame(iso_tp_session& p_session,
+                                  hal::can::message_t const& p_frame)
+{
+  using status = iso_tp_session::status;
+  std::size_t const length = p_frame.payload[0] & 0xFU;
+
+  if (length == 0 || length > single_frame_capacity ||
+      length + 1 > p_frame.length) {
+    return;
+  }
+
+  if (length > p_session.m_receive_buffer.size()) {
+    p_session.m_receive_status = status::overflow;
+    return;
+  }
+
+  std::copy_n(
+    p_frame.payload.begin() + 1, length, p_session.m_receive_buffer.begin());
+  p_session.m_receive_length = length;
+  p_session.m_receive_status = status::complete;
+
+  if (p_session.m_receive_handler) {
+    p_session.m_receive_handler(p_session, p_session.received());
+  }
+}
+
+void iso_tp::receive_first_frame(iso_tp_session& p_session,
+                                 hal::can::message_t const& p_frame,
+                                 std::uint64_t p_now)
+{
+  using status = iso_tp_session::status;
+
+  if (p_frame.length != frame_size) {
+    return;
+  }
+
+  auto const& payload = p_frame.payload;
+  std::size_t length = ((payload[0] & 0xFU) << 8U) | payload[1];
+  std::size_t header_length = 2;
+
+  if (length == 0) {
+    length = (std::uint32_t{ payload[2] } << 24U) |
+             (std::uint32_t{ payload[3] } << 16U) |
+             (std::uint32_t{ payload[4] } << 8U) | payload[5];
+    header_length = 6;
+  }
+
+  // Messages that fit within a single frame must not use a first frame
+  if (length <= single_frame_capacity) {
+    return;
+  }
+
+  p_session.m_flow_control_pending = true;
+
+  if (length > p_session.m_receive_buffer.size()) {
+    p_session.m_flow_status = static_cast<std::uint8_t>(flow_status::overflow);
+    p_session.m_receive_status = status::overflow;
+    return;
+  }
+
+  auto const payload_length = frame_size - header_length;
+  std::copy_n(payload.begin() + static_cast<std::ptrdiff_t>(header_length),
+              payload_length,
+              p_session.m_receive_buffer.begin());
+
+  p_session.m_flow_status =
+    static_cast<std::uint8_t>(flow_status::continue_to_send);
+  p_session.m_receive_length = length;
+  p_session.m_receive_offset = payload_length;
+  p_session.m_receive_sequence = 1;
+  p_session.m_block_count = 0;
+  p_session.m_receive_deadline = p_now + timeout_ms * m_ticks_per_ms;
+  p_session.m_receive_status = status::in_progress;
+}
+
+void iso_tp::receive_consecutive_frame(iso_tp_session& p_session,
+                                       hal::can::message_t const& p_frame,
+                                       std::uint64_t p_now)
+{
+  using status = iso_tp_session::status;
+
+  if (p_session.m_receive_status != status::in_progress) {
+    return;
+  }
+
+  if ((p_frame.payload[0] & 0xFU) != p_session.m_receive_sequence) {
+    p_session.m_receive_status = status::protocol_error;
+    return;
+  }
+
+  auto const remaining = p_session.m_receive_length - p_session.m_receive_offset;
+  auto const payload_length =
+    std::min({ remaining,
+               consecutive_frame_capacity,
+               static_cast<std::size_t>(p_frame.length - 1U) });
+
+  std::copy_n(p_frame.payload.begin() + 1,
+              payload_length,
+              p_session.m_receive_buffer.begin() +
+                static_cast<std::ptrdiff_t>(p_session.m_receive_offset));
+
+  p_session.m_receive_offset += payload_length;
+  p_session.m_receive_sequence = (p_session.m_receive_sequence + 1U) & 0xFU;
+  p_session.m_receive_deadline = p_now + timeout_ms * m_ticks_per_ms;
+
+  if (p_session.m_receive_offset == p_session.m_receive_length) {
+    p_session.m_receive_status = status::complete;
+    if (p_session.m_receive_handler) {
+      p_session.m_receive_handler(p_session, p_session.received());
+    }
+    return;
+  }
+
+  auto const block_size = p_session.m_settings.block_size;
+  if (block_size != 0 && ++p_session.m_block_count == block_size) {
+    p_session.m_block_count = 0;
+    p_session.m_flow_status =
+      static_cast<std::uint8_t>(flow_status::continue_to_send);
+    p_session.m_flow_control_pending = true;
+  }
+}
+
+void iso_tp::receive_flow_control(iso_tp_session& p_session,
+                                  hal::can::message_t const& p_frame,
+                                  std::uint64_t p_now)
+{
+  using status = iso_tp_session::status;
+  using transmit_phase = iso_tp_session::transmit_phase;
+
+  if (p_session.m_phase != transmit_phase::wait_for_flow_control ||
+      p_frame.length < 3) {
+    return;
+  }
+
+  switch (static_cast<flow_status>(p_frame.payload[0] & 0xFU)) {
+    case flow_status::continue_to_send:
+      p_session.m_peer_block_size = p_frame.payload[1];
+      p_session.m_block_remaining = p_frame.payload[1];
+      p_session.m_peer_separation = separation_ticks(p_frame.payload[2]);
+      p_session.m_next_frame_time = p_now;
+      p_session.m_phase = transmit_phase::send_consecutive_frames;
+      break;
+    case flow_status::wait:
+      p_session.m_transmit_deadline = p_now + timeout_ms * m_ticks_per_ms;
+      break;
+    case flow_status::overflow:
+      p_session.m_phase = transmit_phase::idle;
+      p_session.m_transmit_status = status::overflow;
+      break;
+    default:
+      p_session.m_phase = transmit_phase::idle;
+      p_session.m_transmit_status = status::protocol_error;
+      break;
+  }
+}
+
+bool iso_tp::handle_frame(hal::can::message_t const& p_frame)
+{
+  if (p_frame.is_remote_request || p_frame.length == 0) {
+    return false;
+  }
+
+  auto* session = find(p_frame.id);
+  if (session == nullptr) {
+    return false;
+  }
+
+  auto const now = m_clock->uptime();
+
+  switch (static_cast<frame_type>(p_frame.payload[0] >> 4U)) {
+    case frame_type::single:
+      receive_single_frame(*session, p_frame);
+      break;
+    case frame_type::first:
+      receive_first_frame(*session, p_frame, now);
+      break;
+    case frame_type::consecutive:
+      receive_consecutive_frame(*session, p_frame, now);
+      break;
+    case frame_type::flow_control:
+      receive_flow_control(*session, p_frame, now);
+      break;
+    default:
+      // Unknown frame types must be ignored
+      break;
+  }
+
+  service(*session, now);
+  return true;
+}
+
+void iso_tp::transmit_ready()
+{
+  auto const now = m_clock->uptime();
+  for (auto* session : m_sessions) {
+    if (session) {
+      service(*session, now);
+    }
+  }
+}
+
+void iso_tp::poll()
+{
+  using status = iso_tp_session::status;
+  using transmit_phase = iso_tp_session::transmit_phase;
+
+  critical_section lock;
+  auto const now = m_clock->uptime();
+
+  for (auto* session : m_sessions) {
+    if (session == nullptr) {
+      continue;
+    }
+
+    if (session->m_receive_status == status::in_progress &&
+        now > session->m_receive_deadline) {
+      session->m_receive_status = status::timeout;
+    }
+
+    if (session->m_phase == transmit_phase::wait_for_flow_control &&
+        now > session->m_transmit_deadline) {
+      session->m_phase = transmit_phase::idle;
+      session->m_transmit_status = status::timeout;
+    }
+
+    service(*session, now);
+  }
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,437 @@
+#include <libhal-stm32f1/matrix_scanner.hpp>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "dma.hpp"
+#include "matrix_scanner.hpp"
+#include "pin.hpp"
+#include "power.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::uint32_t pins_per_group = matrix_scanner::size;
+constexpr std::uint32_t group_mask = 0xFFU;
+
+constexpr auto pattern_dma_settings =
+  hal::bit_value()
+    .set<dma::data_transfer_direction>()  // Read from memory
+    .set<dma::memory_increment_enable>()
+    .set<dma::circular_mode>()
+    .insert<dma::memory_size, 0b10U>()      // 32-bit
+    .insert<dma::peripheral_size, 0b10U>()  // 32-bit
+    .insert<dma::channel_priority, 0b10U>()  // Low Medium [High] Very_High
+    .set<dma::enable>()
+    .to<std::uint32_t>();
+
+constexpr auto sample_dma_settings =
+  hal::bit_value()
+    .clear<dma::data_transfer_direction>()  // Read from peripheral
+    .set<dma::memory_increment_enable>()
+    .set<dma::circular_mode>()
+    .set<dma::half_transfer_interrupt_enable>()
+    .set<dma::transfer_complete_interrupt_enable>()
+    .insert<dma::memory_size, 0b01U>()      // 16-bit, the low half of IDR
+    .insert<dma::peripheral_size, 0b10U>()  // 32-bit
+    .insert<dma::channel_priority, 0b10U>()  // Low Medium [High] Very_High
+    .set<dma::enable>()
+    .to<std::uint32_t>();
+
+/// DMA1 channels of the requests of a timer
+struct scan_channels
+{
+  /// Update event, writes the row patterns
+  std::uint8_t pattern;
+  /// Capture/compare event, reads the samples
+  std::uint8_t sample;
+  /// Capture/compare channel of the timer requesting the samples, 1 to 4
+  std::uint8_t compare;
+  /// Interrupt of the sample channel
+  irq sample_irq;
+};
+
+scan_channels scan_dma_channels(peripheral p_timer)
+{
+  // timer2 samples on capture/compare 3, whose DMA channel 1 no usart uses
+  switch (p_timer) {
+    case peripheral::timer3:
+      return { .pattern = 3,
+               .sample = 6,
+               .compare = 1,
+               .sample_irq = irq::dma1_channel6 };
+    case peripheral::timer4:
+      return { .pattern = 7,
+               .sample = 1,
+               .compare = 1,
+               .sample_irq = irq::dma1_channel1 };
+    case peripheral::timer2:
+    default:
+      return { .pattern = 2,
+               .sample = 1,
+               .compare = 3,
+               .sample_irq = irq::dma1_channel1 };
+  }
+}
+
+/**
+ * @brief Claim the timer and both DMA channels, or none of them
+ *
+ * @param p_timer - timer pacing the scan
+ * @return std::errc - std::errc{} on success or the first failed claim
+ */
+std::errc claim_scan_resources(peripheral p_timer)
+{
+  auto const channels = scan_dma_channels(p_timer);
+
+  auto status = claim_timer(p_timer);
+  if (status != std::errc{}) {
+    return status;
+  }
+  status = dma::claim_channel(channels.pattern);
+  if (status != std::errc{}) {
+    release_timer(p_timer);
+    return status;
+  }
+  status = dma::claim_channel(channels.sample);
+  if (status != std::errc{}) {
+    dma::release_channel(channels.pattern);
+    release_timer(p_timer);
+    return status;
+  }
+  return {};
+}
+
+void release_scan_resources(peripheral p_timer)
+{
+  auto const channels = scan_dma_channels(p_timer);
+  dma::release_channel(channels.sample);
+  dma::release_channel(channels.pattern);
+  release_timer(p_timer);
+}
+
+/// Scanner running on each of timer2 to timer4
+std::array<matrix_scanner*, 3> running_scanner{};
+
+std::size_t timer_index(peripheral p_timer)
+{
+  return static_cast<std::size_t>(p_timer) -
+         static_cast<std::size_t>(peripheral::timer2);
+}
+
+template<peripheral timer, std::uint8_t channel>
+void matrix_frame_interrupt()
+{
+  constexpr auto shift = (channel - 1U) * 4U;
+  constexpr auto complete = dma::transfer_complete_flag.value<std::uint32_t>();
+  constexpr auto half = complete << 1U;
+  auto const status = dma::dma1->interrupt_status >> shift;
+  // Clear every flag for the channel: global, complete, half and error
+  dma::dma1->interrupt_flag_clear = 0xFUL << shift;
+
+  auto* scanner = running_scanner[timer_index(timer)];
+  if (scanner == nullptr) {
+    return;
+  }
+  // Half way the first frame of the buffer is complete, at the end the
+  // second. Both are pending if the interrupt was held off for a frame.
+  if (status & half) {
+    scanner->frame_complete(0);
+  }
+  if (status & complete) {
+    scanner->frame_complete(1);
+  }
+}
+
+bool overlaps(std::uint8_t p_first, std::uint8_t p_second)
+{
+  return (p_first < p_second + pins_per_group) &&
+         (p_second < p_first + pins_per_group);
+}
+}  // namespace
+
+std::uint32_t matrix_row_pattern(std::size_t p_row,
+                                 std::uint8_t p_first_row_pin,
+                                 std::uint8_t p_leds,
+                                 std::uint8_t p_first_led_pin,
+                                 bool p_drive_leds)
+{
+  // BSRR sets the pins in its lower half and resets those in its upper half
+  auto const selected = 1U << (p_row + p_first_row_pin);
+  auto const rows = group_mask << p_first_row_pin;
+  std::uint32_t pattern = (rows & ~selected) | (selected << 16U);
+
+  if (p_drive_leds) {
+    auto const lit = std::uint32_t{ p_leds } << p_first_led_pin;
+    auto const unlit = (group_mask << p_first_led_pin) & ~lit;
+    pattern |= lit | (unlit << 16U);
+  }
+  return pattern;
+}
+
+std::uint64_t matrix_frame_keys(std::span<std::uint16_t const> p_samples,
+                                std::uint8_t p_first_column_pin)
+{
+  std::uint64_t keys = 0;
+  for (std::size_t row = 0; row < p_samples.size(); row++) {
+    // Pressed keys connect their column to the selected row, which is low
+    auto const columns =
+      (~std::uint32_t{ p_samples[row] } >> p_first_column_pin) & group_mask;
+    keys |= std::uint64_t{ columns } << (row * pins_per_group);
+  }
+  return keys;
+}
+
+std::uint64_t matrix_debounce(std::uint64_t p_raw,
+                              std::uint64_t& p_keys,
+                              std::uint64_t& p_counting,
+                              std::span<std::uint8_t> p_counts,
+                              std::uint8_t p_frames)
+{
+  auto const differing = p_raw ^ p_keys;
+
+  // Keys back at their state start over
+  auto settled = p_counting & ~differing;
+  while (settled != 0) {
+    p_counts[std::countr_zero(settled)] = 0;
+    settled &= settled - 1U;
+  }
+
+  std::uint64_t changed = 0;
+  auto remaining = differing;
+  while (remaining != 0) {
+    auto const key = std::countr_zero(remaining);
+    remaining &= remaining - 1U;
+    if (++p_counts[key] >= p_frames) {
+      p_counts[key] = 0;
+      changed |= std::uint64_t{ 1 } << key;
+    }
+  }
+
+  p_counting = differing & ~changed;
+  p_keys ^= changed;
+  return changed;
+}
+
+std::errc matrix_scanner::try_start(matrix_scanner_settings const& p_settings,
+                                    hal::callback<handler> p_handler)
+{
+  auto* reg = general_purpose_timer(p_settings.timer);
+  auto const valid_port = [](std::uint8_t p_port) {
+    return 'A' <= p_port && p_port <= 'E';
+  };
+  constexpr std::uint8_t last_first_pin = 16 - pins_per_group;
+
+  if (reg == nullptr || not valid_port(p_settings.row_port) ||
+      not valid_port(p_settings.column_port) ||
+      p_settings.first_row_pin > last_first_pin ||
+      p_settings.first_column_pin > last_first_pin) {
+    return std::errc::argument_out_of_domain;
+  }
+  if (p_settings.drive_leds &&
+      (p_settings.first_led_pin > last_first_pin ||
+       overlaps(p_settings.first_led_pin, p_settings.first_row_pin))) {
+    return std::errc::argument_out_of_domain;
+  }
+  if (p_settings.row_port == p_settings.column_port &&
+      (overlaps(p_settings.first_column_pin, p_settings.first_row_pin) ||
+       (p_settings.drive_leds &&
+        overlaps(p_settings.first_column_pin, p_settings.first_led_pin)))) {
+    return std::errc::argument_out_of_domain;
+  }
+
+  auto const index = timer_index(p_settings.timer);
+  if (m_running || running_scanner[index] != nullptr) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  if (p_settings.row_rate <= 0.0f) {
+    return std::errc::operation_not_supported;
+  }
+  auto const claimed = claim_scan_resources(p_settings.timer);
+  if (claimed != std::errc{}) {
+    return claimed;
+  }
+  auto const status = configure_periodic_timer(
+    p_settings.timer,
+    hal::time_duration(
+      static_cast<std::int64_t>(1'000'000'000.0f / p_settings.row_rate)));
+  if (status != std::errc{}) {
+    release_scan_resources(p_settings.timer);
+    return status;
+  }
+
+  m_settings = p_settings;
+  m_handler = p_handler;
+  m_keys = 0;
+  m_counting = 0;
+  m_counts = {};
+  for (std::size_t row = 0; row < size; row++) {
+    set_leds(row, m_leds[row]);
+  }
+
+  // Rows start released and columns pulled up, the pull direction is the
+  // output data register's bit.
+  auto& rows = gpio(m_settings.row_port);
+  auto& columns = gpio(m_settings.column_port);
+  rows.bsrr = group_mask << m_settings.first_row_pin;
+  columns.bsrr = group_mask << m_settings.first_column_pin;
+  for (std::uint8_t i = 0; i < pins_per_group; i++) {
+    configure_pin(
+      { .port = m_settings.row_port,
+        .pin = static_cast<std::uint8_t>(m_settings.first_row_pin + i) },
+      open_drain_gpio_output);
+    configure_pin(
+      { .port = m_settings.column_port,
+        .pin = static_cast<std::uint8_t>(m_settings.first_column_pin + i) },
+      input_pull_up);
+    if (m_settings.drive_leds) {
+      configure_pin(
+        { .port = m_settings.row_port,
+          .pin = static_cast<std::uint8_t>(m_settings.first_led_pin + i) },
+        push_pull_gpio_output);
+    }
+  }
+
+  power_on(peripheral::dma1);
+  auto const channels = scan_dma_channels(m_settings.timer);
+  auto& pattern_channel = dma::dma1->channel[channels.pattern - 1];
+  auto& sample_channel = dma::dma1->channel[channels.sample - 1];
+  pattern_channel.configuration = 0;
+  sample_channel.configuration = 0;
+  dma::dma1->interrupt_flag_clear = (0xFUL << ((channels.pattern - 1U) * 4U)) |
+                                    (0xFUL << ((channels.sample - 1U) * 4U));
+
+  auto const bsrr = reinterpret_cast<std::intptr_t>(&rows.bsrr);
+  auto const idr = reinterpret_cast<std::intptr_t>(&columns.idr);
+  auto const patterns = reinterpret_cast<std::intptr_t>(m_patterns.data());
+  auto const samples = reinterpret_cast<std::intptr_t>(m_samples.data());
+  pattern_channel.peripheral_address = static_cast<std::uint32_t>(bsrr);
+  pattern_channel.memory_address = static_cast<std::uint32_t>(patterns);
+  pattern_channel.transfer_amount =
+    static_cast<std::uint32_t>(m_patterns.size());
+  sample_channel.peripheral_address = static_cast<std::uint32_t>(idr);
+  sample_channel.memory_address = static_cast<std::uint32_t>(samples);
+  sample_channel.transfer_amount = static_cast<std::uint32_t>(m_samples.size());
+
+  m_running = true;
+  running_scanner[index] = this;
+
+  initialize_interrupts();
+  switch (m_settings.timer) {
+    case peripheral::timer3:
+      cortex_m::enable_interrupt(
+        irq::dma1_channel6, matrix_frame_interrupt<peripheral::timer3, 6>);
+      break;
+    case peripheral::timer4:
+      cortex_m::enable_interrupt(
+        irq::dma1_channel1, matrix_frame_interrupt<peripheral::timer4, 1>);
+      break;
+    case peripheral::timer2:
+    default:
+      cortex_m::enable_interrupt(
+        irq::dma1_channel1, matrix_frame_interrupt<peripheral::timer2, 1>);
+      break;
+  }
+
+  pattern_channel.configuration = pattern_dma_settings;
+  sample_channel.configuration = sample_dma_settings;
+
+  // Sample half way through each row, once the row has settled. The DMA
+  // request enable of each capture/compare channel is one bit above the last.
+  auto const compare_index = channels.compare - 1U;
+  auto const compare_dma = bit_mask::from(
+    timer_interrupt_enable::capture_compare1_dma.position + compare_index);
+  reg->CCR[compare_index] = (reg->ARR + 1U) / 2U;
+  bit_modify(reg->DIER)
+    .set<timer_interrupt_enable::update_dma>()
+    .set(compare_dma);
+  // The generated update selects the first row now, so that the first
+  // sample is of the first row.
+  bit_modify(reg->EGR).set<timer_event_generation::update>();
+  bit_modify(reg->CR1).set<timer_control::counter_enable>();
+
+  return {};
+}
+
+void matrix_scanner::stop()
+{
+  if (not m_running) {
+    return;
+  }
+
+  auto& reg = *general_purpose_timer(m_settings.timer);
+  bit_modify(reg.CR1).clear<timer_control::counter_enable>();
+  reg.DIER = 0;
+
+  auto const channels = scan_dma_channels(m_settings.timer);
+  dma::dma1->channel[channels.pattern - 1].configuration = 0;
+  dma::dma1->channel[channels.sample - 1].configuration = 0;
+  cortex_m::disable_interrupt(channels.sample_irq);
+  power_off(m_settings.timer);
+  release_scan_resources(m_settings.timer);
+
+  // Release every row and turn the LEDs off
+  auto released = group_mask << m_settings.first_row_pin;
+  if (m_settings.drive_leds) {
+    released |= (group_mask << m_settings.first_led_pin) << 16U;
+  }
+  gpio(m_settings.row_port).bsrr = released;
+
+  m_running = false;
+  running_scanner[timer_index(m_settings.timer)] = nullptr;
+}
+
+void matrix_scanner::set_leds(std::size_t p_row, std::uint8_t p_leds)
+{
+  if (p_row >= size) {
+    return;
+  }
+  m_leds[p_row] = p_leds;
+  // A single word store, the DMA reads either the old or the new pattern
+  m_patterns[p_row] = matrix_row_pattern(p_row,
+                                         m_settings.first_row_pin,
+                                         p_leds,
+                                         m_settings.first_led_pin,
+                                         m_settings.drive_leds);
+}
+
+void matrix_scanner::frame_complete(std::size_t p_frame)
+{
+  if (not m_running) {
+    return;
+  }
+
+  auto const samples = std::span(m_samples).subspan(p_frame * size, size);
+  auto const raw = matrix_frame_keys(samples, m_settings.first_column_pin);
+  auto changed = matrix_debounce(
+    raw, m_keys, m_counting, m_counts, m_settings.debounce_frames);
+
+  if (not m_handler) {
+    return;
+  }
+  while (changed != 0) {
+    auto const key = static_cast<std::uint8_t>(std::countr_zero(changed));
+    changed &= changed - 1U;
+    m_handler({
+      .row = static_cast<std::uint8_t>(key / size),
+      .column = static_cast<std::uint8_t>(key % size),
+      .pressed = ((m_keys >> key) & 1U) != 0,
+    });
+  }
+}
+
+matrix_scanner::~matrix_scanner()
+{
+  stop();
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hal::stm32f1 {
+/**
+ * @brief BSRR word that selects a row and sets its LEDs
+ *
+ * @param p_row - row to select, 0 to 7
+ * @param p_first_row_pin - first of the 8 row pins
+ * @param p_leds - LEDs of the row, bit 0 is `p_first_led_pin`
+ * @param p_first_led_pin - first of the 8 LED pins, ignored unless
+ * p_drive_leds is true
+ * @param p_drive_leds - include the LED pins in the word
+ * @return std::uint32_t - resets the selected row pin and any unlit LED pin,
+ * sets the other row pins and the lit LED pins.
+ */
+std::uint32_t matrix_row_pattern(std::size_t p_row,
+                                 std::uint8_t p_first_row_pin,
+                                 std::uint8_t p_leds,
+                                 std::uint8_t p_first_led_pin,
+                                 bool p_drive_leds);
+
+/**
+ * @brief Pressed keys of a frame of IDR samples
+ *
+ * @param p_samples - IDR sample of each of the 8 rows
+ * @param p_first_column_pin - first of the 8 column pins
+ * @return std::uint64_t - bit `row * 8 + column` is set if the key read low
+ */
+std::uint64_t matrix_frame_keys(std::span<std::uint16_t const> p_samples,
+                                std::uint8_t p_first_column_pin);
+
+/**
+ * @brief Debounce a frame of raw key states
+ *
+ * A key changes state once it has read differently from its state for
+ * p_frames frames in a row. Only keys in p_counting or reading differently
+ * are visited.
+ *
+ * @param p_raw - raw key state of the frame
+ * @param p_keys - debounced key state, updated
+ * @param p_counting - keys with a non-zero count, updated
+ * @param p_counts - count of each key, updated
+ * @param p_frames - frames a key must read the same
+ * @return std::uint64_t - keys that changed state in this frame
+ */
+std::uint64_t matrix_debounce(std::uint64_t p_raw,
+                              std::uint64_t& p_keys,
+                              std::uint64_t& p_counting,
+                              std::span<std::uint8_t> p_counts,
+                              std::uint8_t p_frames);
+}  // namespace hal::stm32f1
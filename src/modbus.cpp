@@ -0,0 +1,407 @@
+#include <libhal-stm32f1/modbus.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "power.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::array<std::uint16_t, 256> crc16_modbus_table = []() {
+  std::array<std::uint16_t, 256> table{};
+  for (std::size_t i = 0; i < table.size(); i++) {
+    auto crc = static_cast<std::uint16_t>(i);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x0001U) ? static_cast<std::uint16_t>((crc >> 1U) ^ 0xA001U)
+                            : static_cast<std::uint16_t>(crc >> 1U);
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+constexpr std::uint8_t broadcast_address = 0;
+constexpr std::uint8_t max_server_address = 247;
+
+constexpr hal::byte read_holding_registers = 0x03;
+constexpr hal::byte read_input_registers = 0x04;
+constexpr hal::byte write_single_register = 0x06;
+constexpr hal::byte write_multiple_registers = 0x10;
+
+constexpr hal::byte illegal_function = 0x01;
+constexpr hal::byte illegal_data_address = 0x02;
+constexpr hal::byte illegal_data_value = 0x03;
+
+constexpr std::size_t max_read_count = 125;
+constexpr std::size_t max_write_count = 123;
+/// Address, function code and CRC
+constexpr std::size_t min_frame_size = 4;
+
+/// Server handling the frames timed by the running timer
+modbus_rtu_server* running_server = nullptr;
+/// Registers of the timer measuring the gaps for the running server
+general_purpose_timer_t* server_timer = nullptr;
+
+void server_timer_interrupt()
+{
+  auto const status = server_timer->SR;
+  server_timer->SR = 0;
+
+  if (running_server == nullptr) {
+    return;
+  }
+  if (bit_extract<timer_status::capture_compare1>(status)) {
+    running_server->gap_elapsed(true);
+  }
+  if (bit_extract<timer_status::update>(status)) {
+    running_server->gap_elapsed(false);
+  }
+}
+
+/// Random access to a frame that may wrap around the end of the receive
+/// buffer
+class frame_reader
+{
+public:
+  explicit frame_reader(std::array<std::span<hal::byte const>, 2> p_frame)
+    : m_frame(p_frame)
+  {
+  }
+
+  [[nodiscard]] std::size_t size() const
+  {
+    return m_frame[0].size() + m_frame[1].size();
+  }
+
+  [[nodiscard]] hal::byte operator[](std::size_t p_index) const
+  {
+    if (p_index < m_frame[0].size()) {
+      return m_frame[0][p_index];
+    }
+    return m_frame[1][p_index - m_frame[0].size()];
+  }
+
+  /// Big endian 16-bit field at p_index
+  [[nodiscard]] std::uint16_t word(std::size_t p_index) const
+  {
+    return static_cast<std::uint16_t>(((*this)[p_index] << 8U) |
+                                      (*this)[p_index + 1]);
+  }
+
+private:
+  std::array<std::span<hal::byte const>, 2> m_frame;
+};
+
+void put_word(std::span<hal::byte> p_destination, std::uint16_t p_value)
+{
+  p_destination[0] = static_cast<hal::byte>(p_value >> 8U);
+  p_destination[1] = static_cast<hal::byte>(p_value);
+}
+}  // namespace
+
+std::uint16_t crc16_modbus(std::span<hal::byte const> p_data,
+                           std::uint16_t p_crc)
+{
+  for (auto const byte : p_data) {
+    auto const index = static_cast<std::uint8_t>(p_crc ^ byte);
+    p_crc = static_cast<std::uint16_t>((p_crc >> 8U) ^
+                                       crc16_modbus_table[index]);
+  }
+  return p_crc;
+}
+
+modbus_rtu_server::modbus_rtu_server(uart& p_uart,
+                                     modbus_register_table p_holding_registers,
+                                     modbus_register_table p_input_registers)
+  : m_uart(&p_uart)
+  , m_holding_registers(p_holding_registers)
+  , m_input_registers(p_input_registers)
+{
+}
+
+std::errc modbus_rtu_server::try_start(modbus_rtu_settings const& p_settings)
+{
+  if (running_server != nullptr) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  if (p_settings.address == broadcast_address ||
+      p_settings.address > max_server_address ||
+      general_purpose_timer(p_settings.timer) == nullptr) {
+    return std::errc::argument_out_of_domain;
+  }
+
+  if (p_settings.baud_rate <= 0.0f) {
+    return std::errc::operation_not_supported;
+  }
+
+  // A character is 11 bits on the wire: start, 8 data, parity or a second
+  // stop bit and stop. Above 19200 baud the gaps are fixed at 750us and
+  // 1750us.
+  constexpr std::int64_t bits_per_character = 11;
+  constexpr std::int64_t fixed_gap_baud_rate = 19'200;
+  auto const baud_rate = static_cast<std::int64_t>(p_settings.baud_rate);
+  auto const character_ns = (bits_per_character * 1'000'000'000LL) / baud_rate;
+  auto t1_5_ns = (character_ns * 3) / 2;
+  auto t3_5_ns = (character_ns * 7) / 2;
+  if (baud_rate > fixed_gap_baud_rate) {
+    t1_5_ns = 750'000;
+    t3_5_ns = 1'750'000;
+  }
+
+  // The idle line interrupt starts the timer one character after the last
+  // byte, so that character is already part of both gaps.
+  auto const t1_5_remaining = std::max<std::int64_t>(t1_5_ns - character_ns, 0);
+  auto const t3_5_remaining = t3_5_ns - character_ns;
+  if (t3_5_remaining <= 0) {
+    return std::errc::operation_not_supported;
+  }
+
+  auto const claimed = claim_timer(p_settings.timer);
+  if (claimed != std::errc{}) {
+    return claimed;
+  }
+
+  auto const status = configure_periodic_timer(
+    p_settings.timer, hal::time_duration(t3_5_remaining));
+  if (status != std::errc{}) {
+    release_timer(p_settings.timer);
+    return status;
+  }
+
+  m_timer = p_settings.timer;
+  m_address = p_settings.address;
+  m_size_at_idle = 0;
+  m_size_at_t1_5 = 0;
+  m_running = true;
+  running_server = this;
+  server_timer = general_purpose_timer(m_timer);
+
+  auto const period = static_cast<std::int64_t>(server_timer->ARR) + 1;
+  server_timer->CCR[0] =
+    static_cast<std::uint32_t>((period * t1_5_remaining) / t3_5_remaining);
+  bit_modify(server_timer->CR1).set<timer_control::one_pulse_mode>();
+
+  initialize_interrupts();
+  cortex_m::enable_interrupt(general_purpose_timer_irq(m_timer),
+                             server_timer_interrupt);
+  bit_modify(server_timer->DIER)
+    .set<timer_interrupt_enable::update>()
+    .set<timer_interrupt_enable::capture_compare1>();
+
+  m_uart->on_receive_idle([this]() { receive_idle(); });
+
+  return {};
+}
+
+void modbus_rtu_server::stop()
+{
+  if (not m_running) {
+    return;
+  }
+
+  m_uart->on_receive_idle({});
+  bit_modify(server_timer->CR1).clear<timer_control::counter_enable>();
+  cortex_m::disable_interrupt(general_purpose_timer_irq(m_timer));
+  power_off(m_timer);
+  release_timer(m_timer);
+
+  m_running = false;
+  running_server = nullptr;
+  server_timer = nullptr;
+}
+
+std::size_t modbus_rtu_server::unread_bytes()
+{
+  auto const view = m_uart->receive_view();
+  return view[0].size() + view[1].size();
+}
+
+void modbus_rtu_server::receive_idle()
+{
+  m_size_at_idle = unread_bytes();
+  m_size_at_t1_5 = m_size_at_idle;
+
+  // Restart the one shot timer, a burst ending before t1.5 has passed
+  // restarts both gaps.
+  bit_modify(server_timer->CR1).clear<timer_control::counter_enable>();
+  server_timer->CNT = 0;
+  server_timer->SR = 0;
+  bit_modify(server_timer->CR1).set<timer_control::counter_enable>();
+}
+
+void modbus_rtu_server::gap_elapsed(bool p_t1_5)
+{
+  if (p_t1_5) {
+    m_size_at_t1_5 = unread_bytes();
+    return;
+  }
+
+  auto const size = unread_bytes();
+  if (size != m_size_at_idle) {
+    if (m_size_at_t1_5 == m_size_at_idle) {
+      // Bytes arrived between t1.5 and t3.5, which voids the frame before
+      // them. The new bytes start the next frame.
+      m_counters.framing_errors++;
+      m_uart->consume(m_size_at_idle);
+    }
+    // Otherwise the frame continued within t1.5 and the idle line at the end
+    // of it restarts the timer.
+    return;
+  }
+
+  auto view = m_uart->receive_view();
+  view[0] = view[0].first(std::min(view[0].size(), m_size_at_idle));
+  view[1] = view[1].first(m_size_at_idle - view[0].size());
+  auto const response = handle(view);
+  m_uart->consume(m_size_at_idle);
+  m_size_at_idle = 0;
+  m_size_at_t1_5 = 0;
+
+  if (not response.empty()) {
+    (void)m_uart->write_async(response);
+  }
+}
+
+std::span<hal::byte const> modbus_rtu_server::handle(
+  std::array<std::span<hal::byte const>, 2> p_frame)
+{
+  frame_reader const frame(p_frame);
+  auto const size = frame.size();
+
+  if (size < min_frame_size || size > max_frame_size) {
+    m_counters.framing_errors++;
+    return {};
+  }
+
+  if (crc16_modbus(p_frame[1], crc16_modbus(p_frame[0])) != 0) {
+    m_counters.crc_errors++;
+    return {};
+  }
+
+  auto const address = frame[0];
+  if (address != m_address && address != broadcast_address) {
+    return {};
+  }
+  m_counters.requests++;
+
+  auto const function = frame[1];
+  auto const response = std::span(m_response);
+  response[0] = m_address;
+  response[1] = function;
+  std::size_t length = 2;
+
+  auto const exception = [&](hal::byte p_code) {
+    m_counters.exceptions++;
+    response[1] = static_cast<hal::byte>(function | 0x80U);
+    response[2] = p_code;
+    length = 3;
+  };
+
+  switch (function) {
+    case read_holding_registers:
+    case read_input_registers: {
+      auto const& table = function == read_holding_registers
+                            ? m_holding_registers
+                            : m_input_registers;
+      // Fields are only read once the frame is known to hold them
+      if (size != 8) {
+        exception(illegal_data_value);
+        break;
+      }
+      auto const count = static_cast<std::size_t>(frame.word(4));
+      if (count == 0 || count > max_read_count) {
+        exception(illegal_data_value);
+        break;
+      }
+      auto const registers = table.find(frame.word(2), count);
+      if (registers.empty()) {
+        exception(illegal_data_address);
+        break;
+      }
+      response[2] = static_cast<hal::byte>(count * 2);
+      length = 3;
+      for (auto const& reg : registers) {
+        put_word(response.subspan(length), *reg.value);
+        length += 2;
+      }
+      break;
+    }
+    case write_single_register: {
+      if (size != 8) {
+        exception(illegal_data_value);
+        break;
+      }
+      auto const registers = m_holding_registers.find(frame.word(2), 1);
+      if (registers.empty() || not registers[0].writable) {
+        exception(illegal_data_address);
+        break;
+      }
+      *registers[0].value = frame.word(4);
+      // The response echoes the request
+      for (; length < 6; length++) {
+        response[length] = frame[length];
+      }
+      break;
+    }
+    case write_multiple_registers: {
+      if (size < 9) {
+        exception(illegal_data_value);
+        break;
+      }
+      auto const count = static_cast<std::size_t>(frame.word(4));
+      auto const byte_count = static_cast<std::size_t>(frame[6]);
+      if (count == 0 || count > max_write_count ||
+          byte_count != count * 2 || size != 9 + byte_count) {
+        exception(illegal_data_value);
+        break;
+      }
+      auto const registers = m_holding_registers.find(frame.word(2), count);
+      auto const writable = [](modbus_register const& p_register) {
+        return p_register.writable;
+      };
+      // Check every register first so that a rejected request changes none
+      if (registers.empty() || not std::ranges::all_of(registers, writable)) {
+        exception(illegal_data_address);
+        break;
+      }
+      for (std::size_t i = 0; i < count; i++) {
+        *registers[i].value = frame.word(7 + (i * 2));
+      }
+      // The response echoes the start address and count
+      for (; length < 6; length++) {
+        response[length] = frame[length];
+      }
+      break;
+    }
+    default:
+      exception(illegal_function);
+      break;
+  }
+
+  // Broadcasts are never answered
+  if (address == broadcast_address) {
+    return {};
+  }
+
+  auto const crc = crc16_modbus(response.first(length));
+  response[length++] = static_cast<hal::byte>(crc);
+  response[length++] = static_cast<hal::byte>(crc >> 8U);
+  return response.first(length);
+}
+
+modbus_rtu_server::~modbus_rtu_server()
+{
+  stop();
+}
+}  // namespace hal::stm32f1
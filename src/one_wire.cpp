@@ -0,0 +1,432 @@
+#include <libhal-stm32f1/one_wire.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-armcortex/system_control.hpp>
+#include <libhal-stm32f1/async.hpp>
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal/error.hpp>
+
+#include "dma.hpp"
+#include "one_wire.hpp"
+#include "pin.hpp"
+#include "power.hpp"
+#include "uart.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::uint64_t slot_baud_rate = 115'200;
+constexpr std::uint64_t reset_baud_rate = 9'600;
+/// Low for the start bit and 4 data bits, 520us at 9600 baud
+constexpr hal::byte reset_pulse = 0xF0;
+
+constexpr hal::byte match_rom = 0x55;
+constexpr hal::byte skip_rom = 0xCC;
+constexpr hal::byte search_rom = 0xF0;
+constexpr hal::byte alarm_search = 0xEC;
+
+constexpr auto one_wire_receive_settings =
+  hal::bit_value()
+    .set<dma::transfer_complete_interrupt_enable>()
+    .clear<dma::data_transfer_direction>()  // Read from peripheral
+    .set<dma::memory_increment_enable>()
+    .set<dma::enable>()
+    .insert<dma::channel_priority, 0b10U>()  // Low Medium [High] Very_High
+    .to<std::uint32_t>();
+
+constexpr auto one_wire_transmit_settings =
+  hal::bit_value()
+    .set<dma::data_transfer_direction>()  // Read from memory
+    .set<dma::memory_increment_enable>()
+    .set<dma::enable>()
+    .insert<dma::channel_priority, 0b01U>()  // Low [Medium] High Very_High
+    .to<std::uint32_t>();
+
+/// Completion of the slot transfers of each usart
+std::array<async_event, 3> one_wire_event{};
+
+constexpr std::array<std::uint8_t, 256> crc8_maxim_table = []() {
+  std::array<std::uint8_t, 256> table{};
+  for (std::size_t i = 0; i < table.size(); i++) {
+    auto crc = static_cast<std::uint8_t>(i);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x01U) ? static_cast<std::uint8_t>((crc >> 1U) ^ 0x8CU)
+                          : static_cast<std::uint8_t>(crc >> 1U);
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+inline usart_t* to_usart(void* p_usart)
+{
+  return reinterpret_cast<usart_t*>(p_usart);
+}
+
+void stop_channel(std::uint8_t p_channel)
+{
+  // Clear every flag of the channel: global, complete, half and error
+  dma::dma1->interrupt_flag_clear = 0xFUL << ((p_channel - 1U) * 4U);
+  bit_modify(dma::dma1->channel[p_channel - 1].configuration)
+    .clear<dma::enable>();
+}
+
+template<std::size_t port, std::uint8_t rx_channel, std::uint8_t tx_channel>
+void one_wire_transfer_complete()
+{
+  stop_channel(rx_channel);
+  stop_channel(tx_channel);
+  one_wire_event[port].signal();
+}
+}  // namespace
+
+std::uint8_t crc8_maxim(std::span<hal::byte const> p_data, std::uint8_t p_crc)
+{
+  for (auto const byte : p_data) {
+    p_crc = crc8_maxim_table[static_cast<std::uint8_t>(p_crc ^ byte)];
+  }
+  return p_crc;
+}
+
+void one_wire_encode_slots(std::span<hal::byte const> p_bytes,
+                           std::span<hal::byte> p_slots)
+{
+  for (std::size_t i = 0; i < p_bytes.size(); i++) {
+    for (std::size_t bit = 0; bit < 8; bit++) {
+      p_slots[(i * 8) + bit] = ((p_bytes[i] >> bit) & 1U) ? one_wire_slot_one
+                                                          : one_wire_slot_zero;
+    }
+  }
+}
+
+void one_wire_decode_slots(std::span<hal::byte const> p_slots,
+                           std::span<hal::byte> p_bytes)
+{
+  for (std::size_t i = 0; i < p_bytes.size(); i++) {
+    hal::byte value = 0;
+    for (std::size_t bit = 0; bit < 8; bit++) {
+      if (p_slots[(i * 8) + bit] == one_wire_slot_one) {
+        value = static_cast<hal::byte>(value | (1U << bit));
+      }
+    }
+    p_bytes[i] = value;
+  }
+}
+
+std::optional<bool> one_wire_rom_search::next_direction(std::size_t p_bit,
+                                                        bool p_id_bit,
+                                                        bool p_complement_bit)
+{
+  if (p_id_bit && p_complement_bit) {
+    return std::nullopt;
+  }
+
+  auto const bit = static_cast<int>(p_bit);
+  auto const byte = p_bit / 8;
+  auto const mask = static_cast<hal::byte>(1U << (p_bit % 8));
+  bool direction = p_id_bit;
+
+  if (p_id_bit == p_complement_bit) {
+    // Devices with both values are left, take the 1 branch at the last
+    // discrepancy, the branch of the previous pass before it and the 0
+    // branch after it.
+    if (bit < m_last_discrepancy) {
+      direction = (m_rom[byte] & mask) != 0;
+    } else {
+      direction = (bit == m_last_discrepancy);
+    }
+    if (not direction) {
+      m_last_zero = bit;
+    }
+  }
+
+  if (direction) {
+    m_rom[byte] = static_cast<hal::byte>(m_rom[byte] | mask);
+  } else {
+    m_rom[byte] = static_cast<hal::byte>(m_rom[byte] & ~mask);
+  }
+  return direction;
+}
+
+one_wire::one_wire(hal::runtime, std::uint8_t p_port, uart_pins p_pins)
+  : one_wire(p_port, p_pins)
+{
+}
+
+one_wire::one_wire(std::uint8_t p_port, uart_pins p_pins)
+  : m_usart(nullptr)
+  , m_index(0)
+  , m_id{}
+  , m_tx_dma(0)
+  , m_rx_dma(0)
+  , m_reset_divider(0)
+  , m_slot_divider(0)
+{
+  auto const pins = uart_pin_map(p_port, p_pins);
+  if (not pins) {
+    hal::safe_throw(hal::operation_not_supported(this));
+  }
+
+  switch (p_port) {
+    case 1:
+      m_id = peripheral::usart1;
+      m_usart = usart1;
+      m_tx_dma = 4;
+      m_rx_dma = 5;
+      break;
+    case 2:
+      m_id = peripheral::usart2;
+      m_usart = usart2;
+      m_tx_dma = 7;
+      m_rx_dma = 6;
+      break;
+    case 3:
+      m_id = peripheral::usart3;
+      m_usart = usart3;
+      m_tx_dma = 2;
+      m_rx_dma = 3;
+      break;
+    default:
+      hal::safe_throw(hal::operation_not_supported(this));
+  }
+  m_index = p_port - 1U;
+
+  auto const clock = static_cast<std::uint32_t>(frequency(m_id));
+  auto const reset_divider = uart_baud_rate_register(clock, reset_baud_rate);
+  auto const slot_divider = uart_baud_rate_register(clock, slot_baud_rate);
+  if (not reset_divider || not slot_divider) {
+    hal::safe_throw(hal::operation_not_supported(this));
+  }
+  m_reset_divider = *reset_divider;
+  m_slot_divider = *slot_divider;
+
+  if (dma::claim_channel(m_rx_dma) != std::errc{}) {
+    hal::safe_throw(hal::device_or_resource_busy(this));
+  }
+  if (dma::claim_channel(m_tx_dma) != std::errc{}) {
+    dma::release_channel(m_rx_dma);
+    hal::safe_throw(hal::device_or_resource_busy(this));
+  }
+
+  power_on(m_id);
+  power_on(peripheral::dma1);
+
+  auto& reg = *to_usart(m_usart);
+  // 8N1, the transmitter and receiver share the TX pin
+  reg.baud_rate = m_slot_divider;
+  reg.control2 = 0;
+  reg.control3 = bit_value(0U)
+                   .set<control_reg::half_duplex_selection>()
+                   .set<control_reg::dma_receiver_enable>()
+                   .set<control_reg::dma_transmitter_enable>()
+                   .get();
+  reg.control1 = control_reg::control_settings1;
+
+  remap_pins(p_port, p_pins);
+  // The bus is pulled up externally, the usart only ever pulls it low
+  configure_pin(pins->tx, open_drain_alternative_output);
+
+  initialize_interrupts();
+  switch (m_id) {
+    case peripheral::usart2:
+      cortex_m::enable_interrupt(irq::dma1_channel6,
+                                 one_wire_transfer_complete<1, 6, 7>);
+      break;
+    case peripheral::usart3:
+      cortex_m::enable_interrupt(irq::dma1_channel3,
+                                 one_wire_transfer_complete<2, 3, 2>);
+      break;
+    case peripheral::usart1:
+    default:
+      cortex_m::enable_interrupt(irq::dma1_channel5,
+                                 one_wire_transfer_complete<0, 5, 4>);
+      break;
+  }
+}
+
+one_wire::~one_wire()
+{
+  switch (m_id) {
+    case peripheral::usart2:
+      cortex_m::disable_interrupt(irq::dma1_channel6);
+      break;
+    case peripheral::usart3:
+      cortex_m::disable_interrupt(irq::dma1_channel3);
+      break;
+    case peripheral::usart1:
+    default:
+      cortex_m::disable_interrupt(irq::dma1_channel5);
+      break;
+  }
+  to_usart(m_usart)->control3 = 0;
+  dma::release_channel(m_rx_dma);
+  dma::release_channel(m_tx_dma);
+}
+
+void one_wire::transfer(std::span<hal::byte> p_slots)
+{
+  auto& reg = *to_usart(m_usart);
+  auto& event = one_wire_event[m_index];
+  auto& receive = dma::dma1->channel[m_rx_dma - 1];
+  auto& transmit = dma::dma1->channel[m_tx_dma - 1];
+
+  auto const data_address = reinterpret_cast<intptr_t>(&reg.data);
+  auto const slot_address = reinterpret_cast<intptr_t>(p_slots.data());
+  auto const count = static_cast<std::uint32_t>(p_slots.size());
+
+  event.reset();
+  // Drop a stale byte so that the echo lines up with the slots
+  (void)reg.status;
+  (void)reg.data;
+
+  // The echo overwrites each slot after the transmit DMA has taken it
+  receive.configuration = 0;
+  receive.peripheral_address = static_cast<std::uint32_t>(data_address);
+  receive.memory_address = static_cast<std::uint32_t>(slot_address);
+  receive.transfer_amount = count;
+  receive.configuration = one_wire_receive_settings;
+
+  transmit.configuration = 0;
+  transmit.peripheral_address = static_cast<std::uint32_t>(data_address);
+  transmit.memory_address = static_cast<std::uint32_t>(slot_address);
+  transmit.transfer_amount = count;
+  transmit.configuration = one_wire_transmit_settings;
+
+  // Sleep until the last echo is in. Interrupts are masked while checking
+  // so that the completion cannot slip in between the check and WFI.
+  while (true) {
+    cortex_m::disable_all_interrupts();
+    auto const done = event.is_signaled();
+    if (not done) {
+      cortex_m::wait_for_interrupt();
+    }
+    cortex_m::enable_all_interrupts();
+    if (done) {
+      return;
+    }
+  }
+}
+
+bool one_wire::reset()
+{
+  auto& reg = *to_usart(m_usart);
+
+  reg.baud_rate = m_reset_divider;
+  m_slots[0] = reset_pulse;
+  transfer(std::span(m_slots).first(1));
+  reg.baud_rate = m_slot_divider;
+
+  // Presence pulses pull the bus low during the data bits
+  return m_slots[0] != reset_pulse;
+}
+
+void one_wire::write(std::span<hal::byte const> p_data)
+{
+  constexpr std::size_t bytes_per_transfer = 8;
+
+  while (not p_data.empty()) {
+    auto const chunk =
+      p_data.first(std::min(p_data.size(), bytes_per_transfer));
+    auto const slots = std::span(m_slots).first(chunk.size() * 8);
+    one_wire_encode_slots(chunk, slots);
+    transfer(slots);
+    p_data = p_data.subspan(chunk.size());
+  }
+}
+
+std::span<hal::byte> one_wire::read(std::span<hal::byte> p_data)
+{
+  constexpr std::size_t bytes_per_transfer = 8;
+
+  for (std::size_t i = 0; i < p_data.size(); i += bytes_per_transfer) {
+    auto const chunk =
+      p_data.subspan(i, std::min(p_data.size() - i, bytes_per_transfer));
+    auto const slots = std::span(m_slots).first(chunk.size() * 8);
+    std::ranges::fill(slots, one_wire_slot_one);
+    transfer(slots);
+    one_wire_decode_slots(slots, chunk);
+  }
+
+  return p_data;
+}
+
+bool one_wire::select(rom_code const& p_rom)
+{
+  if (not reset()) {
+    return false;
+  }
+  std::array<hal::byte, 1> const command{ match_rom };
+  write(command);
+  write(p_rom);
+  return true;
+}
+
+bool one_wire::select_all()
+{
+  if (not reset()) {
+    return false;
+  }
+  std::array<hal::byte, 1> const command{ skip_rom };
+  write(command);
+  return true;
+}
+
+std::size_t one_wire::search(std::span<rom_code> p_roms, bool p_alarm_only)
+{
+  one_wire_rom_search state;
+  std::size_t found = 0;
+  std::array<hal::byte, 1> const command{ p_alarm_only ? alarm_search
+                                                       : search_rom };
+
+  while (found < p_roms.size()) {
+    if (not reset()) {
+      break;
+    }
+    write(command);
+
+    state.begin_pass();
+    std::optional<bool> direction{};
+    for (std::size_t bit = 0; bit < 64; bit++) {
+      // Write the direction of the previous bit, then read this one twice
+      std::size_t count = 0;
+      if (direction) {
+        m_slots[count++] = *direction ? one_wire_slot_one : one_wire_slot_zero;
+      }
+      m_slots[count++] = one_wire_slot_one;
+      m_slots[count++] = one_wire_slot_one;
+      transfer(std::span(m_slots).first(count));
+
+      direction = state.next_direction(bit,
+                                       m_slots[count - 2] == one_wire_slot_one,
+                                       m_slots[count - 1] == one_wire_slot_one);
+      if (not direction) {
+        return found;
+      }
+    }
+    m_slots[0] = *direction ? one_wire_slot_one : one_wire_slot_zero;
+    transfer(std::span(m_slots).first(1));
+
+    // A bus held low reads as the all zero code, which passes the CRC
+    if (crc8_maxim(state.rom()) != 0 || state.rom()[0] == 0) {
+      break;
+    }
+    p_roms[found++] = state.rom();
+
+    if (not state.end_pass()) {
+      break;
+    }
+  }
+
+  return found;
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/units.hpp>
+
+namespace hal::stm32f1 {
+/// usart byte of a write 1 or read slot, only the start bit is low
+constexpr hal::byte one_wire_slot_one = 0xFF;
+/// usart byte of a write 0 slot
+constexpr hal::byte one_wire_slot_zero = 0x00;
+
+/**
+ * @brief Turn bytes into one usart byte per bit, least significant bit first
+ *
+ * @param p_bytes - bytes to send
+ * @param p_slots - slots, 8 per byte
+ */
+void one_wire_encode_slots(std::span<hal::byte const> p_bytes,
+                           std::span<hal::byte> p_slots);
+
+/**
+ * @brief Turn the echo of the slots back into bytes
+ *
+ * A bit is 1 only if nothing pulled the bus low after the start bit.
+ *
+ * @param p_slots - received echo, 8 slots per byte
+ * @param p_bytes - bytes read
+ */
+void one_wire_decode_slots(std::span<hal::byte const> p_slots,
+                           std::span<hal::byte> p_bytes);
+
+/// Decisions of the ROM search, Maxim application note 187
+class one_wire_rom_search
+{
+public:
+  /**
+   * @brief Start a pass over the 64 ROM bits
+   */
+  void begin_pass()
+  {
+    m_last_zero = -1;
+  }
+
+  /**
+   * @brief Choose the direction at a ROM bit from the two reads
+   *
+   * @param p_bit - ROM bit, 0 to 63
+   * @param p_id_bit - first read, the wired AND of the devices' bits
+   * @param p_complement_bit - second read, the wired AND of the complements
+   * @return std::optional<bool> - bit value to write, which keeps the devices
+   * with that value in the search. std::nullopt if no device answered.
+   */
+  std::optional<bool> next_direction(std::size_t p_bit,
+                                     bool p_id_bit,
+                                     bool p_complement_bit);
+
+  /**
+   * @brief Finish a pass
+   *
+   * @return true - another device is left to be found
+   * @return false - the search is complete
+   */
+  bool end_pass()
+  {
+    m_last_discrepancy = m_last_zero;
+    return m_last_discrepancy >= 0;
+  }
+
+  /**
+   * @return std::array<hal::byte, 8> const& - ROM code of the last pass
+   */
+  [[nodiscard]] std::array<hal::byte, 8> const& rom() const
+  {
+    return m_rom;
+  }
+
+private:
+  std::array<hal::byte, 8> m_rom{};
+  int m_last_discrepancy = -1;
+  int m_last_zero = -1;
+};
+}  // namespace hal::stm32f1
@@ -15,6 +15,7 @@
 #include <libhal-stm32f1/pin.hpp>
 
 #include <cstdint>
+#include <system_error>
 
 #include <libhal-util/bit.hpp>
 #include <libhal-util/enum.hpp>
@@ -70,7 +71,7 @@ gpio_t& gpio(std::uint8_t p_port)
   }
 };
 
-void configure_pin(pin_select_t p_pin_select, pin_config_t p_config)
+std::errc try_configure_pin(pin_select_t p_pin_select, pin_config_t p_config)
 {
   constexpr auto cnf1 = bit_mask::from<3>();
   constexpr auto cnf0 = bit_mask::from<2>();
@@ -96,7 +97,7 @@ void configure_pin(pin_select_t p_pin_select, pin_config_t p_config)
       power_on(peripheral::gpio_e);
       break;
     default:
-      hal::safe_throw(hal::argument_out_of_domain(nullptr));
+      return std::errc::argument_out_of_domain;
   }
 
   auto config = bit_value<std::uint32_t>(0)
@@ -108,6 +109,15 @@ void configure_pin(pin_select_t p_pin_select, pin_config_t p_config)
   config_register(p_pin_select) = bit_modify(config_register(p_pin_select))
                                     .insert(mask(p_pin_select.pin), config)
                                     .to<std::uint32_t>();
+
+  return {};
+}
+
+void configure_pin(pin_select_t p_pin_select, pin_config_t p_config)
+{
+  if (try_configure_pin(p_pin_select, p_config) != std::errc{}) {
+    hal::safe_throw(hal::argument_out_of_domain(nullptr));
+  }
 }
 
 void release_jtag_pins()
@@ -132,4 +142,31 @@ void remap_pins(can_pins p_pin_select)
     .insert<can_pin_remap>(value(p_pin_select));
 }
 
+void remap_pins(std::uint8_t p_port, uart_pins p_pin_select)
+{
+  constexpr auto usart1_remap = bit_mask::from<2>();
+  constexpr auto usart2_remap = bit_mask::from<3>();
+  constexpr auto usart3_remap = bit_mask::from<4, 5>();
+
+  // Ensure that AFIO is powered on before attempting to access it
+  power_on(peripheral::afio);
+
+  auto const remap = value(p_pin_select);
+  switch (p_port) {
+    case 1:
+      bit_modify(alternative_function_io->mapr)
+        .insert<usart1_remap>(remap & 1U);
+      break;
+    case 2:
+      bit_modify(alternative_function_io->mapr)
+        .insert<usart2_remap>(remap & 1U);
+      break;
+    case 3:
+      bit_modify(alternative_function_io->mapr).insert<usart3_remap>(remap);
+      break;
+    default:
+      break;
+  }
+}
+
 }  // namespace hal::stm32f1
@@ -16,6 +16,7 @@
 
 #include <array>
 #include <cstdint>
+#include <system_error>
 
 #include <libhal/error.hpp>
 
@@ -27,7 +28,7 @@ struct alternative_function_io_t
 {
   std::uint32_t volatile evcr;
   std::uint32_t volatile mapr;
-  std::array<std::uint32_t, 4> volatile exticr;
+  std::array<std::uint32_t volatile, 4> exticr;
   std::uint32_t reserved0;
   std::uint32_t volatile mapr2;
 };
@@ -136,9 +137,21 @@ static constexpr pin_config_t input_pull_up = {
  *
  * @param p_pin_select - the pin to configure
  * @param p_config - Configuration to set the pin to
+ * @throws hal::argument_out_of_domain - if the port is not valid
  */
 void configure_pin(pin_select_t p_pin_select, pin_config_t p_config);
 
+/**
+ * @brief Non-throwing version of `configure_pin()`
+ *
+ * @param p_pin_select - the pin to configure
+ * @param p_config - Configuration to set the pin to
+ * @return std::errc - std::errc{} on success, std::errc::argument_out_of_domain
+ * if the port is not valid.
+ */
+[[nodiscard]] std::errc try_configure_pin(pin_select_t p_pin_select,
+                                          pin_config_t p_config);
+
 /**
  * @brief Remap can pins
  *
@@ -146,6 +159,15 @@ void configure_pin(pin_select_t p_pin_select, pin_config_t p_config);
  */
 void remap_pins(can_pins p_pin_select);
 
+/**
+ * @brief Remap usart pins
+ *
+ * @param p_port - usart port number, 1 to 3
+ * @param p_pin_select - set of pins to select, `full_remap` is only available
+ * on port 3.
+ */
+void remap_pins(std::uint8_t p_port, uart_pins p_pin_select);
+
 /**
  * @brief Returns the gpio register based on the port
  *
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Power control register map
+struct power_control_t
+{
+  /// Power control register
+  std::uint32_t volatile cr;
+  /// Power control/status register
+  std::uint32_t volatile csr;
+};
+
+inline auto* pwr_reg = reinterpret_cast<power_control_t*>(0x4000'7000);
+
+/// Cortex-M3 system control register (SCB_SCR)
+inline auto* system_control_reg =
+  reinterpret_cast<std::uint32_t volatile*>(0xE000'ED10);
+
+/// Bit masks of the power control register (PWR_CR)
+struct power_control  // NOLINT
+{
+  /// Run the voltage regulator in low power mode during Stop mode
+  static constexpr auto low_power_deepsleep = bit_mask::from<0>();
+  /// Enter Standby instead of Stop mode on deep sleep
+  static constexpr auto power_down_deepsleep = bit_mask::from<1>();
+  /// Write 1 to clear the wakeup flag
+  static constexpr auto clear_wakeup_flag = bit_mask::from<2>();
+};
+
+/// Bit masks of the system control register (SCB_SCR)
+struct system_control  // NOLINT
+{
+  /// Use deep sleep (Stop or Standby) instead of sleep on WFI/WFE
+  static constexpr auto sleep_deep = bit_mask::from<2>();
+  /// Pending interrupts, including disabled ones, wake the core from WFE
+  static constexpr auto send_event_on_pending = bit_mask::from<4>();
+};
+}  // namespace hal::stm32f1
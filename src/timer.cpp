@@ -0,0 +1,165 @@
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <system_error>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "critical_section.hpp"
+#include "pin.hpp"
+#include "power.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Timers claimed by a driver, bit 0 is timer1
+std::uint32_t claimed_timers = 0;
+
+/// Claim bit of timer1 to timer4, 0 for any other peripheral
+std::uint32_t claim_bit(peripheral p_timer)
+{
+  switch (p_timer) {
+    case peripheral::timer1:
+      return 1U << 0U;
+    case peripheral::timer2:
+      return 1U << 1U;
+    case peripheral::timer3:
+      return 1U << 2U;
+    case peripheral::timer4:
+      return 1U << 3U;
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+general_purpose_timer_t* general_purpose_timer(peripheral p_timer)
+{
+  switch (p_timer) {
+    case peripheral::timer2:
+      return timer2_reg;
+    case peripheral::timer3:
+      return timer3_reg;
+    case peripheral::timer4:
+      return timer4_reg;
+    default:
+      return nullptr;
+  }
+}
+
+irq general_purpose_timer_irq(peripheral p_timer)
+{
+  switch (p_timer) {
+    case peripheral::timer3:
+      return irq::tim3;
+    case peripheral::timer4:
+      return irq::tim4;
+    case peripheral::timer2:
+    default:
+      return irq::tim2;
+  }
+}
+
+std::errc claim_timer(peripheral p_timer)
+{
+  auto const bit = claim_bit(p_timer);
+  if (bit == 0) {
+    return std::errc::argument_out_of_domain;
+  }
+  // timer1 shares the layout of every register read here
+  auto const* reg = (p_timer == peripheral::timer1)
+                      ? timer1_reg
+                      : general_purpose_timer(p_timer);
+
+  critical_section guard;
+  if ((claimed_timers & bit) != 0 ||
+      bit_extract<timer_control::counter_enable>(reg->CR1)) {
+    return std::errc::device_or_resource_busy;
+  }
+  claimed_timers |= bit;
+  return {};
+}
+
+void release_timer(peripheral p_timer)
+{
+  critical_section guard;
+  claimed_timers &= ~claim_bit(p_timer);
+}
+
+std::optional<pin_select_t> general_purpose_timer_pin(peripheral p_timer,
+                                                      std::uint8_t p_channel)
+{
+  // Channels 1 to 4 of each timer, RM0008 section 9.3.7
+  constexpr std::array<pin_select_t, 4> timer2_pins{ {
+    { .port = 'A', .pin = 0 },
+    { .port = 'A', .pin = 1 },
+    { .port = 'A', .pin = 2 },
+    { .port = 'A', .pin = 3 },
+  } };
+  constexpr std::array<pin_select_t, 4> timer3_pins{ {
+    { .port = 'A', .pin = 6 },
+    { .port = 'A', .pin = 7 },
+    { .port = 'B', .pin = 0 },
+    { .port = 'B', .pin = 1 },
+  } };
+  constexpr std::array<pin_select_t, 4> timer4_pins{ {
+    { .port = 'B', .pin = 6 },
+    { .port = 'B', .pin = 7 },
+    { .port = 'B', .pin = 8 },
+    { .port = 'B', .pin = 9 },
+  } };
+
+  if (p_channel < 1 || p_channel > 4) {
+    return std::nullopt;
+  }
+
+  switch (p_timer) {
+    case peripheral::timer2:
+      return timer2_pins[p_channel - 1U];
+    case peripheral::timer3:
+      return timer3_pins[p_channel - 1U];
+    case peripheral::timer4:
+      return timer4_pins[p_channel - 1U];
+    default:
+      return std::nullopt;
+  }
+}
+
+std::errc configure_periodic_timer(peripheral p_timer,
+                                   hal::time_duration p_period)
+{
+  auto* reg = general_purpose_timer(p_timer);
+  if (reg == nullptr) {
+    return std::errc::argument_out_of_domain;
+  }
+
+  // Both the prescaler and the auto-reload register are 16-bit, so the
+  // number of timer clock cycles per period is split across the two.
+  auto const timer_frequency = static_cast<std::uint64_t>(frequency(p_timer));
+  auto const cycles =
+    (timer_frequency * static_cast<std::uint64_t>(p_period.count())) /
+    1'000'000'000ULL;
+  auto const prescale = (cycles + 0xFFFFULL) / 0x10000ULL;
+
+  if (cycles < 2 || prescale > 0x10000ULL) {
+    return std::errc::operation_not_supported;
+  }
+
+  power_on(p_timer);
+
+  reg->CR1 = 0;
+  reg->SMCR = 0;
+  reg->DIER = 0;
+  reg->PSC = static_cast<std::uint32_t>(prescale - 1U);
+  reg->ARR = static_cast<std::uint32_t>((cycles / prescale) - 1U);
+  reg->CNT = 0;
+  // Load the prescaler now rather than at the first overflow
+  bit_modify(reg->EGR).set<timer_event_generation::update>();
+  reg->SR = 0;
+
+  return {};
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <optional>
+#include <system_error>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal/units.hpp>
+
+#include "pin.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Registers of a general purpose timer
+ *
+ * @param p_timer - timer2, timer3 or timer4
+ * @return general_purpose_timer_t* - the timer's registers or nullptr if the
+ * peripheral is not a supported general purpose timer.
+ */
+general_purpose_timer_t* general_purpose_timer(peripheral p_timer);
+
+/**
+ * @brief Global interrupt of a general purpose timer
+ *
+ * @param p_timer - timer2, timer3 or timer4
+ * @return irq - interrupt request number of the timer
+ */
+irq general_purpose_timer_irq(peripheral p_timer);
+
+/**
+ * @brief Pin of an input channel of a general purpose timer, without remap
+ *
+ * @param p_timer - timer2, timer3 or timer4
+ * @param p_channel - channel, 1 to 4
+ * @return std::optional<pin_select_t> - pin of the channel or std::nullopt if
+ * the timer or channel is not supported.
+ */
+std::optional<pin_select_t> general_purpose_timer_pin(peripheral p_timer,
+                                                      std::uint8_t p_channel);
+
+/**
+ * @brief Take a timer for the exclusive use of a driver
+ *
+ * Drivers that take over a timer claim it first, so that two of them, or a
+ * driver and a timer started elsewhere, never share one without noticing.
+ *
+ * @param p_timer - timer1 to timer4
+ * @return std::errc - std::errc{} on success,
+ * std::errc::argument_out_of_domain if the timer is not supported and
+ * std::errc::device_or_resource_busy if the timer is claimed or its counter
+ * is already running.
+ */
+[[nodiscard]] std::errc claim_timer(peripheral p_timer);
+
+/**
+ * @brief Give back a timer taken with `claim_timer()`
+ *
+ * @param p_timer - timer1 to timer4
+ */
+void release_timer(peripheral p_timer);
+
+/**
+ * @brief Power on a general purpose timer and set it up to overflow
+ * periodically
+ *
+ * The timer is left stopped with its registers reset apart from the
+ * prescaler and auto-reload registers.
+ *
+ * @param p_timer - timer2, timer3 or timer4
+ * @param p_period - time between two update events
+ * @return std::errc - std::errc{} on success,
+ * std::errc::argument_out_of_domain if the timer is not supported and
+ * std::errc::operation_not_supported if the period cannot be generated from
+ * the timer's clock.
+ */
+[[nodiscard]] std::errc configure_periodic_timer(peripheral p_timer,
+                                                 hal::time_duration p_period);
+}  // namespace hal::stm32f1
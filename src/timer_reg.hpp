@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// General purpose timer registers (TIM2 to TIM5), RM0008 pg. 408
+struct general_purpose_timer_t
+{
+  /// Control register 1
+  std::uint32_t volatile CR1;
+  /// Control register 2
+  std::uint32_t volatile CR2;
+  /// Slave mode control register
+  std::uint32_t volatile SMCR;
+  /// DMA/Interrupt enable register
+  std::uint32_t volatile DIER;
+  /// Status register
+  std::uint32_t volatile SR;
+  /// Event generation register
+  std::uint32_t volatile EGR;
+  /// Capture/compare mode register 1
+  std::uint32_t volatile CCMR1;
+  /// Capture/compare mode register 2
+  std::uint32_t volatile CCMR2;
+  /// Capture/compare enable register
+  std::uint32_t volatile CCER;
+  /// Counter
+  std::uint32_t volatile CNT;
+  /// Prescaler
+  std::uint32_t volatile PSC;
+  /// Auto-reload register
+  std::uint32_t volatile ARR;
+  std::uint32_t reserved0;
+  /// Capture/compare registers 1 to 4
+  std::array<std::uint32_t volatile, 4> CCR;
+  std::uint32_t reserved1;
+  /// DMA control register
+  std::uint32_t volatile DCR;
+  /// DMA address for full transfer
+  std::uint32_t volatile DMAR;
+};
+
+/// The advanced control timer (TIM1) shares this layout for every register
+/// used here. reserved0 holds its repetition counter and reserved1 its break
+/// and dead-time register.
+inline auto* timer1_reg =
+  reinterpret_cast<general_purpose_timer_t*>(0x4001'2C00);
+inline auto* timer2_reg =
+  reinterpret_cast<general_purpose_timer_t*>(0x4000'0000);
+inline auto* timer3_reg =
+  reinterpret_cast<general_purpose_timer_t*>(0x4000'0400);
+inline auto* timer4_reg =
+  reinterpret_cast<general_purpose_timer_t*>(0x4000'0800);
+
+/// Bit masks of the control register 1 (CR1)
+struct timer_control  // NOLINT
+{
+  /// Enables the counter
+  static constexpr auto counter_enable = bit_mask::from<0>();
+  /// Disables the generation of update events
+  static constexpr auto update_disable = bit_mask::from<1>();
+  /// Only counter overflow/underflow generates an update interrupt or DMA
+  /// request
+  static constexpr auto update_request_source = bit_mask::from<2>();
+  /// Stops the counter at the next update event
+  static constexpr auto one_pulse_mode = bit_mask::from<3>();
+  /// Counts down when set
+  static constexpr auto direction = bit_mask::from<4>();
+  /// Buffers the auto-reload register
+  static constexpr auto auto_reload_preload = bit_mask::from<7>();
+};
+
+/// Bit masks of the slave mode control register (SMCR)
+struct timer_slave_mode  // NOLINT
+{
+  /// Slave mode selection, 0b100 resets the counter on a trigger
+  static constexpr auto slave_mode_selection = bit_mask::from<0, 2>();
+  /// Trigger selection
+  static constexpr auto trigger_selection = bit_mask::from<4, 6>();
+};
+
+/// Bit masks of the DMA/interrupt enable register (DIER)
+struct timer_interrupt_enable  // NOLINT
+{
+  /// Update interrupt enable
+  static constexpr auto update = bit_mask::from<0>();
+  /// Capture/compare 1 interrupt enable
+  static constexpr auto capture_compare1 = bit_mask::from<1>();
+  /// Trigger interrupt enable
+  static constexpr auto trigger = bit_mask::from<6>();
+  /// Update DMA request enable
+  static constexpr auto update_dma = bit_mask::from<8>();
+  /// Capture/compare 1 DMA request enable
+  static constexpr auto capture_compare1_dma = bit_mask::from<9>();
+};
+
+/// Bit masks of the status register (SR). Flags are cleared by writing 0.
+struct timer_status  // NOLINT
+{
+  /// Update interrupt flag
+  static constexpr auto update = bit_mask::from<0>();
+  /// Capture/compare 1 interrupt flag
+  static constexpr auto capture_compare1 = bit_mask::from<1>();
+  /// Trigger interrupt flag
+  static constexpr auto trigger = bit_mask::from<6>();
+  /// Capture/compare 1 overcapture flag
+  static constexpr auto capture_compare1_overcapture = bit_mask::from<9>();
+};
+
+/// Bit masks of an input capture channel in the capture/compare mode
+/// registers (CCMR1, CCMR2). The fields are those of the first channel of the
+/// register, the second channel's fields are 8 bits higher.
+struct timer_capture_mode  // NOLINT
+{
+  /// 0b01 maps the channel to its own input pin
+  static constexpr auto selection = bit_mask::from<0, 1>();
+  /// Captures once every 2^n edges
+  static constexpr auto prescaler = bit_mask::from<2, 3>();
+  /// Number of consecutive samples an edge must last
+  static constexpr auto filter = bit_mask::from<4, 7>();
+};
+
+/// Bit masks of channel 1 in the capture/compare enable register (CCER), the
+/// bits of each further channel are 4 bits higher.
+struct timer_capture_enable  // NOLINT
+{
+  /// Enables the capture
+  static constexpr auto enable = bit_mask::from<0>();
+  /// Captures falling edges when set, rising edges when cleared
+  static constexpr auto falling_edge = bit_mask::from<1>();
+};
+
+/// Bit masks of the event generation register (EGR)
+struct timer_event_generation  // NOLINT
+{
+  /// Reinitializes the counter and loads the prescaler
+  static constexpr auto update = bit_mask::from<0>();
+};
+}  // namespace hal::stm32f1
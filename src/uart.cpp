@@ -1,15 +1,25 @@
-#include <cmath>
-
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
 #include <libhal-stm32f1/clock.hpp>
 #include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
 #include <libhal-stm32f1/uart.hpp>
 #include <libhal-util/bit.hpp>
+#include <libhal-util/bit_limits.hpp>
 #include <libhal/error.hpp>
 
 #include "dma.hpp"
 #include "libhal-stm32f1/dma.hpp"
+#include "critical_section.hpp"
 #include "pin.hpp"
 #include "power.hpp"
+#include "uart.hpp"
 #include "uart_reg.hpp"
 
 namespace hal::stm32f1 {
@@ -30,30 +40,80 @@ static constexpr auto uart_dma_settings1 =
     .insert<dma::channel_priority, 0b10U>()  // Low Medium [High] Very_High
     .to<std::uint32_t>();
 
-void configure_baud_rate(usart_t& p_usart,
-                         peripheral p_peripheral,
-                         serial::settings const& p_settings)
+/// Receive DMA settings with flow control, the half and full buffer
+/// interrupts check the fill level against the high water mark.
+static constexpr auto uart_dma_flow_control_settings =
+  hal::bit_value(uart_dma_settings1)
+    .set<dma::transfer_complete_interrupt_enable>()
+    .set<dma::half_transfer_interrupt_enable>()
+    .to<std::uint32_t>();
+
+/// Receive DMA settings for buffers split into segments, the transfer
+/// complete interrupt moves the channel on to the next segment.
+static constexpr auto uart_dma_segment_settings =
+  hal::bit_value(uart_dma_settings1)
+    .clear<dma::circular_mode>()
+    .set<dma::transfer_complete_interrupt_enable>()
+    .to<std::uint32_t>();
+
+/// Segmented receive DMA settings with flow control
+static constexpr auto uart_dma_segment_flow_control_settings =
+  hal::bit_value(uart_dma_segment_settings)
+    .set<dma::half_transfer_interrupt_enable>()
+    .to<std::uint32_t>();
+
+static constexpr auto uart_dma_transmit_settings =
+  hal::bit_value()
+    .set<dma::transfer_complete_interrupt_enable>()
+    .clear<dma::half_transfer_interrupt_enable>()
+    .clear<dma::transfer_error_interrupt_enable>()
+    .set<dma::data_transfer_direction>()  // Read from memory
+    .clear<dma::circular_mode>()
+    .clear<dma::peripheral_increment_enable>()
+    .set<dma::memory_increment_enable>()
+    .clear<dma::memory_to_memory>()
+    .set<dma::enable>()
+    .insert<dma::peripheral_size, 0b00U>()   // size = 8 bits
+    .insert<dma::memory_size, 0b00U>()       // size = 8 bits
+    .insert<dma::channel_priority, 0b01U>()  // Low [Medium] High Very_High
+    .to<std::uint32_t>();
+
+/// Completion events and results for each usart's transmit DMA channel
+std::array<async_event, 3> uart_write_event{};
+std::array<std::span<hal::byte const>, 3> uart_write_result{};
+
+/// Receive side of RTS/CTS flow control for each usart
+struct flow_control_state
 {
-  auto const clock_frequency = frequency(p_peripheral);
-  float usart_divider = clock_frequency / (16.0f * p_settings.baud_rate);
+  std::size_t const* read_index = nullptr;
+  std::size_t high_water_mark = 0;
+  pin_select_t rts{};
+  bool ready = false;
+};
 
-  // Truncate off the decimal values
-  uint16_t mantissa = static_cast<uint16_t>(usart_divider);
+std::array<flow_control_state, 3> uart_flow_control_state{};
 
-  // Subtract the whole number to leave just the decimal
-  float fraction = static_cast<float>(usart_divider - mantissa);
+std::errc configure_baud_rate(usart_t& p_usart,
+                              peripheral p_peripheral,
+                              serial::settings const& p_settings)
+{
+  if (p_settings.baud_rate < 1.0f) {
+    return std::errc::operation_not_supported;
+  }
 
-  uint16_t fractional_int = static_cast<uint16_t>(std::roundf(fraction * 16));
+  auto const clock_frequency =
+    static_cast<std::uint32_t>(frequency(p_peripheral));
+  auto const baud_rate =
+    static_cast<std::uint64_t>(p_settings.baud_rate + 0.5f);
+  auto const divider = uart_baud_rate_register(clock_frequency, baud_rate);
 
-  if (fractional_int >= 16) {
-    mantissa = static_cast<uint16_t>(mantissa + 1U);
-    fractional_int = 0;
+  if (not divider) {
+    return std::errc::operation_not_supported;
   }
 
-  p_usart.baud_rate = hal::bit_value()
-                        .insert<baud_rate_reg::mantissa>(mantissa)
-                        .insert<baud_rate_reg::fraction>(fractional_int)
-                        .to<std::uint16_t>();
+  p_usart.baud_rate = *divider;
+
+  return {};
 }
 
 void configure_format(usart_t& p_usart, serial::settings const& p_settings)
@@ -72,10 +132,12 @@ void configure_format(usart_t& p_usart, serial::settings const& p_settings)
   // sets the bool to TRUE when odd and zero when something else. This value
   // is ignored if the parity is NONE since parity_enable will be zero.
 
+  // The parity bit takes the place of the 8th data bit unless the word is
+  // lengthened to 9 bits.
   bit_modify(p_usart.control1)
     .insert<parity_control>(parity_enable)
     .insert<parity_selection>(parity)
-    .insert<word_length>(0U);
+    .insert<word_length>(parity_enable);
 
   bit_modify(p_usart.control2).insert<stop>(stop_value);
 }
@@ -84,56 +146,333 @@ inline usart_t* to_usart(void* p_uart)
 {
   return reinterpret_cast<usart_t*>(p_uart);
 }
+
+/**
+ * @brief Stop the usart and its DMA requests, then give back its channels
+ *
+ * The usart is disabled first so it stops raising DMA requests, and
+ * `dma::release_channel()` then disables each channel and its interrupts.
+ */
+void release_usart(usart_t& p_usart,
+                   std::uint8_t p_receive_dma,
+                   std::uint8_t p_transmit_dma)
+{
+  p_usart.control1 = 0;
+  p_usart.control3 = 0;
+  dma::release_channel(p_receive_dma);
+  dma::release_channel(p_transmit_dma);
+}
+
+void complete_write(std::size_t p_port, std::uint8_t p_channel)
+{
+  std::array<usart_t*, 3> const usarts{ usart1, usart2, usart3 };
+
+  // Clear every flag for the channel: global, complete, half and error
+  dma::dma1->interrupt_flag_clear = 0xFUL << ((p_channel - 1U) * 4U);
+  bit_modify(dma::dma1->channel[p_channel - 1].configuration)
+    .clear<dma::enable>();
+  bit_modify(usarts[p_port]->control3)
+    .clear<control_reg::dma_transmitter_enable>();
+
+  uart_write_event[p_port].signal();
+}
+
+template<std::size_t port, std::uint8_t channel>
+void uart_write_complete_handler()
+{
+  complete_write(port, channel);
+}
+
+}  // namespace
+
+std::array<uart_receive_ring_t, 3> uart_receive_ring{};
+std::array<hal::callback<void()>, 3> uart_idle_handler{};
+std::array<hal::callback<void()>, 3> uart_progress_handler{};
+
+std::size_t uart_port_index(peripheral p_id)
+{
+  switch (p_id) {
+    case peripheral::usart2:
+      return 1;
+    case peripheral::usart3:
+      return 2;
+    case peripheral::usart1:
+    default:
+      return 0;
+  }
+}
+
+void uart_update_request_to_send(std::size_t p_port)
+{
+  auto& state = uart_flow_control_state[p_port];
+  auto const& ring = uart_receive_ring[p_port];
+  auto const size = ring.buffer.size();
+  auto const cursor = uart_receive_cursor(ring);
+  auto const waiting = (cursor + size - *state.read_index) % size;
+
+  state.ready =
+    uart_ready_to_receive(waiting, state.high_water_mark, state.ready);
+
+  // RTS is active low, a low level lets the sender continue
+  auto const pin_mask = 1U << state.rts.pin;
+  gpio(state.rts.port).bsrr = state.ready ? pin_mask << 16U : pin_mask;
+}
+
+namespace {
+template<std::size_t port, std::uint8_t channel>
+void uart_receive_handler()
+{
+  constexpr auto shift = (channel - 1U) * 4U;
+  auto const status = dma::dma1->interrupt_status >> shift;
+  // Clear every flag for the channel: global, complete, half and error
+  dma::dma1->interrupt_flag_clear = 0xFUL << shift;
+
+  auto& ring = uart_receive_ring[port];
+  if (ring.segment_size < ring.buffer.size() &&
+      bit_extract<dma::transfer_complete_flag>(status)) {
+    uart_arm_next_segment(ring);
+  }
+  if (uart_flow_control_state[port].read_index != nullptr) {
+    uart_update_request_to_send(port);
+  }
+  if (uart_progress_handler[port]) {
+    uart_progress_handler[port]();
+  }
+}
+
 }  // namespace
 
+void uart_enable_receive_interrupt(peripheral p_id)
+{
+  initialize_interrupts();
+  switch (p_id) {
+    case peripheral::usart2:
+      cortex_m::enable_interrupt(irq::dma1_channel6,
+                                 uart_receive_handler<1, 6>);
+      break;
+    case peripheral::usart3:
+      cortex_m::enable_interrupt(irq::dma1_channel3,
+                                 uart_receive_handler<2, 3>);
+      break;
+    case peripheral::usart1:
+    default:
+      cortex_m::enable_interrupt(irq::dma1_channel5,
+                                 uart_receive_handler<0, 5>);
+      break;
+  }
+}
+
+std::optional<uart_pin_map_t> uart_pin_map(std::uint8_t p_port,
+                                           uart_pins p_pins)
+{
+  switch (p_port) {
+    case 1:
+      if (p_pins == uart_pins::standard) {
+        return uart_pin_map_t{
+          .tx = { .port = 'A', .pin = 9 },
+          .rx = { .port = 'A', .pin = 10 },
+          .cts = { .port = 'A', .pin = 11 },
+          .rts = { .port = 'A', .pin = 12 },
+        };
+      }
+      if (p_pins == uart_pins::remap) {
+        return uart_pin_map_t{
+          .tx = { .port = 'B', .pin = 6 },
+          .rx = { .port = 'B', .pin = 7 },
+          .cts = { .port = 'A', .pin = 11 },
+          .rts = { .port = 'A', .pin = 12 },
+        };
+      }
+      break;
+    case 2:
+      if (p_pins == uart_pins::standard) {
+        return uart_pin_map_t{
+          .tx = { .port = 'A', .pin = 2 },
+          .rx = { .port = 'A', .pin = 3 },
+          .cts = { .port = 'A', .pin = 0 },
+          .rts = { .port = 'A', .pin = 1 },
+        };
+      }
+      if (p_pins == uart_pins::remap) {
+        return uart_pin_map_t{
+          .tx = { .port = 'D', .pin = 5 },
+          .rx = { .port = 'D', .pin = 6 },
+          .cts = { .port = 'D', .pin = 3 },
+          .rts = { .port = 'D', .pin = 4 },
+        };
+      }
+      break;
+    case 3:
+      if (p_pins == uart_pins::standard) {
+        return uart_pin_map_t{
+          .tx = { .port = 'B', .pin = 10 },
+          .rx = { .port = 'B', .pin = 11 },
+          .cts = { .port = 'B', .pin = 13 },
+          .rts = { .port = 'B', .pin = 14 },
+        };
+      }
+      if (p_pins == uart_pins::remap) {
+        return uart_pin_map_t{
+          .tx = { .port = 'C', .pin = 10 },
+          .rx = { .port = 'C', .pin = 11 },
+          .cts = { .port = 'B', .pin = 13 },
+          .rts = { .port = 'B', .pin = 14 },
+        };
+      }
+      if (p_pins == uart_pins::full_remap) {
+        return uart_pin_map_t{
+          .tx = { .port = 'D', .pin = 8 },
+          .rx = { .port = 'D', .pin = 9 },
+          .cts = { .port = 'D', .pin = 11 },
+          .rts = { .port = 'D', .pin = 12 },
+        };
+      }
+      break;
+    default:
+      break;
+  }
+  return std::nullopt;
+}
+
+bool uart_ready_to_receive(std::size_t p_waiting,
+                           std::size_t p_high_water_mark,
+                           bool p_ready)
+{
+  if (p_ready) {
+    return p_waiting < p_high_water_mark;
+  }
+  return p_waiting <= p_high_water_mark / 2;
+}
+
+std::optional<std::uint16_t> uart_baud_rate_register(
+  std::uint32_t p_usart_clock,
+  std::uint64_t p_baud_numerator,
+  std::uint64_t p_baud_denominator)
+{
+  // The smallest USARTDIV is 1.0, which is 16 in 12.4 fixed point
+  constexpr std::uint64_t minimum = 16;
+  constexpr std::uint64_t maximum =
+    hal::bit_limits<baud_rate_reg::mantissa.width +
+                      baud_rate_reg::fraction.width,
+                    std::uint32_t>::max();
+
+  if (p_baud_numerator == 0) {
+    return std::nullopt;
+  }
+
+  auto const cycles = std::uint64_t{ p_usart_clock } * p_baud_denominator;
+  auto const divider = (cycles + p_baud_numerator / 2) / p_baud_numerator;
+
+  if (divider < minimum || divider > maximum) {
+    return std::nullopt;
+  }
+
+  return static_cast<std::uint16_t>(divider);
+}
+
+std::size_t uart_receive_segment_size(std::size_t p_buffer_size)
+{
+  auto const segments = (p_buffer_size + max_dma_length - 1U) / max_dma_length;
+  if (segments <= 1) {
+    return p_buffer_size;
+  }
+  return (p_buffer_size + segments - 1U) / segments;
+}
+
+std::size_t uart_receive_cursor(uart_receive_ring_t const& p_ring)
+{
+  auto const size = p_ring.buffer.size();
+  auto const& channel = dma::dma1->channel[p_ring.dma - 1];
+
+  // The segment and the DMA's remaining count are read separately, the DMA
+  // interrupt may switch segments between the two reads. It runs to
+  // completion before this resumes, so reading the same segment twice means
+  // the count belongs to it.
+  std::size_t segment = 0;
+  std::size_t remaining = 0;
+  do {
+    segment = p_ring.segment;
+    remaining = channel.transfer_amount;
+  } while (segment != p_ring.segment);
+
+  auto const offset = segment * p_ring.segment_size;
+  auto const length = std::min(p_ring.segment_size, size - offset);
+  auto const cursor = offset + length - remaining;
+  // A filled segment whose interrupt is pending ends at the next offset, the
+  // last one at the end of the buffer.
+  return cursor == size ? 0 : cursor;
+}
+
+void uart_arm_next_segment(uart_receive_ring_t& p_ring)
+{
+  auto& channel = dma::dma1->channel[p_ring.dma - 1];
+  auto const size = p_ring.buffer.size();
+  auto const segments = (size + p_ring.segment_size - 1U) / p_ring.segment_size;
+  auto const next = (p_ring.segment + 1U) % segments;
+  auto const offset = next * p_ring.segment_size;
+  auto const length = std::min(p_ring.segment_size, size - offset);
+  auto const address =
+    reinterpret_cast<intptr_t>(p_ring.buffer.subspan(offset).data());
+
+  // The address and count registers can only be written while the channel
+  // is off
+  bit_modify(channel.configuration).clear<dma::enable>();
+  channel.memory_address = static_cast<std::uint32_t>(address);
+  channel.transfer_amount = static_cast<std::uint32_t>(length);
+  p_ring.segment = next;
+  bit_modify(channel.configuration).set<dma::enable>();
+}
+
 uart::uart(hal::runtime,
            std::uint8_t p_port,
            std::span<hal::byte> p_buffer,
-           serial::settings const& p_settings)
-  : uart(p_port, p_buffer, p_settings)
+           serial::settings const& p_settings,
+           uart_options const& p_options)
+  : uart(p_port, p_buffer, p_settings, p_options)
 {
 }
 
 uart::uart(std::uint8_t p_port,
            std::span<hal::byte> p_buffer,
-           serial::settings const& p_settings)
+           serial::settings const& p_settings,
+           uart_options const& p_options)
   : m_uart(nullptr)
   , m_receive_buffer(p_buffer)
   , m_read_index(0)
+  , m_receive_mask(std::has_single_bit(p_buffer.size()) ? p_buffer.size() - 1
+                                                         : 0)
   , m_dma(0)
+  , m_tx_dma(0)
   , m_id{}
+  , m_pins(p_options.pins)
+  , m_flow_control(p_options.flow_control == uart_flow_control::rts_cts)
 {
-  if (p_buffer.size() > max_dma_length) {
+  if (p_buffer.empty()) {
     hal::safe_throw(hal::operation_not_supported(this));
   }
 
-  std::uint8_t port_tx = 'A';
-  std::uint8_t pin_tx = 9;
-  std::uint8_t port_rx = 'A';
-  std::uint8_t pin_rx = 10;
+  auto const pins = uart_pin_map(p_port, p_options.pins);
+  if (not pins) {
+    hal::safe_throw(hal::operation_not_supported(this));
+  }
 
   switch (p_port) {
     case 1:
       m_id = peripheral::usart1;
       m_dma = 5;
+      m_tx_dma = 4;
       m_uart = usart1;
       m_receive_buffer = p_buffer;
       break;
     case 2:
-      port_tx = 'A';
-      pin_tx = 3;
-      port_rx = 'A';
-      pin_rx = 2;
       m_dma = 6;
+      m_tx_dma = 7;
       m_id = peripheral::usart2;
       m_uart = usart2;
       break;
     case 3:
-      port_tx = 'B';
-      pin_tx = 10;
-      port_rx = 'B';
-      pin_rx = 11;
       m_dma = 3;
+      m_tx_dma = 2;
       m_id = peripheral::usart3;
       m_uart = usart3;
       break;
@@ -141,12 +480,30 @@ uart::uart(std::uint8_t p_port,
       hal::safe_throw(hal::operation_not_supported(this));
   }
 
+  if (dma::claim_channel(m_dma) != std::errc{}) {
+    hal::safe_throw(hal::device_or_resource_busy(this));
+  }
+  if (dma::claim_channel(m_tx_dma) != std::errc{}) {
+    dma::release_channel(m_dma);
+    hal::safe_throw(hal::device_or_resource_busy(this));
+  }
+
   // Power on the usart/uart id
   power_on(m_id);
   // Power on dma1 which has the usart channels
   power_on(peripheral::dma1);
 
   auto& uart_reg = *to_usart(m_uart);
+  auto const index = uart_port_index(m_id);
+  auto& ring = uart_receive_ring[index];
+  ring = {
+    .buffer = p_buffer,
+    .segment_size = uart_receive_segment_size(p_buffer.size()),
+    .segment = 0,
+    .dma = m_dma,
+  };
+  // Buffers beyond a single DMA transfer are filled one segment at a time
+  auto const segmented = ring.segment_size < p_buffer.size();
 
   // Setup RX DMA channel
   auto const data_address = reinterpret_cast<intptr_t>(&uart_reg.data);
@@ -154,10 +511,18 @@ uart::uart(std::uint8_t p_port,
   auto const data_address_int = static_cast<std::uint32_t>(data_address);
   auto const queue_address_int = static_cast<std::uint32_t>(queue_address);
 
-  dma::dma1->channel[m_dma - 1].transfer_amount = p_buffer.size();
+  auto receive_settings = uart_dma_settings1;
+  if (segmented) {
+    receive_settings = m_flow_control ? uart_dma_segment_flow_control_settings
+                                      : uart_dma_segment_settings;
+  } else if (m_flow_control) {
+    receive_settings = uart_dma_flow_control_settings;
+  }
+
+  dma::dma1->channel[m_dma - 1].transfer_amount = ring.segment_size;
   dma::dma1->channel[m_dma - 1].peripheral_address = data_address_int;
   dma::dma1->channel[m_dma - 1].memory_address = queue_address_int;
-  dma::dma1->channel[m_dma - 1].configuration = uart_dma_settings1;
+  dma::dma1->channel[m_dma - 1].configuration = receive_settings;
 
   // Setup UART Control Settings 1
   uart_reg.control1 = control_reg::control_settings1;
@@ -169,25 +534,83 @@ uart::uart(std::uint8_t p_port,
   // Setup UART Control Settings 3
   uart_reg.control3 = control_reg::control_settings3;
 
-  uart::driver_configure(p_settings);
+  if (try_configure(p_settings) != std::errc{}) {
+    release_usart(uart_reg, m_dma, m_tx_dma);
+    ring = {};
+    hal::safe_throw(hal::operation_not_supported(this));
+  }
 
-  configure_pin({ .port = port_tx, .pin = pin_tx },
-                push_pull_alternative_output);
-  configure_pin({ .port = port_rx, .pin = pin_rx }, input_pull_up);
+  remap_pins(p_port, p_options.pins);
+  configure_pin(pins->tx, push_pull_alternative_output);
+  configure_pin(pins->rx, input_pull_up);
+
+  if (m_flow_control) {
+    // The hardware RTS output only reflects the data register, which the DMA
+    // empties right away, thus RTS is driven from the buffer fill level
+    // instead.
+    auto& state = uart_flow_control_state[index];
+    // Half a buffer may arrive between two checks, see
+    // uart_options::high_water_mark
+    auto const maximum_mark = (p_buffer.size() * 3) / 8;
+    std::size_t high_water_mark = p_options.high_water_mark;
+    if (high_water_mark == 0) {
+      high_water_mark = maximum_mark;
+    }
+
+    state = {
+      .read_index = &m_read_index,
+      .high_water_mark = std::min(high_water_mark, maximum_mark),
+      .rts = pins->rts,
+      .ready = false,
+    };
+
+    configure_pin(pins->cts, input_pull_up);
+    configure_pin(pins->rts, push_pull_gpio_output);
+    uart_update_request_to_send(index);
+
+    bit_modify(uart_reg.control3).set<control_reg::cts_enable>();
+  }
+
+  if (m_flow_control || segmented) {
+    uart_enable_receive_interrupt(m_id);
+  }
 }
 
-std::uint32_t uart::dma_cursor_position()
+uart::~uart()
 {
-  std::uint32_t receive_amount = dma::dma1->channel[m_dma - 1].transfer_amount;
-  std::uint32_t write_position = m_receive_buffer.size() - receive_amount;
-  return write_position % m_receive_buffer.size();
+  auto const index = uart_port_index(m_id);
+  release_usart(*to_usart(m_uart), m_dma, m_tx_dma);
+
+  uart_idle_handler[index] = {};
+  uart_progress_handler[index] = {};
+  uart_flow_control_state[index] = {};
+  uart_receive_ring[index] = {};
 }
 
-void uart::driver_configure(serial::settings const& p_settings)
+std::size_t uart::dma_cursor_position()
+{
+  return uart_receive_cursor(uart_receive_ring[uart_port_index(m_id)]);
+}
+
+std::errc uart::try_configure(serial::settings const& p_settings)
 {
   auto& uart_reg = *to_usart(m_uart);
-  configure_baud_rate(uart_reg, m_id, p_settings);
+
+  auto const status = configure_baud_rate(uart_reg, m_id, p_settings);
+  if (status != std::errc{}) {
+    return status;
+  }
+
   configure_format(uart_reg, p_settings);
+
+  return {};
+}
+
+void uart::driver_configure(serial::settings const& p_settings)
+{
+  if (try_configure(p_settings) != std::errc{}) {
+    hal::safe_throw(hal::operation_not_supported(this));
+  }
 }
 
 serial::write_t uart::driver_write(std::span<hal::byte const> p_data)
@@ -207,17 +630,84 @@ serial::write_t uart::driver_write(std::span<hal::byte const> p_data)
   };
 }
 
-serial::read_t uart::driver_read(std::span<hal::byte> p_data)
+async_result<std::span<hal::byte const>> uart::write_async(
+  std::span<hal::byte const> p_data)
 {
-  size_t count = 0;
+  auto const index = uart_port_index(m_id);
+  auto& event = uart_write_event[index];
+  auto& result = uart_write_result[index];
+  auto& uart_reg = *to_usart(m_uart);
+  auto& channel = dma::dma1->channel[m_tx_dma - 1];
 
-  for (auto& byte : p_data) {
-    if (m_read_index == dma_cursor_position()) {
+  event.reset();
+  result = p_data.first(std::min<std::size_t>(p_data.size(), max_dma_length));
+
+  if (result.empty()) {
+    event.signal();
+    return { event, result };
+  }
+
+  initialize_interrupts();
+  switch (m_id) {
+    case peripheral::usart2:
+      cortex_m::enable_interrupt(irq::dma1_channel7,
+                                 uart_write_complete_handler<1, 7>);
+      break;
+    case peripheral::usart3:
+      cortex_m::enable_interrupt(irq::dma1_channel2,
+                                 uart_write_complete_handler<2, 2>);
+      break;
+    case peripheral::usart1:
+    default:
+      cortex_m::enable_interrupt(irq::dma1_channel4,
+                                 uart_write_complete_handler<0, 4>);
       break;
-    }
-    byte = m_receive_buffer[m_read_index++];
-    m_read_index = m_read_index % m_receive_buffer.size();
-    count++;
+  }
+
+  auto const data_address = reinterpret_cast<intptr_t>(&uart_reg.data);
+  auto const memory_address = reinterpret_cast<intptr_t>(result.data());
+
+  channel.configuration = 0;
+  channel.transfer_amount = static_cast<std::uint32_t>(result.size());
+  channel.peripheral_address = static_cast<std::uint32_t>(data_address);
+  channel.memory_address = static_cast<std::uint32_t>(memory_address);
+  channel.configuration = uart_dma_transmit_settings;
+
+  // TXE requests from the usart now drive the DMA channel
+  bit_modify(uart_reg.control3).set<control_reg::dma_transmitter_enable>();
+
+  return { event, result };
+}
+
+std::size_t uart::wrap(std::size_t p_index) const
+{
+  // Indexes are at most one lap ahead, so a subtraction replaces the modulo
+  // when the mask cannot.
+  if (m_receive_mask != 0) {
+    return p_index & m_receive_mask;
+  }
+  auto const size = m_receive_buffer.size();
+  return p_index >= size ? p_index - size : p_index;
+}
+
+serial::read_t uart::driver_read(std::span<hal::byte> p_data)
+{
+  // The DMA position is sampled once, bytes arriving during the copy are
+  // left for the next call.
+  auto const size = m_receive_buffer.size();
+  auto const waiting = wrap(dma_cursor_position() + size - m_read_index);
+  auto const count = std::min(p_data.size(), waiting);
+
+  // Copy up to the end of the buffer, then the rest from its start
+  auto const first = std::min(count, size - m_read_index);
+  auto const source = m_receive_buffer.begin();
+  std::copy_n(source + m_read_index, first, p_data.begin());
+  std::copy_n(source, count - first, p_data.begin() + first);
+  m_read_index = wrap(m_read_index + count);
+
+  if (m_flow_control && count != 0) {
+    critical_section guard;
+    uart_update_request_to_send(uart_port_index(m_id));
   }
 
   return {
@@ -230,5 +720,10 @@ serial::read_t uart::driver_read(std::span<hal::byte> p_data)
 void uart::driver_flush()
 {
   m_read_index = dma_cursor_position();
+
+  if (m_flow_control) {
+    critical_section guard;
+    uart_update_request_to_send(uart_port_index(m_id));
+  }
 }
 }  // namespace hal::stm32f1
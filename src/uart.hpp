@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/pin.hpp>
+#include <libhal/functional.hpp>
+#include <libhal/units.hpp>
+
+#include "pin.hpp"
+
+namespace hal::stm32f1 {
+/// Pins used by a usart port
+struct uart_pin_map_t
+{
+  pin_select_t tx;
+  pin_select_t rx;
+  pin_select_t cts;
+  pin_select_t rts;
+};
+
+/**
+ * @brief Look up the pins of a usart port
+ *
+ * @param p_port - usart port number
+ * @param p_pins - remap option of the port
+ * @return std::optional<uart_pin_map_t> - pins of the port or std::nullopt if
+ * the port does not exist or does not support the remap option.
+ */
+std::optional<uart_pin_map_t> uart_pin_map(std::uint8_t p_port,
+                                           uart_pins p_pins);
+
+/**
+ * @brief Decide the state of RTS from the fill level of the receive buffer
+ *
+ * RTS is deasserted at the high water mark and asserted again once the fill
+ * level has fallen to half of the mark, so that it does not toggle with every
+ * byte read around the mark.
+ *
+ * @param p_waiting - unread bytes in the receive buffer
+ * @param p_high_water_mark - unread bytes at which RTS is deasserted
+ * @param p_ready - true if RTS is currently asserted
+ * @return true - RTS should be asserted, the sender may continue
+ * @return false - RTS should be deasserted
+ */
+bool uart_ready_to_receive(std::size_t p_waiting,
+                           std::size_t p_high_water_mark,
+                           bool p_ready);
+
+/// Timer input capture channel wired to a usart RX pin
+struct uart_capture_channel_t
+{
+  /// timer1 to timer4
+  peripheral timer;
+  /// Capture channel, 1 to 4
+  std::uint8_t channel;
+  /// The timer2 remap needed to route the pin to the channel, 0 if none
+  std::uint8_t timer2_remap;
+};
+
+/**
+ * @brief Look up the timer channel that can capture the edges of an RX pin
+ *
+ * @param p_rx - RX pin of a usart port
+ * @return std::optional<uart_capture_channel_t> - timer channel of the pin or
+ * std::nullopt if no timer channel shares the pin.
+ */
+std::optional<uart_capture_channel_t> uart_rx_capture_channel(
+  pin_select_t p_rx);
+
+/**
+ * @brief Compute the baud rate register value with integer math
+ *
+ * BRR holds USARTDIV in 12.4 fixed point, so its raw value is the number of
+ * usart clock cycles per bit. With the baud rate given as a fraction, that is
+ * the usart clock times the denominator divided by the numerator, rounded to
+ * the nearest cycle.
+ *
+ * @param p_usart_clock - usart peripheral clock in Hz
+ * @param p_baud_numerator - numerator of the baud rate
+ * @param p_baud_denominator - denominator of the baud rate
+ * @return std::optional<std::uint16_t> - BRR value or std::nullopt if the
+ * divider is below 1 or does not fit into the register.
+ */
+std::optional<std::uint16_t> uart_baud_rate_register(
+  std::uint32_t p_usart_clock,
+  std::uint64_t p_baud_numerator,
+  std::uint64_t p_baud_denominator = 1);
+
+/// Receive buffer of a usart as the DMA fills it. Buffers larger than one DMA
+/// transfer are split into segments which the DMA fills one after another.
+struct uart_receive_ring_t
+{
+  /// The whole receive buffer
+  std::span<hal::byte> buffer{};
+  /// Length of each segment, the last one may be shorter
+  std::size_t segment_size = 0;
+  /// Segment the DMA is filling, advanced from the DMA interrupt
+  std::size_t volatile segment = 0;
+  /// DMA1 receive channel, 1 to 7
+  std::uint8_t dma = 0;
+};
+
+/// Receive buffer of each usart
+extern std::array<uart_receive_ring_t, 3> uart_receive_ring;
+
+/// Handlers registered with uart::on_receive_idle()
+extern std::array<hal::callback<void()>, 3> uart_idle_handler;
+
+/// Handlers registered with uart::on_receive_progress()
+extern std::array<hal::callback<void()>, 3> uart_progress_handler;
+
+/**
+ * @brief Index of a usart into the per port state
+ *
+ * @param p_id - usart1 to usart3
+ * @return std::size_t - 0 to 2
+ */
+std::size_t uart_port_index(peripheral p_id);
+
+/**
+ * @brief Drive RTS from the fill level of the receive buffer
+ *
+ * Only for ports with flow control. Must not be interrupted by the DMA
+ * receive interrupt of the port.
+ *
+ * @param p_port - index of the port, see `uart_port_index()`
+ */
+void uart_update_request_to_send(std::size_t p_port);
+
+/**
+ * @brief Install and enable the DMA receive interrupt of a usart
+ *
+ * The interrupt moves segmented buffers on, updates RTS and calls the
+ * progress handler.
+ *
+ * @param p_id - usart1 to usart3
+ */
+void uart_enable_receive_interrupt(peripheral p_id);
+
+/**
+ * @brief Size of the segments a receive buffer is split into
+ *
+ * The buffer is split into as few segments as fit into a DMA transfer, of
+ * about equal length.
+ *
+ * @param p_buffer_size - size of the receive buffer
+ * @return std::size_t - length of each segment but the last
+ */
+std::size_t uart_receive_segment_size(std::size_t p_buffer_size);
+
+/**
+ * @brief Position of the DMA in the receive buffer
+ *
+ * Safe to call while the DMA interrupt may advance the segment.
+ *
+ * @param p_ring - receive buffer
+ * @return std::size_t - index of the next byte the DMA writes
+ */
+std::size_t uart_receive_cursor(uart_receive_ring_t const& p_ring);
+
+/**
+ * @brief Point the DMA channel at the next segment of the buffer
+ *
+ * Called once the DMA has filled the current segment. The usart holds the
+ * next byte in its data register meanwhile, so the segment has to be
+ * switched within a character time.
+ *
+ * @param p_ring - receive buffer
+ */
+void uart_arm_next_segment(uart_receive_ring_t& p_ring);
+}  // namespace hal::stm32f1
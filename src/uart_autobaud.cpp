@@ -0,0 +1,306 @@
+#include <cstdint>
+#include <optional>
+#include <system_error>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/uart.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal/steady_clock.hpp>
+
+#include "pin.hpp"
+#include "power.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+#include "uart.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+inline usart_t* to_usart(void* p_uart)
+{
+  return reinterpret_cast<usart_t*>(p_uart);
+}
+
+/// Input capture on one timer channel with the 16-bit counter extended by
+/// counting its overflows
+struct edge_capture
+{
+  general_purpose_timer_t* reg = nullptr;
+  std::uint8_t channel = 1;
+  std::uint64_t overflows = 0;
+};
+
+general_purpose_timer_t* capture_timer(peripheral p_timer)
+{
+  if (p_timer == peripheral::timer1) {
+    return timer1_reg;
+  }
+  return general_purpose_timer(p_timer);
+}
+
+void start_edge_capture(edge_capture& p_capture, peripheral p_timer)
+{
+  auto& reg = *p_capture.reg;
+  auto const index = p_capture.channel - 1U;
+
+  power_on(p_timer);
+
+  reg.CR1 = 0;
+  reg.SMCR = 0;
+  reg.DIER = 0;
+  reg.CCER = 0;
+  reg.PSC = 0;
+  reg.ARR = 0xFFFF;
+
+  // Channels 1 and 2 are in CCMR1, channels 3 and 4 in CCMR2
+  auto& mode = (index < 2) ? reg.CCMR1 : reg.CCMR2;
+  auto const mode_shift = (index % 2U) * 8U;
+  auto const selection = timer_capture_mode::selection;
+  auto const filter = timer_capture_mode::filter;
+  bit_modify(mode)
+    .insert(bit_mask::from(selection.position + mode_shift,
+                           selection.position + mode_shift + 1U),
+            0b01U)
+    .insert(bit_mask::from(filter.position + mode_shift,
+                           filter.position + mode_shift + 3U),
+            0b0011U);
+
+  auto const enable_shift = index * 4U;
+  bit_modify(reg.CCER)
+    .set(bit_mask::from(timer_capture_enable::enable.position + enable_shift))
+    .set(bit_mask::from(timer_capture_enable::falling_edge.position +
+                        enable_shift));
+
+  bit_modify(reg.EGR).set<timer_event_generation::update>();
+  reg.SR = 0;
+  bit_modify(reg.CR1).set<timer_control::counter_enable>();
+}
+
+void capture_falling_edges(edge_capture& p_capture, bool p_falling)
+{
+  auto const shift = (p_capture.channel - 1U) * 4U;
+  bit_modify(p_capture.reg->CCER)
+    .insert(
+      bit_mask::from(timer_capture_enable::falling_edge.position + shift),
+      p_falling);
+}
+
+/**
+ * @brief Wait for the next captured edge
+ *
+ * @return std::optional<std::uint64_t> - time of the edge in timer ticks or
+ * std::nullopt on timeout or if an edge was overwritten before it was read.
+ */
+std::optional<std::uint64_t> next_edge(edge_capture& p_capture,
+                                       hal::steady_clock& p_clock,
+                                       std::uint64_t p_deadline)
+{
+  auto& reg = *p_capture.reg;
+  auto const update = timer_status::update.value<std::uint32_t>();
+  auto const captured = 1UL << p_capture.channel;
+  auto const overcaptured = captured << 8U;
+
+  while (p_clock.uptime() < p_deadline) {
+    auto const status = reg.SR;
+    if (status & overcaptured) {
+      return std::nullopt;
+    }
+    if (status & captured) {
+      // Reading the capture register clears its flag
+      auto const ticks = reg.CCR[p_capture.channel - 1U] & 0xFFFFU;
+      // An overflow in the same poll belongs before the capture if the
+      // capture is from the start of the new count.
+      if ((status & update) && ticks < 0x8000U) {
+        p_capture.overflows++;
+        reg.SR = ~update;
+      }
+      return (p_capture.overflows << 16U) | ticks;
+    }
+    if (status & update) {
+      p_capture.overflows++;
+      reg.SR = ~update;
+    }
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * @brief Read the count of the capture timer
+ *
+ * @return std::uint64_t - current time in timer ticks, on the same scale as
+ * the edges returned by `next_edge()`
+ */
+std::uint64_t current_tick(edge_capture& p_capture)
+{
+  auto& reg = *p_capture.reg;
+  auto const update = timer_status::update.value<std::uint32_t>();
+  auto const ticks = reg.CNT & 0xFFFFU;
+  // An overflow flagged after the read belongs to the next call unless the
+  // count is already from the start of the new period.
+  if ((reg.SR & update) && ticks < 0x8000U) {
+    p_capture.overflows++;
+    reg.SR = ~update;
+  }
+  return (p_capture.overflows << 16U) | ticks;
+}
+}  // namespace
+
+std::optional<uart_capture_channel_t> uart_rx_capture_channel(
+  pin_select_t p_rx)
+{
+  if (p_rx.port == 'A' && p_rx.pin == 10) {
+    return uart_capture_channel_t{
+      .timer = peripheral::timer1,
+      .channel = 3,
+      .timer2_remap = 0,
+    };
+  }
+  if (p_rx.port == 'B' && p_rx.pin == 7) {
+    return uart_capture_channel_t{
+      .timer = peripheral::timer4,
+      .channel = 2,
+      .timer2_remap = 0,
+    };
+  }
+  if (p_rx.port == 'A' && p_rx.pin == 3) {
+    return uart_capture_channel_t{
+      .timer = peripheral::timer2,
+      .channel = 4,
+      .timer2_remap = 0,
+    };
+  }
+  if (p_rx.port == 'B' && p_rx.pin == 11) {
+    // Partial remap 2 moves channels 3 and 4 to PB10 and PB11
+    return uart_capture_channel_t{
+      .timer = peripheral::timer2,
+      .channel = 4,
+      .timer2_remap = 0b10,
+    };
+  }
+  return std::nullopt;
+}
+
+std::optional<hal::hertz> uart::autobaud(hal::steady_clock& p_clock,
+                                         uart_autobaud_pattern p_pattern,
+                                         hal::time_duration p_timeout)
+{
+  auto const port = static_cast<std::uint8_t>(uart_port_index(m_id) + 1U);
+  auto const pins = uart_pin_map(port, m_pins);
+  if (not pins) {
+    return std::nullopt;
+  }
+  auto const capture_channel = uart_rx_capture_channel(pins->rx);
+  if (not capture_channel) {
+    return std::nullopt;
+  }
+
+  // The capture timer is reset, so it must not be in use by another driver
+  auto const timer = capture_channel->timer;
+  if (claim_timer(timer) != std::errc{}) {
+    return std::nullopt;
+  }
+
+  auto& uart_reg = *to_usart(m_uart);
+  edge_capture capture{
+    .reg = capture_timer(timer),
+    .channel = capture_channel->channel,
+  };
+
+  auto const clock_frequency = static_cast<std::uint64_t>(p_clock.frequency());
+  auto const timeout_ticks =
+    (clock_frequency * static_cast<std::uint64_t>(p_timeout.count())) /
+    1'000'000'000ULL;
+  auto const deadline = p_clock.uptime() + timeout_ticks;
+
+  constexpr auto timer2_remap = bit_mask::from<8, 9>();
+  std::uint32_t previous_remap = 0;
+  if (capture_channel->timer2_remap != 0) {
+    power_on(peripheral::afio);
+    previous_remap =
+      bit_extract<timer2_remap>(alternative_function_io->mapr);
+    bit_modify(alternative_function_io->mapr)
+      .insert<timer2_remap>(std::uint32_t{ capture_channel->timer2_remap });
+  }
+
+  // Keep the receiver from decoding the pattern at the old rate
+  bit_modify(uart_reg.control1).clear<control_reg::receive_enable>();
+  start_edge_capture(capture, timer);
+
+  // The first edge is always the falling edge of a start bit
+  std::optional<std::uint64_t> last{};
+  std::uint64_t bits = 0;
+  auto const first = next_edge(capture, p_clock, deadline);
+  if (first && p_pattern == uart_autobaud_pattern::start_bit) {
+    // The start bit ends with the rising edge to the first data bit
+    capture_falling_edges(capture, false);
+    last = next_edge(capture, p_clock, deadline);
+    bits = 1;
+  } else if (first) {
+    // 0x55 has falling edges at bits 0, 2, 4, 6 and 8
+    for (int edge = 0; edge < 4; edge++) {
+      last = next_edge(capture, p_clock, deadline);
+      if (not last) {
+        break;
+      }
+    }
+    bits = 8;
+  }
+
+  auto const stop_capture = [&]() {
+    capture.reg->CR1 = 0;
+    capture.reg->CCER = 0;
+    if (capture_channel->timer2_remap != 0) {
+      bit_modify(alternative_function_io->mapr)
+        .insert<timer2_remap>(previous_remap);
+    }
+    release_timer(timer);
+  };
+
+  std::optional<std::uint16_t> divider{};
+  std::uint64_t ticks = 0;
+  auto const timer_frequency =
+    static_cast<std::uint64_t>(frequency(timer));
+  if (first && last) {
+    ticks = *last - *first;
+    // baud rate = timer frequency * bits / ticks
+    divider =
+      uart_baud_rate_register(static_cast<std::uint32_t>(frequency(m_id)),
+                              timer_frequency * bits,
+                              ticks);
+  }
+
+  if (not divider) {
+    stop_capture();
+    bit_modify(uart_reg.control1).set<control_reg::receive_enable>();
+    return std::nullopt;
+  }
+
+  // Turn the receiver back on during the stop bit of the pattern's byte, so
+  // that it starts on the next start bit rather than within a byte. After a
+  // sync byte the stop bit follows the last falling edge. After a start bit
+  // it is timed from the start bit, half a bit into the stop bit, as the
+  // data bits may be high too.
+  if (p_pattern == uart_autobaud_pattern::sync_byte) {
+    auto const& rx_gpio = gpio(pins->rx.port);
+    auto const rx_mask = 1UL << pins->rx.pin;
+    while ((rx_gpio.idr & rx_mask) == 0 && p_clock.uptime() < deadline) {
+      continue;
+    }
+  } else {
+    auto const stop_bit = *first + ((ticks * 19U) / 2U);
+    while (current_tick(capture) < stop_bit && p_clock.uptime() < deadline) {
+      continue;
+    }
+  }
+  stop_capture();
+
+  uart_reg.baud_rate = *divider;
+  bit_modify(uart_reg.control1).set<control_reg::receive_enable>();
+  driver_flush();
+
+  return static_cast<hal::hertz>(timer_frequency * bits) /
+         static_cast<hal::hertz>(ticks);
+}
+}  // namespace hal::stm32f1
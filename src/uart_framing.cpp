@@ -0,0 +1,374 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal-stm32f1/uart_framing.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::array<std::uint16_t, 256> crc16_ccitt_table = []() {
+  std::array<std::uint16_t, 256> table{};
+  for (std::size_t i = 0; i < table.size(); i++) {
+    auto crc = static_cast<std::uint16_t>(i << 8U);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000U) ? static_cast<std::uint16_t>((crc << 1U) ^ 0x1021U)
+                            : static_cast<std::uint16_t>(crc << 1U);
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+constexpr hal::byte cobs_delimiter = 0x00;
+/// Code byte of a block with the maximum of 254 data bytes and no zero after
+/// it
+constexpr hal::byte cobs_full_block = 0xFF;
+
+constexpr hal::byte slip_end = 0xC0;
+constexpr hal::byte slip_escape = 0xDB;
+constexpr hal::byte slip_escaped_end = 0xDC;
+constexpr hal::byte slip_escaped_escape = 0xDD;
+
+/// Copy as much of p_data into p_destination at p_length as fits
+/// @return true if all of p_data fit
+bool append_to(std::span<hal::byte> p_destination,
+               std::size_t& p_length,
+               std::uint16_t& p_crc,
+               std::span<hal::byte const> p_data)
+{
+  auto const count = std::min(p_destination.size() - p_length, p_data.size());
+  std::copy_n(p_data.begin(), count, p_destination.begin() + p_length);
+  p_crc = crc16_ccitt(p_data.first(count), p_crc);
+  p_length += count;
+  return count == p_data.size();
+}
+
+std::array<hal::byte, 2> crc_bytes(std::span<hal::byte const> p_payload)
+{
+  auto const crc = crc16_ccitt(p_payload);
+  return { static_cast<hal::byte>(crc >> 8U), static_cast<hal::byte>(crc) };
+}
+
+/// Incremental COBS encoder writing blocks straight into the output
+class cobs_writer
+{
+public:
+  explicit cobs_writer(std::span<hal::byte> p_output)
+    : m_output(p_output)
+  {
+  }
+
+  void write(std::span<hal::byte const> p_data)
+  {
+    while (not p_data.empty() && not m_overflow) {
+      if (p_data.front() == cobs_delimiter) {
+        close_block();
+        p_data = p_data.subspan(1);
+        continue;
+      }
+
+      // Copy a run of non-zero bytes, up to the end of the block
+      auto const limit = std::min<std::size_t>(
+        p_data.size(), static_cast<std::size_t>(cobs_full_block - m_code));
+      auto const run = p_data.first(limit);
+      auto const count = static_cast<std::size_t>(
+        std::find(run.begin(), run.end(), cobs_delimiter) - run.begin());
+      if (m_position + count > m_output.size()) {
+        m_overflow = true;
+        return;
+      }
+      std::copy_n(run.begin(), count, m_output.begin() + m_position);
+      m_position += count;
+      m_code = static_cast<hal::byte>(m_code + count);
+      p_data = p_data.subspan(count);
+
+      if (m_code == cobs_full_block) {
+        close_block();
+      }
+    }
+  }
+
+  std::span<hal::byte const> finish()
+  {
+    if (m_overflow || m_code_index >= m_output.size() ||
+        m_position >= m_output.size()) {
+      return {};
+    }
+    m_output[m_code_index] = m_code;
+    m_output[m_position++] = cobs_delimiter;
+    return m_output.first(m_position);
+  }
+
+private:
+  void close_block()
+  {
+    if (m_position >= m_output.size()) {
+      m_overflow = true;
+      return;
+    }
+    m_output[m_code_index] = m_code;
+    m_code_index = m_position++;
+    m_code = 1;
+  }
+
+  std::span<hal::byte> m_output;
+  std::size_t m_code_index = 0;
+  std::size_t m_position = 1;
+  hal::byte m_code = 1;
+  bool m_overflow = false;
+};
+
+/// Escape p_data into p_output at p_position
+/// @return true if all of p_data fit
+bool slip_write(std::span<hal::byte> p_output,
+                std::size_t& p_position,
+                std::span<hal::byte const> p_data)
+{
+  auto const is_special = [](hal::byte p_byte) {
+    return p_byte == slip_end || p_byte == slip_escape;
+  };
+
+  while (not p_data.empty()) {
+    auto const count = static_cast<std::size_t>(
+      std::find_if(p_data.begin(), p_data.end(), is_special) - p_data.begin());
+    if (p_position + count > p_output.size()) {
+      return false;
+    }
+    std::copy_n(p_data.begin(), count, p_output.begin() + p_position);
+    p_position += count;
+    p_data = p_data.subspan(count);
+
+    if (not p_data.empty()) {
+      if (p_position + 2 > p_output.size()) {
+        return false;
+      }
+      p_output[p_position++] = slip_escape;
+      p_output[p_position++] =
+        p_data.front() == slip_end ? slip_escaped_end : slip_escaped_escape;
+      p_data = p_data.subspan(1);
+    }
+  }
+  return true;
+}
+}  // namespace
+
+std::uint16_t crc16_ccitt(std::span<hal::byte const> p_data,
+                          std::uint16_t p_crc)
+{
+  for (auto const byte : p_data) {
+    auto const index = static_cast<std::uint8_t>((p_crc >> 8U) ^ byte);
+    p_crc =
+      static_cast<std::uint16_t>((p_crc << 8U) ^ crc16_ccitt_table[index]);
+  }
+  return p_crc;
+}
+
+cobs_decoder::cobs_decoder(std::span<hal::byte> p_destination)
+  : m_destination(p_destination)
+{
+}
+
+void cobs_decoder::append(std::span<hal::byte const> p_data)
+{
+  if (not append_to(m_destination, m_length, m_crc, p_data)) {
+    m_error = true;
+  }
+}
+
+std::size_t cobs_decoder::decode(std::span<hal::byte const> p_input)
+{
+  if (m_complete) {
+    return 0;
+  }
+
+  std::size_t index = 0;
+  while (index < p_input.size()) {
+    auto const byte = p_input[index];
+
+    if (byte == cobs_delimiter) {
+      index++;
+      // A delimiter within a block means bytes were lost
+      if (m_block_remaining != 0) {
+        m_error = true;
+      }
+      if (m_length == 0 && not m_error) {
+        // Empty frame, such as back to back delimiters
+        m_zero_pending = false;
+        continue;
+      }
+      m_complete = true;
+      return index;
+    }
+
+    if (m_block_remaining == 0) {
+      // Code byte, each block but the last was followed by a zero
+      if (m_zero_pending) {
+        static constexpr std::array<hal::byte, 1> zero{ 0x00 };
+        append(zero);
+      }
+      m_block_remaining = static_cast<std::uint8_t>(byte - 1U);
+      m_zero_pending = (byte != cobs_full_block);
+      index++;
+      continue;
+    }
+
+    auto const run = p_input.subspan(
+      index, std::min<std::size_t>(m_block_remaining, p_input.size() - index));
+    auto const count = static_cast<std::size_t>(
+      std::find(run.begin(), run.end(), cobs_delimiter) - run.begin());
+    append(run.first(count));
+    m_block_remaining = static_cast<std::uint8_t>(m_block_remaining - count);
+    index += count;
+  }
+
+  return index;
+}
+
+std::optional<received_frame> cobs_decoder::take_frame()
+{
+  if (not m_complete) {
+    return std::nullopt;
+  }
+
+  received_frame const frame{
+    .data = m_destination.first(m_length),
+    .crc_valid = not m_error && m_length >= 2 && m_crc == 0,
+    .error = m_error,
+  };
+
+  m_length = 0;
+  m_crc = 0xFFFF;
+  m_block_remaining = 0;
+  m_zero_pending = false;
+  m_error = false;
+  m_complete = false;
+
+  return frame;
+}
+
+slip_decoder::slip_decoder(std::span<hal::byte> p_destination)
+  : m_destination(p_destination)
+{
+}
+
+void slip_decoder::append(std::span<hal::byte const> p_data)
+{
+  if (not append_to(m_destination, m_length, m_crc, p_data)) {
+    m_error = true;
+  }
+}
+
+std::size_t slip_decoder::decode(std::span<hal::byte const> p_input)
+{
+  if (m_complete) {
+    return 0;
+  }
+
+  auto const is_special = [](hal::byte p_byte) {
+    return p_byte == slip_end || p_byte == slip_escape;
+  };
+
+  std::size_t index = 0;
+  while (index < p_input.size()) {
+    auto const byte = p_input[index];
+
+    if (m_escape) {
+      m_escape = false;
+      index++;
+      if (byte == slip_escaped_end) {
+        static constexpr std::array<hal::byte, 1> end{ slip_end };
+        append(end);
+      } else if (byte == slip_escaped_escape) {
+        static constexpr std::array<hal::byte, 1> escape{ slip_escape };
+        append(escape);
+      } else {
+        m_error = true;
+      }
+      continue;
+    }
+
+    if (byte == slip_end) {
+      index++;
+      if (m_length == 0 && not m_error) {
+        // Empty frame, such as the END that opens each frame
+        continue;
+      }
+      m_complete = true;
+      return index;
+    }
+
+    if (byte == slip_escape) {
+      m_escape = true;
+      index++;
+      continue;
+    }
+
+    auto const rest = p_input.subspan(index);
+    auto const count = static_cast<std::size_t>(
+      std::find_if(rest.begin(), rest.end(), is_special) - rest.begin());
+    append(rest.first(count));
+    index += count;
+  }
+
+  return index;
+}
+
+std::optional<received_frame> slip_decoder::take_frame()
+{
+  if (not m_complete) {
+    return std::nullopt;
+  }
+
+  received_frame const frame{
+    .data = m_destination.first(m_length),
+    .crc_valid = not m_error && m_length >= 2 && m_crc == 0,
+    .error = m_error,
+  };
+
+  m_length = 0;
+  m_crc = 0xFFFF;
+  m_escape = false;
+  m_error = false;
+  m_complete = false;
+
+  return frame;
+}
+
+std::span<hal::byte const> cobs_encode(std::span<hal::byte const> p_payload,
+                                       std::span<hal::byte> p_destination)
+{
+  if (p_destination.empty()) {
+    return {};
+  }
+
+  auto const crc = crc_bytes(p_payload);
+  cobs_writer writer(p_destination);
+  writer.write(p_payload);
+  writer.write(crc);
+  return writer.finish();
+}
+
+std::span<hal::byte const> slip_encode(std::span<hal::byte const> p_payload,
+                                       std::span<hal::byte> p_destination)
+{
+  if (p_destination.empty()) {
+    return {};
+  }
+
+  auto const crc = crc_bytes(p_payload);
+  std::size_t position = 0;
+  p_destination[position++] = slip_end;
+
+  if (not slip_write(p_destination, position, p_payload) ||
+      not slip_write(p_destination, position, crc) ||
+      position >= p_destination.size()) {
+    return {};
+  }
+
+  p_destination[position++] = slip_end;
+  return p_destination.first(position);
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-stm32f1/uart.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "critical_section.hpp"
+#include "dma.hpp"
+#include "uart.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+inline usart_t* to_usart(void* p_uart)
+{
+  return reinterpret_cast<usart_t*>(p_uart);
+}
+
+template<std::size_t port>
+void uart_idle_interrupt()
+{
+  std::array<usart_t*, 3> const usarts{ usart1, usart2, usart3 };
+  auto& reg = *usarts[port];
+
+  if (bit_extract<status_reg::idle>(reg.status)) {
+    // Reading the data register after the status register clears the flag.
+    // The DMA has taken the last byte already, so no data is lost.
+    (void)reg.data;
+    if (uart_idle_handler[port]) {
+      uart_idle_handler[port]();
+    }
+  }
+}
+}  // namespace
+
+void uart::on_receive_idle(hal::callback<void()> p_handler)
+{
+  auto const index = uart_port_index(m_id);
+  auto& uart_reg = *to_usart(m_uart);
+
+  if (not p_handler) {
+    bit_modify(uart_reg.control1).clear<control_reg::idle_interrupt_enable>();
+    uart_idle_handler[index] = p_handler;
+    return;
+  }
+
+  uart_idle_handler[index] = p_handler;
+
+  initialize_interrupts();
+  switch (m_id) {
+    case peripheral::usart2:
+      cortex_m::enable_interrupt(irq::usart2, uart_idle_interrupt<1>);
+      break;
+    case peripheral::usart3:
+      cortex_m::enable_interrupt(irq::usart3, uart_idle_interrupt<2>);
+      break;
+    case peripheral::usart1:
+    default:
+      cortex_m::enable_interrupt(irq::usart1, uart_idle_interrupt<0>);
+      break;
+  }
+
+  bit_modify(uart_reg.control1).set<control_reg::idle_interrupt_enable>();
+}
+
+void uart::on_receive_progress(hal::callback<void()> p_handler)
+{
+  auto const index = uart_port_index(m_id);
+  auto& channel = dma::dma1->channel[m_dma - 1];
+
+  if (not p_handler) {
+    uart_progress_handler[index] = p_handler;
+    // Flow control and segmented buffers keep using the interrupts
+    auto const segmented =
+      uart_receive_ring[index].segment_size < m_receive_buffer.size();
+    if (not m_flow_control && not segmented) {
+      bit_modify(channel.configuration)
+        .clear<dma::half_transfer_interrupt_enable>()
+        .clear<dma::transfer_complete_interrupt_enable>();
+    }
+    return;
+  }
+
+  uart_progress_handler[index] = p_handler;
+  uart_enable_receive_interrupt(m_id);
+  bit_modify(channel.configuration)
+    .set<dma::half_transfer_interrupt_enable>()
+    .set<dma::transfer_complete_interrupt_enable>();
+}
+
+std::array<std::span<hal::byte const>, 2> uart::receive_view()
+{
+  std::span<hal::byte const> const buffer = m_receive_buffer;
+  auto const cursor = dma_cursor_position();
+
+  if (cursor >= m_read_index) {
+    return { buffer.subspan(m_read_index, cursor - m_read_index),
+             std::span<hal::byte const>{} };
+  }
+  return { buffer.subspan(m_read_index), buffer.first(cursor) };
+}
+
+void uart::consume(std::size_t p_count)
+{
+  auto const size = m_receive_buffer.size();
+  auto const waiting = wrap(dma_cursor_position() + size - m_read_index);
+
+  p_count = std::min(p_count, waiting);
+  m_read_index = wrap(m_read_index + p_count);
+
+  if (m_flow_control && p_count != 0) {
+    critical_section guard;
+    uart_update_request_to_send(uart_port_index(m_id));
+  }
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,214 @@
+#include <libhal-stm32f1/uart_receive_timeout.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include <libhal-armcortex/interrupt.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "pin.hpp"
+#include "power.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Slave mode that resets the counter on each trigger
+constexpr std::uint32_t reset_mode = 0b100;
+/// Trigger selections of the filtered inputs of channel 1 and 2
+constexpr std::uint32_t filtered_input1 = 0b101;
+constexpr std::uint32_t filtered_input2 = 0b110;
+
+/// Receive timeout running on each of timer2 to timer4
+std::array<uart_receive_timeout*, 3> running_timeout{};
+
+std::size_t timer_index(peripheral p_timer)
+{
+  return static_cast<std::size_t>(p_timer) -
+         static_cast<std::size_t>(peripheral::timer2);
+}
+
+template<peripheral timer>
+void receive_timeout_interrupt()
+{
+  auto& reg = *general_purpose_timer(timer);
+  auto const status = reg.SR;
+  // Writing 1 leaves a flag as it is, so only the flags read are cleared
+  reg.SR = ~status;
+
+  auto* timeout = running_timeout[timer_index(timer)];
+  if (timeout == nullptr) {
+    return;
+  }
+
+  // Only the enabled event is acted on, the other flag is set by every
+  // overflow while idle and by every edge within a message.
+  if (bit_extract<timer_status::update>(status) &&
+      bit_extract<timer_interrupt_enable::update>(reg.DIER)) {
+    timeout->silence_elapsed();
+  }
+  // An edge right after the timeout starts the next message
+  if (bit_extract<timer_status::trigger>(status) &&
+      bit_extract<timer_interrupt_enable::trigger>(reg.DIER)) {
+    timeout->line_active();
+  }
+}
+}  // namespace
+
+std::errc uart_receive_timeout::try_start(
+  uart_receive_timeout_settings const& p_settings,
+  hal::callback<void()> p_handler)
+{
+  auto* reg = general_purpose_timer(p_settings.timer);
+  auto const pin =
+    general_purpose_timer_pin(p_settings.timer, p_settings.channel);
+  // Only channels 1 and 2 can trigger the slave mode controller
+  if (reg == nullptr || not pin || p_settings.channel > 2) {
+    return std::errc::argument_out_of_domain;
+  }
+
+  auto const index = timer_index(p_settings.timer);
+  if (m_running || running_timeout[index] != nullptr) {
+    return std::errc::device_or_resource_busy;
+  }
+
+  // The count restarts at the last falling edge, which can be as early as
+  // the start bit of the last character.
+  auto const bits = static_cast<std::int64_t>(p_settings.silence_bits) +
+                    static_cast<std::int64_t>(p_settings.character_bits);
+  auto const baud_rate = static_cast<std::int64_t>(p_settings.baud_rate);
+  if (baud_rate <= 0 || p_settings.silence_bits == 0) {
+    return std::errc::operation_not_supported;
+  }
+  auto const claimed = claim_timer(p_settings.timer);
+  if (claimed != std::errc{}) {
+    return claimed;
+  }
+  auto const status = configure_periodic_timer(
+    p_settings.timer, hal::time_duration((bits * 1'000'000'000LL) / baud_rate));
+  if (status != std::errc{}) {
+    release_timer(p_settings.timer);
+    return status;
+  }
+
+  // An unconnected or released line idles high like the usart RX pin. The
+  // pull-up is selected by the output data bit, which configure_pin leaves
+  // as it is.
+  gpio(pin->port).bsrr = 1UL << pin->pin;
+  configure_pin(*pin, input_pull_up);
+
+  // Falling edges of the channel's input, filtered over 8 timer clocks
+  auto const channel_index = p_settings.channel - 1U;
+  auto const mode_shift = channel_index * 8U;
+  auto const selection = timer_capture_mode::selection;
+  auto const filter = timer_capture_mode::filter;
+  bit_modify(reg->CCMR1)
+    .insert(bit_mask::from(selection.position + mode_shift,
+                           selection.position + mode_shift + 1U),
+            0b01U)
+    .insert(bit_mask::from(filter.position + mode_shift,
+                           filter.position + mode_shift + 3U),
+            0b0011U);
+  reg->CCER = 0;
+  bit_modify(reg->CCER)
+    .set(bit_mask::from(timer_capture_enable::falling_edge.position +
+                        (channel_index * 4U)));
+
+  // The trigger is selected before the slave mode is turned on
+  auto const trigger =
+    (p_settings.channel == 1) ? filtered_input1 : filtered_input2;
+  bit_modify(reg->SMCR).insert<timer_slave_mode::trigger_selection>(trigger);
+  bit_modify(reg->SMCR).insert<timer_slave_mode::slave_mode_selection>(
+    reset_mode);
+  // Resets by the trigger must not look like the timeout
+  bit_modify(reg->CR1).set<timer_control::update_request_source>();
+
+  m_handler = p_handler;
+  m_completed = 0;
+  m_timer = p_settings.timer;
+  m_running = true;
+  running_timeout[index] = this;
+
+  initialize_interrupts();
+  switch (m_timer) {
+    case peripheral::timer3:
+      cortex_m::enable_interrupt(
+        irq::tim3, receive_timeout_interrupt<peripheral::timer3>);
+      break;
+    case peripheral::timer4:
+      cortex_m::enable_interrupt(
+        irq::tim4, receive_timeout_interrupt<peripheral::timer4>);
+      break;
+    case peripheral::timer2:
+    default:
+      cortex_m::enable_interrupt(
+        irq::tim2, receive_timeout_interrupt<peripheral::timer2>);
+      break;
+  }
+
+  // The line is idle until the first edge
+  reg->SR = 0;
+  bit_modify(reg->DIER).set<timer_interrupt_enable::trigger>();
+  bit_modify(reg->CR1).set<timer_control::counter_enable>();
+
+  return {};
+}
+
+void uart_receive_timeout::stop()
+{
+  if (not m_running) {
+    return;
+  }
+
+  auto& reg = *general_purpose_timer(m_timer);
+  bit_modify(reg.CR1).clear<timer_control::counter_enable>();
+  reg.DIER = 0;
+  reg.SMCR = 0;
+  cortex_m::disable_interrupt(general_purpose_timer_irq(m_timer));
+  power_off(m_timer);
+  release_timer(m_timer);
+
+  m_running = false;
+  running_timeout[timer_index(m_timer)] = nullptr;
+}
+
+void uart_receive_timeout::line_active()
+{
+  if (not m_running) {
+    return;
+  }
+
+  // The counter overflows periodically while the line is idle. The edge
+  // has just reset it, so any pending overflow is stale.
+  auto& reg = *general_purpose_timer(m_timer);
+  reg.SR = ~timer_status::update.value<std::uint32_t>();
+  bit_modify(reg.DIER)
+    .clear<timer_interrupt_enable::trigger>()
+    .set<timer_interrupt_enable::update>();
+}
+
+void uart_receive_timeout::silence_elapsed()
+{
+  if (not m_running) {
+    return;
+  }
+
+  auto& reg = *general_purpose_timer(m_timer);
+  bit_modify(reg.DIER)
+    .clear<timer_interrupt_enable::update>()
+    .set<timer_interrupt_enable::trigger>();
+
+  m_completed++;
+  if (m_handler) {
+    m_handler();
+  }
+}
+
+uart_receive_timeout::~uart_receive_timeout()
+{
+  stop();
+}
+}  // namespace hal::stm32f1
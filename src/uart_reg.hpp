@@ -10,6 +10,10 @@ struct status_reg  // NOLINT
   /// Indicates if the transmit data register is empty and can be loaded with
   /// another byte.
   static constexpr auto transit_empty = hal::bit_mask::from<7>();
+
+  /// Set once the RX line has been idle for a character after receiving
+  /// data. Cleared by reading the status and then the data register.
+  static constexpr auto idle = hal::bit_mask::from<4>();
 };
 
 /// Namespace for the control registers (CR1, CR3) bit masks and predefined
@@ -21,9 +25,21 @@ struct control_reg  // NOLINT
   /// consumption. (CR1)
   static constexpr auto usart_enable = hal::bit_mask::from<13>();
 
+  /// Transmission only starts while the CTS input is low (CR3)
+  static constexpr auto cts_enable = hal::bit_mask::from<9>();
+
+  /// Enables DMA transmitter (CR3)
+  static constexpr auto dma_transmitter_enable = hal::bit_mask::from<7>();
+
   /// Enables DMA receiver (CR3)
   static constexpr auto dma_receiver_enable = hal::bit_mask::from<6>();
 
+  /// Transmits and receives on the TX pin alone (CR3)
+  static constexpr auto half_duplex_selection = hal::bit_mask::from<3>();
+
+  /// Enables the interrupt on the idle line flag (CR1)
+  static constexpr auto idle_interrupt_enable = hal::bit_mask::from<4>();
+
   /// This bit enables the transmitter. (CR1)
   static constexpr auto transmitter_enable = hal::bit_mask::from<3>();
 
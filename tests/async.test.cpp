@@ -0,0 +1,123 @@
+#include <libhal-stm32f1/async.hpp>
+
+#include <array>
+#include <cstddef>
+
+#include <boost/ut.hpp>
+#include <libhal/error.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+task<int> wait_and_add(async_event& p_event, int p_value)
+{
+  co_await p_event;
+  co_return p_value + 1;
+}
+
+task<void> accumulate(async_event& p_first,
+                      async_event& p_second,
+                      int& p_result)
+{
+  p_result += co_await wait_and_add(p_first, 1);
+  p_result += co_await wait_and_add(p_second, 10);
+}
+task<void> await_task(task<int>& p_task, bool& p_failed)
+{
+  try {
+    (void)co_await std::move(p_task);
+  } catch (hal::resource_unavailable_try_again const&) {
+    p_failed = true;
+  }
+}
+}  // namespace
+
+void async_test()
+{
+  using namespace boost::ut;
+
+  "async_executor resumes tasks as events are signaled"_test = []() {
+    // Setup
+    std::array<hal::byte, 1024> frames{};
+    async_executor executor(hal::runtime{}, frames);
+    async_event first;
+    async_event second;
+    int result = 0;
+
+    // Exercise
+    expect(that % executor.spawn(accumulate(first, second, result)));
+    auto const live_before = executor.poll();
+    first.signal();
+    auto const live_middle = executor.poll();
+    auto const result_middle = result;
+    second.signal();
+    auto const live_after = executor.poll();
+
+    // Verify
+    expect(that % 1U == live_before);
+    expect(that % 1U == live_middle);
+    expect(that % 2 == result_middle);
+    expect(that % 0U == live_after);
+    expect(that % 13 == result);
+  };
+
+  "async_executor reuses frame memory"_test = []() {
+    // Setup
+    std::array<hal::byte, 512> frames{};
+    async_executor executor(hal::runtime{}, frames);
+    async_event event;
+    int result = 0;
+
+    // Exercise + Verify
+    for (int i = 0; i < 16; i++) {
+      event.signal();
+      expect(that % executor.spawn(accumulate(event, event, result)));
+      expect(that % 0U == executor.poll());
+    }
+    expect(that % (16 * 13) == result);
+  };
+
+  "task frames fail to allocate when memory is exhausted"_test = []() {
+    // Setup
+    std::array<hal::byte, 16> frames{};
+    async_executor executor(hal::runtime{}, frames);
+    async_event event;
+    int result = 0;
+
+    // Exercise
+    auto work = accumulate(event, event, result);
+
+    // Verify
+    expect(that % not work.valid());
+    expect(that % not executor.spawn(std::move(work)));
+  };
+
+  "awaiting a task that failed to allocate throws"_test = []() {
+    // Setup
+    std::array<hal::byte, 512> frames{};
+    async_executor executor(hal::runtime{}, frames);
+    async_event event;
+    task<int> failed;
+    bool failed_to_run = false;
+    auto outer = await_task(failed, failed_to_run);
+    // Take up the rest of the frame memory
+    std::array<task<int>, 16> hogs{};
+    for (auto& hog : hogs) {
+      hog = wait_and_add(event, 0);
+      if (not hog.valid()) {
+        break;
+      }
+    }
+    failed = wait_and_add(event, 0);
+
+    // Exercise
+    expect(that % outer.valid());
+    expect(that % executor.spawn(std::move(outer)));
+    auto const live = executor.poll();
+
+    // Verify
+    expect(that % not failed.valid());
+    expect(that % 0U == live);
+    expect(that % failed_to_run);
+  };
+}
+}  // namespace hal::stm32f1
@@ -1,6 +1,12 @@
 #include <libhal-stm32f1/can.hpp>
 
+#include <cstdint>
+
+#include <boost/ut.hpp>
+
+#include "can.hpp"
 #include "can_reg.hpp"
+#include "helper.hpp"
 #include "rcc_reg.hpp"
 
 namespace hal::stm32f1 {
@@ -9,9 +15,40 @@ bool volatile skip = true;
 }
 void can_test()
 {
+  using namespace boost::ut;
+
   can* my_can = reinterpret_cast<can*>(0x1000'0000);
   if (not skip) {
     my_can->bus_on();
   }
+
+  "read_transmit_result reports the status flags of each mailbox"_test =
+    []() {
+      // Setup
+      stub_out_registers stub(&can1_reg);
+      auto& mailbox = can1_reg->transmit_mailbox[1];
+      mailbox.TIR = (0x1ABC'DEF0U << 3U) | (1U << 2U);
+      mailbox.TDTR = (0x1234U << 16U) | 3U;
+      mailbox.TDLR = 0x0033'2211;
+      // Mailbox 0 sent its frame, mailbox 1 lost arbitration
+      constexpr std::uint32_t status = 0b0011U | (0b0101U << 8U);
+
+      // Exercise
+      auto const lost = read_transmit_result(1, status);
+      auto const sent = read_transmit_result(0, status);
+
+      // Verify
+      expect(that % 1 == lost.mailbox);
+      expect(that % 0x1ABC'DEF0U == lost.message.id);
+      expect(that % 3 == lost.message.length);
+      expect(that % 0x11 == lost.message.payload[0]);
+      expect(that % 0x33 == lost.message.payload[2]);
+      expect(not lost.transmitted);
+      expect(lost.arbitration_lost);
+      expect(not lost.error);
+      expect(that % 0x1234 == lost.timestamp);
+      expect(sent.transmitted);
+      expect(not sent.arbitration_lost);
+    };
 }
 }  // namespace hal::stm32f1
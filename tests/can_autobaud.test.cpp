@@ -0,0 +1,103 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <boost/ut.hpp>
+#include <libhal-util/can.hpp>
+
+#include "can.hpp"
+#include "can_reg.hpp"
+#include "helper.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Clock that also plays the part of the can controller. Each read of the
+/// uptime acknowledges mode requests and reports the outcome of listening to
+/// a bus running at `m_bus_prescaler`.
+class simulated_bus_clock : public hal::steady_clock
+{
+public:
+  std::uint64_t m_ticks = 0;
+  std::uint32_t m_bus_prescaler = 0;
+  bool m_bus_active = true;
+
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    constexpr std::uint32_t initialization = 1U << 0U;
+    constexpr std::uint32_t lec_mask = 0b111U << 4U;
+    constexpr std::uint32_t stuff_error = 0b001U << 4U;
+
+    if (can1_reg->MCR & initialization) {
+      can1_reg->MSR = can1_reg->MSR | initialization;
+    } else {
+      can1_reg->MSR = can1_reg->MSR & ~initialization;
+      if (m_bus_active) {
+        auto const prescaler = can1_reg->BTR & 0x3FFU;
+        auto const code = prescaler == m_bus_prescaler ? 0U : stuff_error;
+        can1_reg->ESR = (can1_reg->ESR & ~lec_mask) | code;
+      }
+    }
+
+    m_ticks += 1000;
+    return m_ticks;
+  }
+};
+
+std::uint32_t prescaler_of(hal::hertz p_baud_rate)
+{
+  // The can peripheral runs from the 8MHz internal oscillator after reset
+  auto const divider = calculate_can_bus_divider(8'000'000.0f, p_baud_rate);
+  return divider.value().clock_divider - 1U;
+}
+}  // namespace
+
+void can_autobaud_test()
+{
+  using namespace boost::ut;
+
+  "detect_baud_rate finds the rate of the bus"_test = []() {
+    // Setup
+    stub_out_registers stub(&can1_reg);
+    simulated_bus_clock clock;
+    clock.m_bus_prescaler = prescaler_of(125'000.0f);
+    std::array<hal::hertz, 3> const candidates{ 500'000.0f,
+                                                250'000.0f,
+                                                125'000.0f };
+
+    // Exercise
+    auto const detected = detect_baud_rate(
+      clock, candidates, std::chrono::milliseconds(10));
+
+    // Verify
+    expect(detected.has_value());
+    expect(that % 125'000.0f == detected.value_or(0.0f));
+    expect(that % prescaler_of(125'000.0f) == (can1_reg->BTR & 0x3FFU));
+    expect(that % 0U == (can1_reg->BTR & (1U << 31U)));  // silent mode left
+    expect(that % 0U == (can1_reg->MSR & 1U));  // initialization left
+  };
+
+  "detect_baud_rate gives up on a silent bus within the time bound"_test =
+    []() {
+      // Setup
+      stub_out_registers stub(&can1_reg);
+      simulated_bus_clock clock;
+      clock.m_bus_active = false;
+      std::array<hal::hertz, 2> const candidates{ 500'000.0f, 250'000.0f };
+
+      // Exercise
+      auto const detected = detect_baud_rate(
+        clock, candidates, std::chrono::milliseconds(10));
+
+      // Verify
+      expect(not detected.has_value());
+      // Two candidates of 10ms each plus the final reconfiguration
+      expect(that % clock.m_ticks <= 40'000U);
+    };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,111 @@
+#include <libhal-stm32f1/can_bit_timing.hpp>
+
+#include <cstdint>
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+constexpr auto timing_500k = solve_can_bit_timing({
+  .peripheral_frequency = 36'000'000,
+  .baud_rate = 500'000,
+  .sample_point = 875,
+});
+
+// Evaluated by the compiler, nothing is left to compute at runtime
+static_assert(timing_500k.btr == 0x0005'0008U);
+static_assert(timing_500k.baud_rate_error == 0);
+static_assert(timing_500k.sample_point == 875);
+}  // namespace
+
+void can_bit_timing_test()
+{
+  using namespace boost::ut;
+
+  "find_can_bit_timing hits the sample point exactly when possible"_test =
+    []() {
+      // Setup
+      constexpr can_bit_timing_request request{
+        .peripheral_frequency = 36'000'000,
+        .baud_rate = 500'000,
+        .sample_point = 875,
+      };
+
+      // Exercise
+      auto const timing = find_can_bit_timing(request);
+
+      // Verify
+      expect(timing.has_value());
+      expect(that % 9 == timing->prescaler);
+      expect(that % 8 == timing->time_quanta);
+      expect(that % 6 == timing->segment1);
+      expect(that % 1 == timing->segment2);
+      expect(that % 1 == timing->sync_jump_width);
+      expect(that % 875 == timing->sample_point);
+      expect(that % 500'000U == timing->baud_rate);
+      expect(that % 0 == timing->baud_rate_error);
+    };
+
+  "find_can_bit_timing prefers more time quanta on a tie"_test = []() {
+    // Setup
+    constexpr can_bit_timing_request request{
+      .peripheral_frequency = 8'000'000,
+      .baud_rate = 125'000,
+      .sample_point = 875,
+    };
+
+    // Exercise
+    auto const timing = find_can_bit_timing(request);
+
+    // Verify
+    expect(timing.has_value());
+    expect(that % 16 == timing->time_quanta);
+    expect(that % 4 == timing->prescaler);
+    expect(that % 13 == timing->segment1);
+    expect(that % 2 == timing->segment2);
+    expect(that % 0x001C'0003U == timing->btr);
+  };
+
+  "find_can_bit_timing reports the error of an inexact bit rate"_test = []() {
+    // Setup
+    constexpr can_bit_timing_request request{
+      .peripheral_frequency = 36'000'000,
+      .baud_rate = 83'333,
+      .sample_point = 875,
+    };
+
+    // Exercise
+    auto const timing = find_can_bit_timing(request);
+
+    // Verify
+    expect(timing.has_value());
+    expect(that % 83'333U <= timing->baud_rate);
+    expect(that % 0 < timing->baud_rate_error);
+    expect(that % 10 > timing->baud_rate_error);
+  };
+
+  "find_can_bit_timing rejects unreachable requirements"_test = []() {
+    // Exercise
+    auto const too_fast = find_can_bit_timing({
+      .peripheral_frequency = 36'000'000,
+      .baud_rate = 1'234'567,
+    });
+    // Segment 2 of a 87.5% sample point is never long enough for SJW 4
+    auto const wide_jump = find_can_bit_timing({
+      .peripheral_frequency = 36'000'000,
+      .baud_rate = 500'000,
+      .sync_jump_width = 4,
+    });
+    auto const no_jump = find_can_bit_timing({
+      .peripheral_frequency = 36'000'000,
+      .baud_rate = 500'000,
+      .sync_jump_width = 0,
+    });
+
+    // Verify
+    expect(not too_fast.has_value());
+    expect(not wide_jump.has_value());
+    expect(not no_jump.has_value());
+  };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,207 @@
+#include <libhal-stm32f1/can_dispatch.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include <boost/ut.hpp>
+
+#include "can.hpp"
+#include "can_reg.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Plays the part of the can controller acknowledging requests to enter and
+/// leave initialization mode, which the driver waits for while it is
+/// constructed.
+class simulated_initialization_acknowledge
+{
+public:
+  simulated_initialization_acknowledge()
+    : m_thread([](std::stop_token p_stop) {
+      constexpr std::uint32_t initialization = 1U << 0U;
+      while (not p_stop.stop_requested()) {
+        if (can1_reg->MCR & initialization) {
+          can1_reg->MSR = can1_reg->MSR | initialization;
+        } else {
+          can1_reg->MSR = can1_reg->MSR & ~initialization;
+        }
+      }
+    })
+  {
+  }
+
+private:
+  std::jthread m_thread;
+};
+
+/// Load a message into the output mailbox of a receive FIFO, as accepted by
+/// the filter with the given filter match index
+void receive(std::uint8_t p_fifo,
+             std::uint8_t p_filter_match_index,
+             hal::can::id_t p_id)
+{
+  can1_reg->RF0R = (p_fifo == 0) ? 1U : 0U;
+  can1_reg->RF1R = (p_fifo == 1) ? 1U : 0U;
+  can1_reg->fifo_mailbox[p_fifo].RIR = p_id << 21U;
+  can1_reg->fifo_mailbox[p_fifo].RDTR =
+    static_cast<std::uint32_t>(p_filter_match_index) << 8U;
+}
+}  // namespace
+
+void can_dispatch_test()
+{
+  using namespace boost::ut;
+
+  "read_filtered_receive_mailbox reports the filter match index"_test = []() {
+    // Setup
+    stub_out_registers stub(&can1_reg);
+    can1_reg->RF1R = 1;  // one message pending in FIFO 1
+    can1_reg->fifo_mailbox[1].RIR = 0x123U << 21U;
+    can1_reg->fifo_mailbox[1].RDTR = (5U << 8U) | 2U;
+    can1_reg->fifo_mailbox[1].RDLR = 0xBBAA;
+
+    // Exercise
+    auto const filtered = read_filtered_receive_mailbox();
+
+    // Verify
+    expect(that % 1 == filtered.route.fifo);
+    expect(that % 5 == filtered.route.filter_match_index);
+    expect(that % 0x123U == filtered.message.id);
+    expect(that % 2 == filtered.message.length);
+    expect(that % 0xAA == filtered.message.payload[0]);
+    expect(that % 0xBB == filtered.message.payload[1]);
+  };
+
+  "can_dispatch_table routes by fifo and filter match index"_test = []() {
+    // Setup
+    can_dispatch_table<4> table;
+    int first = 0;
+    int second = 0;
+    int unrouted = 0;
+    expect(that % table.set({ .fifo = 0, .filter_match_index = 1 },
+                            [&first](hal::can::message_t const&) { first++; }));
+    expect(that % table.set({ .fifo = 1, .filter_match_index = 1 },
+                            [&second](hal::can::message_t const&) {
+                              second++;
+                            }));
+    expect(that % not table.set({ .fifo = 0, .filter_match_index = 4 },
+                                [](hal::can::message_t const&) {}));
+    table.fallback([&unrouted](can::filtered_message_t const&) { unrouted++; });
+
+    // Exercise
+    table.dispatch({ .route = { .fifo = 0, .filter_match_index = 1 } });
+    table.dispatch({ .route = { .fifo = 1, .filter_match_index = 1 } });
+    table.dispatch({ .route = { .fifo = 1, .filter_match_index = 1 } });
+    table.dispatch({ .route = { .fifo = 0, .filter_match_index = 2 } });
+    table.dispatch({ .route = { .fifo = 0, .filter_match_index = 9 } });
+
+    // Verify
+    expect(that % 1 == first);
+    expect(that % 2 == second);
+    expect(that % 2 == unrouted);
+  };
+
+  "can filters route messages by filter match index to their handler"_test =
+    []() {
+      // Setup
+      stub_out_registers can_stub(&can1_reg);
+      stub_out_registers rcc_stub(&rcc);
+      stub_out_registers afio_stub(&alternative_function_io);
+      stub_out_registers gpio_a_stub(&gpio_a_reg);
+      std::optional<can> bus;
+      {
+        simulated_initialization_acknowledge controller;
+        bus.emplace();
+      }
+      can_dispatch_table<4> table;
+      int engine = 0;
+      int brakes = 0;
+      int lights = 0;
+      int unrouted = 0;
+
+      // Exercise
+      auto const engine_status =
+        bus->try_configure_filter(0, { .id = 0x100, .mask = 0x7F0 });
+      auto const brakes_status =
+        bus->try_configure_filter(1, { .id = 0x200, .mask = 0x7FF, .fifo = 1 });
+      auto const lights_status =
+        bus->try_configure_filter(2, { .id = 0x300, .mask = 0x7FF });
+      auto const bad_fifo_status =
+        bus->try_configure_filter(3, { .id = 0x400, .mask = 0x7FF, .fifo = 2 });
+      auto const engine_route = bus->route(0);
+      auto const brakes_route = bus->route(1);
+      auto const lights_route = bus->route(2);
+      table.set(engine_route,
+                [&engine](hal::can::message_t const&) { engine++; });
+      table.set(brakes_route,
+                [&brakes](hal::can::message_t const&) { brakes++; });
+      table.set(lights_route,
+                [&lights](hal::can::message_t const&) { lights++; });
+      table.fallback(
+        [&unrouted](can::filtered_message_t const&) { unrouted++; });
+      // The hardware numbers filters per FIFO: bank 0 is FMI 0 and bank 2 is
+      // FMI 1 of FIFO 0, bank 1 is FMI 0 of FIFO 1.
+      receive(0, 0, 0x105);
+      table.dispatch(read_filtered_receive_mailbox());
+      receive(1, 0, 0x200);
+      table.dispatch(read_filtered_receive_mailbox());
+      receive(0, 1, 0x300);
+      table.dispatch(read_filtered_receive_mailbox());
+      receive(0, 1, 0x300);
+      table.dispatch(read_filtered_receive_mailbox());
+      receive(0, 2, 0x500);
+      table.dispatch(read_filtered_receive_mailbox());
+
+      // Verify
+      expect(std::errc{} == engine_status);
+      expect(std::errc{} == brakes_status);
+      expect(std::errc{} == lights_status);
+      expect(std::errc::argument_out_of_domain == bad_fifo_status);
+      expect(that % 0b111U == can1_reg->FA1R);
+      expect(that % 0b010U == can1_reg->FFA1R);
+      expect(that % (0x100U << 21U) == can1_reg->sFilterRegister[0].FR1);
+      expect(that % ((0x7F0U << 21U) | (1U << 2U)) ==
+             can1_reg->sFilterRegister[0].FR2);
+      expect(that % 0 == engine_route.fifo);
+      expect(that % 0 == engine_route.filter_match_index);
+      expect(that % 1 == brakes_route.fifo);
+      expect(that % 0 == brakes_route.filter_match_index);
+      expect(that % 0 == lights_route.fifo);
+      expect(that % 1 == lights_route.filter_match_index);
+      expect(that % 1 == engine);
+      expect(that % 1 == brakes);
+      expect(that % 2 == lights);
+      expect(that % 1 == unrouted);
+    };
+
+  "can destructor disables its interrupts and drops its hooks"_test = []() {
+    // Setup
+    stub_out_registers can_stub(&can1_reg);
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    std::optional<can> bus;
+    {
+      simulated_initialization_acknowledge controller;
+      bus.emplace();
+    }
+    bus->on_transmit_ready([]() {});
+    bus->on_receive([](hal::can::message_t const&) {});
+    can_statistics_hooks.record_receive = [](hal::can::message_t const&) {};
+    auto const enabled = can1_reg->IER;
+
+    // Exercise
+    bus.reset();
+
+    // Verify
+    expect(that % 0U != enabled);
+    expect(that % 0U == can1_reg->IER);
+    expect(not can_statistics_hooks.record_receive);
+  };
+}
+}  // namespace hal::stm32f1
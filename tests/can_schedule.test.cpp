@@ -0,0 +1,186 @@
+#include <libhal-stm32f1/can_schedule.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include <boost/ut.hpp>
+
+#include "can.hpp"
+#include "can_reg.hpp"
+#include "critical_section.hpp"
+#include "helper.hpp"
+#include "rcc_reg.hpp"
+#include "timer.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::uint32_t all_mailboxes_empty = 0b111U << 26U;
+
+/// Number of mailboxes loaded since the last call, unloads them
+std::size_t take_loaded_mailboxes()
+{
+  std::size_t loaded = 0;
+  for (auto& mailbox : can1_reg->transmit_mailbox) {
+    if (mailbox.TIR != 0) {
+      loaded++;
+      mailbox.TIR = 0;
+    }
+  }
+  return loaded;
+}
+}  // namespace
+
+void can_schedule_test()
+{
+  using namespace boost::ut;
+
+  "can_schedule staggers frames across ticks"_test = []() {
+    // Setup
+    stub_out_registers stub(&can1_reg);
+    can1_reg->TSR = all_mailboxes_empty;
+    std::array<can_cyclic_frame, 6> frames{ {
+      { { .id = 0x100 }, 10 },
+      { { .id = 0x101 }, 10 },
+      { { .id = 0x102 }, 10 },
+      { { .id = 0x103 }, 10 },
+      { { .id = 0x200 }, 20 },
+      { { .id = 0x201 }, 20 },
+    } };
+    can_schedule schedule;
+    for (auto& frame : frames) {
+      expect(std::errc{} == schedule.add(frame));
+    }
+    expect(std::errc::address_in_use == schedule.add(frames[0]));
+
+    // Exercise
+    schedule.plan();
+    std::size_t peak = 0;
+    std::size_t total = 0;
+    for (int tick = 0; tick < 40; tick++) {
+      schedule.tick();
+      auto const loaded = take_loaded_mailboxes();
+      peak = std::max(peak, loaded);
+      total += loaded;
+    }
+
+    // Verify
+    expect(that % 1U == peak);
+    expect(that % 20U == total);
+    for (auto const& frame : frames) {
+      expect(that % 0U == frame.overruns());
+    }
+  };
+
+  "can_cyclic_frame sends the updated payload"_test = []() {
+    // Setup
+    stub_out_registers stub(&can1_reg);
+    can1_reg->TSR = all_mailboxes_empty;
+    can_cyclic_frame frame({ .id = 0x1234'5678,
+                             .payload = { 1, 2, 3, 4, 5, 6, 7, 8 },
+                             .length = 8 },
+                           1);
+    can_schedule schedule;
+    expect(std::errc{} == schedule.add(frame));
+    schedule.plan();
+    std::array<hal::byte, 3> const update{ 0xAA, 0xBB, 0xCC };
+
+    // Exercise
+    frame.update_payload(update, 3);
+    schedule.tick();
+
+    // Verify
+    auto const& mailbox = can1_reg->transmit_mailbox[0];
+    expect(that % ((0x1234'5678U << 3U) | 0b101U) == mailbox.TIR);
+    expect(that % 8U == mailbox.TDTR);
+    expect(that % 0xAA03'0201U == mailbox.TDLR);
+    expect(that % 0x0807'CCBBU == mailbox.TDHR);
+  };
+
+  "can_schedule counts overruns while the mailboxes are full"_test = []() {
+    // Setup
+    stub_out_registers stub(&can1_reg);
+    can1_reg->TSR = 0;
+    can_cyclic_frame frame({ .id = 0x300, .length = 1 }, 2);
+    can_schedule schedule;
+    expect(std::errc{} == schedule.add(frame));
+    schedule.plan();
+
+    // Exercise
+    for (int tick = 0; tick < 6; tick++) {
+      schedule.tick();
+    }
+    auto const overruns = frame.overruns();
+    can1_reg->TSR = all_mailboxes_empty;
+    schedule.transmit_ready();
+
+    // Verify
+    expect(that % 2U == overruns);
+    expect(that % 1U == take_loaded_mailboxes());
+  };
+
+  "can_schedule tick during a send takes another mailbox"_test = []() {
+    // Setup
+    stub_out_registers stub(&can1_reg);
+    can1_reg->TSR = all_mailboxes_empty;
+    can_cyclic_frame frame({ .id = 0x300, .length = 1 }, 1);
+    can_schedule schedule;
+    expect(std::errc{} == schedule.add(frame));
+    schedule.plan();
+    can::message_t const message{ .id = 0x123, .length = 1 };
+    // The timer fires while the send picks its mailbox
+    host_pending_interrupt = [&schedule]() {
+      // The hardware marks a mailbox full once its transmit is requested
+      for (std::uint32_t mailbox = 0; mailbox < 3; mailbox++) {
+        if (can1_reg->transmit_mailbox[mailbox].TIR != 0) {
+          can1_reg->TSR = can1_reg->TSR & ~(1U << (26U + mailbox));
+        }
+      }
+      schedule.tick();
+    };
+
+    // Exercise
+    auto const queued = load_transmit_mailboxes(std::span(&message, 1));
+
+    // Verify
+    expect(that % 1U == queued);
+    expect(not host_pending_interrupt);
+    expect(that % ((0x123U << 21U) | 1U) ==
+           can1_reg->transmit_mailbox[0].TIR);
+    expect(that % ((0x300U << 21U) | 1U) ==
+           can1_reg->transmit_mailbox[1].TIR);
+    expect(that % 0U == frame.overruns());
+  };
+
+  "configure_periodic_timer splits the period across the prescaler"_test =
+    []() {
+      // Setup
+      stub_out_registers rcc_stub(&rcc);
+      stub_out_registers timer_stub(&timer3_reg);
+
+      // Exercise
+      // The timer clock runs from the 8MHz internal oscillator after reset
+      auto const short_status = configure_periodic_timer(
+        peripheral::timer3, std::chrono::milliseconds(1));
+      auto const short_prescale = timer3_reg->PSC;
+      auto const short_reload = timer3_reg->ARR;
+      auto const long_status = configure_periodic_timer(
+        peripheral::timer3, std::chrono::milliseconds(10));
+
+      // Verify
+      expect(std::errc{} == short_status);
+      expect(that % 0U == short_prescale);
+      expect(that % 7999U == short_reload);
+      expect(std::errc{} == long_status);
+      expect(that % 1U == timer3_reg->PSC);
+      expect(that % 39999U == timer3_reg->ARR);
+      expect(std::errc::argument_out_of_domain ==
+             configure_periodic_timer(peripheral::timer1,
+                                      std::chrono::milliseconds(1)));
+    };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,189 @@
+#include <libhal-stm32f1/can_statistics.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include <boost/ut.hpp>
+
+#include "critical_section.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+class fake_clock : public hal::steady_clock
+{
+public:
+  std::uint64_t m_ticks = 0;
+
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return m_ticks;
+  }
+};
+
+class fake_serial : public hal::serial
+{
+public:
+  std::string m_output{};
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    m_output.append(p_data.begin(), p_data.end());
+    return { .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return { .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+}  // namespace
+
+void can_statistics_test()
+{
+  using namespace boost::ut;
+
+  "can_statistics frame bit lengths"_test = []() {
+    // Setup
+    hal::can::message_t const standard{ .id = 0x123, .length = 8 };
+    hal::can::message_t const extended{ .id = 0x1234'5678, .length = 8 };
+    hal::can::message_t const remote{ .id = 0x123,
+                                      .length = 8,
+                                      .is_remote_request = true };
+
+    // Exercise + Verify
+    // Worst case lengths of an 8 byte frame including the interframe space
+    // are 135 bits for standard and 160 bits for extended IDs.
+    expect(that % 111U == can_statistics::nominal_bits(standard));
+    expect(that % 24U == can_statistics::worst_case_stuff_bits(standard));
+    expect(that % 131U == can_statistics::nominal_bits(extended));
+    expect(that % 29U == can_statistics::worst_case_stuff_bits(extended));
+    expect(that % 47U == can_statistics::nominal_bits(remote));
+    expect(that % 8U == can_statistics::worst_case_stuff_bits(remote));
+  };
+
+  "can_statistics per ID counts and intervals"_test = []() {
+    // Setup
+    fake_clock clock;
+    static_can_statistics<16> statistics(clock);
+    hal::can::message_t const a{ .id = 0x100, .length = 8 };
+    hal::can::message_t const b{ .id = 0x200, .length = 2 };
+
+    // Exercise
+    statistics.record_receive(a);
+    clock.m_ticks += 1000;
+    statistics.record_transmit(b);
+    statistics.record_receive(a);
+    clock.m_ticks += 3000;
+    statistics.record_receive(a);
+    auto const a_stats = statistics.find(0x100);
+    auto const b_stats = statistics.find(0x200);
+    auto const unknown = statistics.find(0x300);
+    auto const totals = statistics.snapshot();
+
+    // Verify
+    expect(that % 3U == a_stats.frames);
+    expect(that % 1000U == a_stats.min_interval);
+    expect(that % 3000U == a_stats.max_interval);
+    expect(that % 1U == b_stats.frames);
+    expect(that % 0U == unknown.frames);
+    expect(that % 3U == totals.received_frames);
+    expect(that % 1U == totals.transmitted_frames);
+    expect(that % 0U == totals.untracked_frames);
+    expect(that % 4000U == totals.duration);
+  };
+
+  "can_statistics counts untracked IDs once the table is full"_test = []() {
+    // Setup
+    fake_clock clock;
+    static_can_statistics<4> statistics(clock);
+
+    // Exercise
+    for (hal::can::id_t id = 0; id < 6; id++) {
+      statistics.record_receive({ .id = id, .length = 1 });
+    }
+    auto const totals = statistics.snapshot();
+
+    // Verify
+    expect(that % 6U == totals.received_frames);
+    expect(that % 2U == totals.untracked_frames);
+  };
+
+  "can_statistics bus load"_test = []() {
+    // Setup
+    fake_clock clock;
+    static_can_statistics<8> statistics(clock);
+    statistics.baud_rate(125'000.0f);
+    hal::can::message_t const frame{ .id = 0x100, .length = 8 };
+
+    // Exercise
+    // 1000 frames of 111 nominal bits within 1.776 seconds at 125kbit/s
+    for (int i = 0; i < 1000; i++) {
+      statistics.record_receive(frame);
+    }
+    clock.m_ticks += 1'776'000;
+    auto const totals = statistics.snapshot();
+
+    // Verify
+    expect(totals.minimum_bus_load() > 0.49f);
+    expect(totals.minimum_bus_load() < 0.51f);
+    expect(totals.maximum_bus_load() > totals.minimum_bus_load());
+  };
+
+  "can_statistics exports JSON over serial"_test = []() {
+    // Setup
+    fake_clock clock;
+    fake_serial serial;
+    static_can_statistics<8> statistics(clock);
+    statistics.baud_rate(500'000.0f);
+    statistics.record_receive({ .id = 0x7FF, .length = 4 });
+    clock.m_ticks += 250;
+    statistics.record_receive({ .id = 0x7FF, .length = 4 });
+
+    // Exercise
+    statistics.export_snapshot(serial);
+
+    // Verify
+    auto const& output = serial.m_output;
+    expect(output.starts_with("{\"duration_us\":250,\"baud_rate\":500000,"));
+    expect(output.find(",\"rx\":2,\"tx\":0,\"untracked\":0,"
+                       "\"bus_load_ppm\":[") != std::string::npos);
+    expect(output.find("\"ids\":[{\"id\":2047,\"frames\":2,\"min_us\":250,"
+                       "\"max_us\":250}]}\n") != std::string::npos);
+  };
+
+  "critical_section restores the interrupt mask it found"_test = []() {
+    // Setup
+    bool masked_after_inner = false;
+
+    // Exercise
+    {
+      critical_section outer;
+      {
+        critical_section inner;
+      }
+      masked_after_inner = interrupts_masked();
+    }
+    auto const after = interrupts_masked();
+
+    // Verify
+    expect(masked_after_inner);
+    expect(not after);
+  };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,142 @@
+#include <libhal-stm32f1/io_multiplexer.hpp>
+
+#include <array>
+#include <cstdint>
+
+#include <boost/ut.hpp>
+#include <libhal/can.hpp>
+
+#include "dma.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// can that hands out the receive handler so that tests can play the part of
+/// its interrupt
+class captured_receive_can : public hal::can
+{
+public:
+  hal::callback<handler> m_handler{};
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_bus_on() override
+  {
+  }
+
+  void driver_send(message_t const&) override
+  {
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    m_handler = p_handler;
+  }
+};
+}  // namespace
+
+void io_multiplexer_test()
+{
+  using namespace boost::ut;
+
+  "io_multiplexer hands out each bit once"_test = []() {
+    // Setup
+    io_multiplexer mux;
+
+    // Exercise
+    auto const first = mux.allocate();
+    auto const second = mux.allocate();
+    for (int i = 2; i < 32; i++) {
+      (void)mux.allocate();
+    }
+    auto const exhausted = mux.allocate();
+
+    // Verify
+    expect(that % 0b01U == first);
+    expect(that % 0b10U == second);
+    expect(that % 0U == exhausted);
+  };
+
+  "io_multiplexer collects signals until they are taken"_test = []() {
+    // Setup
+    io_multiplexer mux;
+    auto const first = mux.allocate();
+    auto const second = mux.allocate();
+
+    // Exercise
+    auto const idle = mux.poll();
+    mux.signal(second);
+    mux.signal(first);
+    mux.signal(second);
+    auto const ready = mux.wait();
+    auto const taken = mux.poll();
+
+    // Verify
+    expect(that % 0U == idle);
+    expect(that % (first | second) == ready);
+    expect(that % 0U == taken);
+  };
+
+  "io_multiplexer marks a can ready after its handler"_test = []() {
+    // Setup
+    io_multiplexer mux;
+    captured_receive_can can;
+    hal::can::id_t received = 0;
+    io_multiplexer::ready_set ready_in_handler = 1;
+    auto const bit = mux.watch(can, [&](hal::can::message_t const& p_message) {
+      received = p_message.id;
+      ready_in_handler = mux.poll();
+    });
+
+    // Exercise
+    can.m_handler({ .id = 0x123 });
+    auto const ready = mux.poll();
+
+    // Verify
+    expect(that % 0x123U == received);
+    expect(that % 0U == ready_in_handler);
+    expect(that % bit == ready);
+  };
+
+  "io_multiplexer turns on the receive interrupts of a uart"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 64> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    io_multiplexer mux;
+    // USART1 RX uses DMA1 channel 5
+    auto const& channel = dma::dma1->channel[5 - 1];
+    auto const fill_interrupts =
+      bit_value(0U)
+        .set<dma::half_transfer_interrupt_enable>()
+        .set<dma::transfer_complete_interrupt_enable>()
+        .get();
+    auto const idle_interrupt =
+      bit_value(0U).set<control_reg::idle_interrupt_enable>().get();
+
+    // Exercise
+    auto const bit = mux.watch(driver);
+    auto const watched_dma = channel.configuration;
+    auto const watched_usart = usart1->control1;
+    driver.on_receive_progress({});
+    driver.on_receive_idle({});
+
+    // Verify
+    expect(that % 1U == bit);
+    expect(that % fill_interrupts == (watched_dma & fill_interrupts));
+    expect(that % idle_interrupt == (watched_usart & idle_interrupt));
+    expect(that % 0U == (channel.configuration & fill_interrupts));
+    expect(that % 0U == (usart1->control1 & idle_interrupt));
+  };
+}
+}  // namespace hal::stm32f1
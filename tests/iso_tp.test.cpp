@@ -0,0 +1,298 @@
+#include <libhal-stm32f1/iso_tp.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <numeric>
+#include <system_error>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+class fake_clock : public hal::steady_clock
+{
+public:
+  std::uint64_t m_ticks = 0;
+
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return m_ticks;
+  }
+};
+
+/// Models a can controller with three transmit mailboxes whose frames are
+/// delivered to a peer engine when the bus is stepped.
+class loopback_node
+{
+public:
+  static constexpr std::size_t mailbox_count = 3;
+
+  std::errc transmit(hal::can::message_t const& p_message)
+  {
+    if (m_mailboxes.size() >= mailbox_count) {
+      return std::errc::resource_unavailable_try_again;
+    }
+    m_mailboxes.push_back(p_message);
+    m_sent.push_back(p_message);
+    return {};
+  }
+
+  std::deque<hal::can::message_t> m_mailboxes{};
+  std::vector<hal::can::message_t> m_sent{};
+  iso_tp* m_engine = nullptr;
+};
+
+/// Deliver frames between two nodes until the bus is idle
+void run_bus(loopback_node& p_a, loopback_node& p_b, int p_limit = 100'000)
+{
+  for (int i = 0; i < p_limit; i++) {
+    if (p_a.m_mailboxes.empty() && p_b.m_mailboxes.empty()) {
+      return;
+    }
+    for (auto* node : { &p_a, &p_b }) {
+      auto* peer = (node == &p_a) ? &p_b : &p_a;
+      if (node->m_mailboxes.empty()) {
+        continue;
+      }
+      auto const frame = node->m_mailboxes.front();
+      node->m_mailboxes.pop_front();
+      peer->m_engine->handle_frame(frame);
+      node->m_engine->transmit_ready();
+    }
+  }
+}
+
+std::vector<hal::byte> make_message(std::size_t p_size)
+{
+  std::vector<hal::byte> message(p_size);
+  std::iota(message.begin(), message.end(), hal::byte{ 0 });
+  return message;
+}
+
+struct test_fixture
+{
+  test_fixture()
+  {
+    a.m_engine = &engine_a;
+    b.m_engine = &engine_b;
+  }
+
+  fake_clock clock{};
+  loopback_node a{};
+  loopback_node b{};
+  iso_tp engine_a{ [this](hal::can::message_t const& p_message) {
+                    return a.transmit(p_message);
+                  },
+                   clock };
+  iso_tp engine_b{ [this](hal::can::message_t const& p_message) {
+                    return b.transmit(p_message);
+                  },
+                   clock };
+};
+}  // namespace
+
+void iso_tp_test()
+{
+  using namespace boost::ut;
+
+  "iso_tp single frame"_test = []() {
+    // Setup
+    test_fixture fixture;
+    std::array<hal::byte, 16> receive_buffer{};
+    iso_tp_session sender({ .transmit_id = 0x7E0, .receive_id = 0x7E8 }, {});
+    iso_tp_session receiver({ .transmit_id = 0x7E8, .receive_id = 0x7E0 },
+                            receive_buffer);
+    expect(std::errc{} == fixture.engine_a.add(sender));
+    expect(std::errc{} == fixture.engine_b.add(receiver));
+    std::array<hal::byte, 3> const message{ 0x22, 0xF1, 0x90 };
+
+    // Exercise
+    auto const status = fixture.engine_a.send(sender, message);
+    run_bus(fixture.a, fixture.b);
+
+    // Verify
+    expect(std::errc{} == status);
+    expect(that % 1U == fixture.a.m_sent.size());
+    expect(that % 0x03 == fixture.a.m_sent[0].payload[0]);
+    expect(iso_tp_session::status::complete == sender.transmit_status());
+    expect(iso_tp_session::status::complete == receiver.receive_status());
+    expect(std::ranges::equal(message, receiver.received()));
+  };
+
+  "iso_tp multi frame with block size"_test = []() {
+    // Setup
+    test_fixture fixture;
+    std::array<hal::byte, 256> receive_buffer{};
+    iso_tp_session sender({ .transmit_id = 0x700, .receive_id = 0x701 }, {});
+    iso_tp_session receiver(
+      { .transmit_id = 0x701, .receive_id = 0x700, .block_size = 4 },
+      receive_buffer);
+    int handler_calls = 0;
+    receiver.on_receive(
+      [&handler_calls](iso_tp_session&, std::span<hal::byte const>) {
+        handler_calls++;
+      });
+    expect(std::errc{} == fixture.engine_a.add(sender));
+    expect(std::errc{} == fixture.engine_b.add(receiver));
+    auto const message = make_message(200);
+
+    // Exercise
+    expect(std::errc{} == fixture.engine_a.send(sender, message));
+    run_bus(fixture.a, fixture.b);
+
+    // Verify
+    // 1 first frame with 6 bytes, then 194 bytes over 28 consecutive frames
+    expect(that % 29U == fixture.a.m_sent.size());
+    // 1 flow control after the first frame and 1 after each full block
+    expect(that % 7U == fixture.b.m_sent.size());
+    expect(that % 1 == handler_calls);
+    expect(iso_tp_session::status::complete == sender.transmit_status());
+    expect(std::ranges::equal(message, receiver.received()));
+    for (std::size_t i = 1; i < fixture.a.m_sent.size(); i++) {
+      auto const expected_sequence = i & 0xFU;
+      expect(that % (0x20U | expected_sequence) ==
+             fixture.a.m_sent[i].payload[0]);
+    }
+  };
+
+  "iso_tp escape sequence length for large messages"_test = []() {
+    // Setup
+    test_fixture fixture;
+    std::vector<hal::byte> receive_buffer(5000);
+    iso_tp_session sender({ .transmit_id = 0x10, .receive_id = 0x11 }, {});
+    iso_tp_session receiver({ .transmit_id = 0x11, .receive_id = 0x10 },
+                            receive_buffer);
+    expect(std::errc{} == fixture.engine_a.add(sender));
+    expect(std::errc{} == fixture.engine_b.add(receiver));
+    auto const message = make_message(5000);
+
+    // Exercise
+    expect(std::errc{} == fixture.engine_a.send(sender, message));
+    run_bus(fixture.a, fixture.b);
+
+    // Verify
+    auto const& first_frame = fixture.a.m_sent[0].payload;
+    expect(that % 0x10 == first_frame[0]);
+    expect(that % 0x00 == first_frame[1]);
+    expect(that % 0x13 == first_frame[4]);
+    expect(that % 0x88 == first_frame[5]);
+    expect(iso_tp_session::status::complete == receiver.receive_status());
+    expect(std::ranges::equal(message, receiver.received()));
+  };
+
+  "iso_tp overflow is reported to the sender"_test = []() {
+    // Setup
+    test_fixture fixture;
+    std::array<hal::byte, 32> receive_buffer{};
+    iso_tp_session sender({ .transmit_id = 0x20, .receive_id = 0x21 }, {});
+    iso_tp_session receiver({ .transmit_id = 0x21, .receive_id = 0x20 },
+                            receive_buffer);
+    expect(std::errc{} == fixture.engine_a.add(sender));
+    expect(std::errc{} == fixture.engine_b.add(receiver));
+    auto const message = make_message(64);
+
+    // Exercise
+    expect(std::errc{} == fixture.engine_a.send(sender, message));
+    run_bus(fixture.a, fixture.b);
+
+    // Verify
+    expect(that % 1U == fixture.a.m_sent.size());
+    expect(that % 0x32 == fixture.b.m_sent[0].payload[0]);
+    expect(iso_tp_session::status::overflow == sender.transmit_status());
+    expect(iso_tp_session::status::overflow == receiver.receive_status());
+  };
+
+  "iso_tp separation time paces consecutive frames"_test = []() {
+    // Setup
+    test_fixture fixture;
+    std::array<hal::byte, 64> receive_buffer{};
+    iso_tp_session sender({ .transmit_id = 0x30, .receive_id = 0x31 }, {});
+    iso_tp_session receiver(
+      { .transmit_id = 0x31, .receive_id = 0x30, .separation_time = 5 },
+      receive_buffer);
+    expect(std::errc{} == fixture.engine_a.add(sender));
+    expect(std::errc{} == fixture.engine_b.add(receiver));
+    auto const message = make_message(20);
+
+    // Exercise
+    expect(std::errc{} == fixture.engine_a.send(sender, message));
+    run_bus(fixture.a, fixture.b);
+    auto const sent_before_delay = fixture.a.m_sent.size();
+    fixture.clock.m_ticks += 4'999;
+    fixture.engine_a.poll();
+    auto const sent_early = fixture.a.m_sent.size();
+    fixture.clock.m_ticks += 1;
+    fixture.engine_a.poll();
+    run_bus(fixture.a, fixture.b);
+
+    // Verify
+    // First frame and the first consecutive frame go out right away
+    expect(that % 2U == sent_before_delay);
+    expect(that % 2U == sent_early);
+    expect(that % 3U == fixture.a.m_sent.size());
+    expect(iso_tp_session::status::complete == receiver.receive_status());
+    expect(std::ranges::equal(message, receiver.received()));
+  };
+
+  "iso_tp concurrent sessions"_test = []() {
+    // Setup
+    test_fixture fixture;
+    std::array<hal::byte, 128> buffer1{};
+    std::array<hal::byte, 128> buffer2{};
+    iso_tp_session sender1({ .transmit_id = 0x40, .receive_id = 0x41 }, {});
+    iso_tp_session sender2({ .transmit_id = 0x50, .receive_id = 0x51 }, {});
+    iso_tp_session receiver1({ .transmit_id = 0x41, .receive_id = 0x40 },
+                             buffer1);
+    iso_tp_session receiver2({ .transmit_id = 0x51, .receive_id = 0x50 },
+                             buffer2);
+    expect(std::errc{} == fixture.engine_a.add(sender1));
+    expect(std::errc{} == fixture.engine_a.add(sender2));
+    expect(std::errc{} == fixture.engine_b.add(receiver1));
+    expect(std::errc{} == fixture.engine_b.add(receiver2));
+    auto const message1 = make_message(100);
+    auto message2 = make_message(77);
+    std::ranges::reverse(message2);
+
+    // Exercise
+    expect(std::errc{} == fixture.engine_a.send(sender1, message1));
+    expect(std::errc{} == fixture.engine_a.send(sender2, message2));
+    run_bus(fixture.a, fixture.b);
+
+    // Verify
+    expect(std::ranges::equal(message1, receiver1.received()));
+    expect(std::ranges::equal(message2, receiver2.received()));
+  };
+
+  "iso_tp session management and timeouts"_test = []() {
+    // Setup
+    test_fixture fixture;
+    iso_tp_session sender({ .transmit_id = 0x60, .receive_id = 0x61 }, {});
+    iso_tp_session duplicate({ .transmit_id = 0x62, .receive_id = 0x61 }, {});
+    auto const message = make_message(30);
+
+    // Exercise
+    auto const add_status = fixture.engine_a.add(sender);
+    auto const duplicate_status = fixture.engine_a.add(duplicate);
+    auto const send_status = fixture.engine_a.send(sender, message);
+    auto const busy_status = fixture.engine_a.send(sender, message);
+    fixture.clock.m_ticks += iso_tp::timeout_ms * 1000 + 1;
+    fixture.engine_a.poll();
+
+    // Verify
+    expect(std::errc{} == add_status);
+    expect(std::errc::address_in_use == duplicate_status);
+    expect(std::errc{} == send_status);
+    expect(std::errc::device_or_resource_busy == busy_status);
+    expect(iso_tp_session::status::timeout == sender.transmit_status());
+  };
+}
+}  // namespace hal::stm32f1
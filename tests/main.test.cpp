@@ -14,11 +14,39 @@
 
 namespace hal::stm32f1 {
 extern void output_pin_test();
+extern void uart_test();
+extern void uart_framing_test();
+extern void modbus_test();
+extern void io_multiplexer_test();
+extern void one_wire_test();
+extern void uart_receive_timeout_test();
+extern void matrix_scanner_test();
 extern void can_test();
+extern void async_test();
+extern void iso_tp_test();
+extern void can_statistics_test();
+extern void can_dispatch_test();
+extern void can_schedule_test();
+extern void can_autobaud_test();
+extern void can_bit_timing_test();
 }  // namespace hal::stm32f1
 
 int main()
 {
   hal::stm32f1::output_pin_test();
+  hal::stm32f1::uart_test();
+  hal::stm32f1::uart_framing_test();
+  hal::stm32f1::modbus_test();
+  hal::stm32f1::io_multiplexer_test();
+  hal::stm32f1::one_wire_test();
+  hal::stm32f1::uart_receive_timeout_test();
+  hal::stm32f1::matrix_scanner_test();
   hal::stm32f1::can_test();
+  hal::stm32f1::async_test();
+  hal::stm32f1::iso_tp_test();
+  hal::stm32f1::can_statistics_test();
+  hal::stm32f1::can_dispatch_test();
+  hal::stm32f1::can_schedule_test();
+  hal::stm32f1::can_autobaud_test();
+  hal::stm32f1::can_bit_timing_test();
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <libhal-stm32f1/matrix_scanner.hpp>
+#include <libhal-stm32f1/uart.hpp>
+#include <libhal-stm32f1/uart_receive_timeout.hpp>
+
+#include <array>
+#include <cstdint>
+#include <system_error>
+
+#include <boost/ut.hpp>
+
+#include "dma.hpp"
+#include "helper.hpp"
+#include "matrix_scanner.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "timer_reg.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+std::uint32_t address_of(void const volatile* p_pointer)
+{
+  return static_cast<std::uint32_t>(reinterpret_cast<std::intptr_t>(p_pointer));
+}
+}  // namespace
+
+void matrix_scanner_test()
+{
+  using namespace boost::ut;
+
+  "matrix_row_pattern selects one row and sets its LEDs"_test = []() {
+    // Exercise
+    auto const row_only = matrix_row_pattern(2, 8, 0b101, 0, false);
+    auto const with_leds = matrix_row_pattern(2, 8, 0b101, 0, true);
+
+    // Verify
+    // Pin 10 reset, pins 8, 9 and 11 to 15 set
+    expect(that % 0x0400'FB00U == row_only);
+    // And pins 0 and 2 set, pins 1 and 3 to 7 reset
+    expect(that % 0x04FA'FB05U == with_leds);
+  };
+
+  "matrix_frame_keys reports the columns read low"_test = []() {
+    // Setup
+    std::array<std::uint16_t, 8> samples{};
+    samples.fill(0xFFFF);
+    // Column 5 on pin 9 while row 3 is selected
+    samples[3] = static_cast<std::uint16_t>(~(1U << 9U));
+
+    // Exercise
+    auto const keys = matrix_frame_keys(samples, 4);
+
+    // Verify
+    expect(that % (std::uint64_t{ 1 } << (3U * 8U + 5U)) == keys);
+  };
+
+  "matrix_debounce changes a key after consecutive frames"_test = []() {
+    // Setup
+    constexpr std::uint64_t key = std::uint64_t{ 1 } << 29U;
+    std::uint64_t keys = 0;
+    std::uint64_t counting = 0;
+    std::array<std::uint8_t, 64> counts{};
+    auto const frame = [&](std::uint64_t p_raw) {
+      return matrix_debounce(p_raw, keys, counting, counts, 3);
+    };
+
+    // Exercise
+    // A bounce of two frames, then held
+    auto const bounce1 = frame(key);
+    auto const bounce2 = frame(key);
+    auto const open = frame(0);
+    auto const held1 = frame(key);
+    auto const held2 = frame(key);
+    auto const pressed = frame(key);
+    auto const keys_pressed = keys;
+    auto const still = frame(key);
+    frame(0);
+    frame(0);
+    auto const released = frame(0);
+
+    // Verify
+    expect(that % 0U == bounce1);
+    expect(that % 0U == bounce2);
+    expect(that % 0U == open);
+    expect(that % 0U == held1);
+    expect(that % 0U == held2);
+    expect(that % key == pressed);
+    expect(that % key == keys_pressed);
+    expect(that % 0U == still);
+    expect(that % key == released);
+    expect(that % 0U == keys);
+    expect(that % 0U == counting);
+  };
+
+  "matrix_scanner paces both DMA channels with the timer"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers gpio_b_stub(&gpio_b_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers timer_stub(&timer4_reg);
+    matrix_scanner scanner;
+    int presses = 0;
+    std::uint64_t reported = 0;
+    // timer4 requests DMA1 channel 7 on update and 1 on capture/compare 1
+    auto const& pattern_channel = dma::dma1->channel[7 - 1];
+    auto const& sample_channel = dma::dma1->channel[1 - 1];
+
+    // Exercise
+    auto const status = scanner.try_start(
+      { .debounce_frames = 2, .timer = peripheral::timer4 },
+      [&](matrix_key_event p_event) {
+        presses += p_event.pressed ? 1 : 0;
+        reported |= std::uint64_t{ 1 } << (p_event.row * 8U + p_event.column);
+      });
+    auto const dma_requests = timer4_reg->DIER;
+    auto const compare = timer4_reg->CCR[0];
+    // The stubbed sample buffer reads every key pressed
+    scanner.frame_complete(0);
+    auto const after_one_frame = presses;
+    scanner.frame_complete(1);
+    auto const keys = scanner.keys();
+    scanner.stop();
+
+    // Verify
+    expect(that % std::errc{} == status);
+    expect(that % address_of(&gpio_b_reg->bsrr) ==
+           pattern_channel.peripheral_address);
+    expect(that % address_of(&gpio_a_reg->idr) ==
+           sample_channel.peripheral_address);
+    expect(that % 8U == pattern_channel.transfer_amount);
+    expect(that % 16U == sample_channel.transfer_amount);
+    expect(that % bit_value(0U)
+                    .set<timer_interrupt_enable::update_dma>()
+                    .set<timer_interrupt_enable::capture_compare1_dma>()
+                    .get() == dma_requests);
+    expect(that % (timer4_reg->ARR + 1U) / 2U == compare);
+    expect(that % 0 == after_one_frame);
+    expect(that % 64 == presses);
+    expect(that % ~std::uint64_t{ 0 } == reported);
+    expect(that % ~std::uint64_t{ 0 } == keys);
+    expect(that % 0U == pattern_channel.configuration);
+    // Every row released
+    expect(that % 0xFF00U == gpio_b_reg->bsrr);
+  };
+
+  "matrix_scanner claims its timer and DMA channels"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers gpio_b_stub(&gpio_b_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart3);
+    stub_out_registers timer2_stub(&timer2_reg);
+    stub_out_registers timer3_stub(&timer3_reg);
+    stub_out_registers timer4_stub(&timer4_reg);
+    matrix_scanner scanner;
+    uart_receive_timeout timeout;
+    // timer2 requests DMA1 channel 2 on update and 1 on capture/compare 3
+    auto const& pattern_channel = dma::dma1->channel[2 - 1];
+    auto const& sample_channel = dma::dma1->channel[1 - 1];
+
+    // Exercise
+    (void)timeout.try_start({}, {});
+    auto const timer_in_use =
+      scanner.try_start({ .timer = peripheral::timer4 }, {});
+    bit_modify(timer3_reg->CR1).set<timer_control::counter_enable>();
+    auto const timer_running =
+      scanner.try_start({ .timer = peripheral::timer3 }, {});
+    timer3_reg->CR1 = 0;
+    std::errc channel_in_use{};
+    {
+      // usart3 transmits on DMA1 channel 2
+      std::array<hal::byte, 16> buffer{};
+      uart driver(hal::runtime{}, 3, buffer);
+      channel_in_use = scanner.try_start({}, {});
+    }
+    auto const started = scanner.try_start({}, {});
+    auto const dma_requests = timer2_reg->DIER;
+    auto const compare = timer2_reg->CCR[3 - 1];
+    auto const pattern_address = pattern_channel.peripheral_address;
+    auto const sample_address = sample_channel.peripheral_address;
+    scanner.stop();
+    timeout.stop();
+
+    // Verify
+    expect(that % std::errc::device_or_resource_busy == timer_in_use);
+    expect(that % std::errc::device_or_resource_busy == timer_running);
+    expect(that % std::errc::device_or_resource_busy == channel_in_use);
+    expect(that % std::errc{} == started);
+    expect(that % address_of(&gpio_b_reg->bsrr) == pattern_address);
+    expect(that % address_of(&gpio_a_reg->idr) == sample_address);
+    expect(that % bit_value(0U)
+                    .set<timer_interrupt_enable::update_dma>()
+                    .set(bit_mask::from<11>())
+                    .get() == dma_requests);
+    expect(that % (timer2_reg->ARR + 1U) / 2U == compare);
+  };
+
+  "matrix_scanner rejects overlapping pins and busy timers"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers gpio_b_stub(&gpio_b_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers timer_stub(&timer3_reg);
+    matrix_scanner first;
+    matrix_scanner second;
+
+    // Exercise
+    auto const leds_on_rows = second.try_start(
+      { .first_row_pin = 8, .drive_leds = true, .first_led_pin = 4 }, {});
+    auto const columns_on_rows = second.try_start(
+      { .row_port = 'A', .first_row_pin = 4, .column_port = 'A' }, {});
+    auto const advanced_timer =
+      second.try_start({ .timer = peripheral::timer1 }, {});
+    auto const started = first.try_start({ .timer = peripheral::timer3 }, {});
+    auto const busy = second.try_start({ .timer = peripheral::timer3 }, {});
+
+    // Verify
+    expect(that % std::errc::argument_out_of_domain == leds_on_rows);
+    expect(that % std::errc::argument_out_of_domain == columns_on_rows);
+    expect(that % std::errc::argument_out_of_domain == advanced_timer);
+    expect(that % std::errc{} == started);
+    expect(that % std::errc::device_or_resource_busy == busy);
+  };
+}
+}  // namespace hal::stm32f1
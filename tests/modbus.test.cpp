@@ -0,0 +1,244 @@
+#include <libhal-stm32f1/modbus.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "dma.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "timer_reg.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+std::uint16_t speed = 0;
+std::uint16_t setpoint = 0;
+std::uint16_t limit = 0;
+std::uint16_t temperature = 0;
+
+constexpr modbus_register_map holding_map{ std::array{
+  modbus_register{ .address = 0x11, .value = &limit, .writable = true },
+  modbus_register{ .address = 0x00, .value = &speed },
+  modbus_register{ .address = 0x10, .value = &setpoint, .writable = true },
+} };
+
+constexpr modbus_register_map input_map{ std::array{
+  modbus_register{ .address = 0x30, .value = &temperature },
+} };
+
+/// Append the CRC to a request
+std::vector<hal::byte> request(std::vector<hal::byte> p_frame)
+{
+  auto const crc = crc16_modbus(p_frame);
+  p_frame.push_back(static_cast<hal::byte>(crc));
+  p_frame.push_back(static_cast<hal::byte>(crc >> 8U));
+  return p_frame;
+}
+
+/// Hand a request to the server split in two, as if it wrapped around the
+/// receive buffer
+std::vector<hal::byte> respond(modbus_rtu_server& p_server,
+                               std::span<hal::byte const> p_request)
+{
+  auto const split = p_request.size() / 2;
+  auto const response =
+    p_server.handle({ p_request.first(split), p_request.subspan(split) });
+  return { response.begin(), response.end() };
+}
+}  // namespace
+
+void modbus_test()
+{
+  using namespace boost::ut;
+
+  "crc16_modbus matches the check value"_test = []() {
+    // Setup
+    constexpr std::array<hal::byte, 9> digits{ '1', '2', '3', '4', '5',
+                                               '6', '7', '8', '9' };
+
+    // Exercise + Verify
+    expect(that % 0x4B37 == crc16_modbus(digits));
+  };
+
+  "modbus_register_table finds consecutive runs only"_test = []() {
+    // Setup
+    modbus_register_table const table(holding_map);
+
+    // Exercise
+    auto const pair = table.find(0x10, 2);
+    auto const gap = table.find(0x00, 2);
+    auto const missing = table.find(0x05, 1);
+    auto const past_end = table.find(0x11, 2);
+
+    // Verify
+    expect(that % 0x00 == holding_map.registers[0].address);
+    expect(that % 0x11 == holding_map.registers[2].address);
+    expect(that % 2U == pair.size());
+    expect(that % 0x10 == pair[0].address);
+    expect(gap.empty());
+    expect(missing.empty());
+    expect(past_end.empty());
+  };
+
+  "modbus_rtu_server reads and writes registers"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 256> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    modbus_rtu_server server(driver, holding_map, input_map);
+    speed = 0x1234;
+    temperature = 0x00FA;
+
+    // Exercise
+    auto const read_holding =
+      respond(server, request({ 0x01, 0x03, 0x00, 0x00, 0x00, 0x01 }));
+    auto const read_input =
+      respond(server, request({ 0x01, 0x04, 0x00, 0x30, 0x00, 0x01 }));
+    auto const write_single =
+      respond(server, request({ 0x01, 0x06, 0x00, 0x10, 0xAB, 0xCD }));
+    auto const write_multiple = respond(
+      server,
+      request({ 0x01, 0x10, 0x00, 0x10, 0x00, 0x02, 0x04, 0x00, 0x01, 0x00,
+                0x02 }));
+    auto const broadcast =
+      respond(server, request({ 0x00, 0x06, 0x00, 0x11, 0x00, 0x07 }));
+    auto const other_server =
+      respond(server, request({ 0x02, 0x06, 0x00, 0x11, 0x00, 0x08 }));
+
+    // Verify
+    expect(read_holding == request({ 0x01, 0x03, 0x02, 0x12, 0x34 }));
+    expect(read_input == request({ 0x01, 0x04, 0x02, 0x00, 0xFA }));
+    expect(write_single == request({ 0x01, 0x06, 0x00, 0x10, 0xAB, 0xCD }));
+    expect(write_multiple == request({ 0x01, 0x10, 0x00, 0x10, 0x00, 0x02 }));
+    expect(that % 0x0001 == setpoint);
+    expect(broadcast.empty());
+    expect(other_server.empty());
+    expect(that % 0x0007 == limit);
+    expect(that % 5U == server.counters().requests);
+    expect(that % 0U == server.counters().exceptions);
+  };
+
+  "modbus_rtu_server rejects bad requests"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 256> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    modbus_rtu_server server(driver, holding_map, input_map);
+    speed = 0x1111;
+    setpoint = 0x2222;
+    auto corrupt = request({ 0x01, 0x03, 0x00, 0x00, 0x00, 0x01 });
+    corrupt[3] ^= 0x01;
+
+    // Exercise
+    auto const unknown_function =
+      respond(server, request({ 0x01, 0x2B, 0x0E, 0x01, 0x00 }));
+    auto const unknown_address =
+      respond(server, request({ 0x01, 0x03, 0x00, 0x05, 0x00, 0x01 }));
+    auto const too_many =
+      respond(server, request({ 0x01, 0x03, 0x00, 0x00, 0x00, 0x7E }));
+    // The run includes the read only register 0x00
+    auto const read_only = respond(
+      server,
+      request({ 0x01, 0x10, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x09 }));
+    auto const crc_error = respond(server, corrupt);
+    auto const runt = respond(server, std::array<hal::byte, 3>{ 1, 3, 0 });
+    // Valid CRC but too short for the fields of the function
+    auto const short_read_holding = respond(server, request({ 0x01, 0x03 }));
+    auto const short_read_input =
+      respond(server, request({ 0x01, 0x04, 0x00, 0x30 }));
+    auto const short_write_single =
+      respond(server, request({ 0x01, 0x06, 0x00, 0x10, 0xAB }));
+    auto const short_write_multiple = respond(server, request({ 0x01, 0x10 }));
+
+    // Verify
+    expect(unknown_function == request({ 0x01, 0xAB, 0x01 }));
+    expect(unknown_address == request({ 0x01, 0x83, 0x02 }));
+    expect(too_many == request({ 0x01, 0x83, 0x03 }));
+    expect(read_only == request({ 0x01, 0x90, 0x02 }));
+    expect(that % 0x1111 == speed);
+    expect(that % 0x2222 == setpoint);
+    expect(crc_error.empty());
+    expect(runt.empty());
+    expect(short_read_holding == request({ 0x01, 0x83, 0x03 }));
+    expect(short_read_input == request({ 0x01, 0x84, 0x03 }));
+    expect(short_write_single == request({ 0x01, 0x86, 0x03 }));
+    expect(short_write_multiple == request({ 0x01, 0x90, 0x03 }));
+    expect(that % 0x2222 == setpoint);
+    expect(that % 8U == server.counters().exceptions);
+    expect(that % 1U == server.counters().crc_errors);
+    expect(that % 1U == server.counters().framing_errors);
+  };
+
+  "modbus_rtu_server answers once t3.5 has passed"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    stub_out_registers timer_stub(&timer3_reg);
+    std::array<hal::byte, 256> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    modbus_rtu_server server(driver, holding_map, input_map);
+    modbus_rtu_server second(driver, holding_map, input_map);
+    speed = 0x0042;
+    auto const frame = request({ 0x01, 0x03, 0x00, 0x00, 0x00, 0x01 });
+    // USART1 RX uses DMA1 channel 5 and TX channel 4
+    auto& rx_channel = dma::dma1->channel[5 - 1];
+    auto& tx_channel = dma::dma1->channel[4 - 1];
+    auto const receive = [&](std::size_t p_first, std::size_t p_count) {
+      std::copy_n(frame.begin() + p_first, p_count, buffer.begin() + p_first);
+      rx_channel.transfer_amount =
+        static_cast<std::uint32_t>(buffer.size() - (p_first + p_count));
+    };
+    rx_channel.transfer_amount = buffer.size();
+
+    // Exercise
+    auto const started = server.try_start({ .address = 1 });
+    auto const busy = second.try_start({ .address = 1 });
+    // The first half of the frame, then a pause of less than t1.5
+    receive(0, 4);
+    server.receive_idle();
+    receive(4, 2);
+    server.gap_elapsed(true);
+    server.gap_elapsed(false);
+    auto const continued = tx_channel.transfer_amount;
+    receive(6, frame.size() - 6);
+    server.receive_idle();
+    server.gap_elapsed(true);
+    server.gap_elapsed(false);
+    auto const answered = tx_channel.transfer_amount;
+    auto const one_shot = timer3_reg->CR1;
+
+    // Verify
+    expect(std::errc{} == started);
+    expect(std::errc::device_or_resource_busy == busy);
+    expect(that % 0U == continued);
+    expect(that % 7U == answered);
+    expect(that % 1U == server.counters().requests);
+    expect(that % 0U == server.counters().framing_errors);
+    expect(driver.receive_view()[0].empty());
+    expect(that % 0U != (one_shot & bit_value(0U)
+                                      .set<timer_control::one_pulse_mode>()
+                                      .get()));
+    expect(that % 0U != timer3_reg->CCR[0]);
+    expect(timer3_reg->CCR[0] < timer3_reg->ARR);
+  };
+}
+}  // namespace hal::stm32f1
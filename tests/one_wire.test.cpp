@@ -0,0 +1,155 @@
+#include <libhal-stm32f1/one_wire.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "dma.hpp"
+#include "helper.hpp"
+#include "one_wire.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// ROM code with the given family and serial number and a valid CRC
+one_wire::rom_code make_rom(hal::byte p_family, std::uint64_t p_serial)
+{
+  one_wire::rom_code rom{ p_family };
+  for (std::size_t i = 1; i < 7; i++) {
+    rom[i] = static_cast<hal::byte>(p_serial >> ((i - 1) * 8));
+  }
+  rom[7] = crc8_maxim(std::span(rom).first(7));
+  return rom;
+}
+
+bool rom_bit(one_wire::rom_code const& p_rom, std::size_t p_bit)
+{
+  return (p_rom[p_bit / 8] >> (p_bit % 8)) & 1U;
+}
+
+/// Run the search against simulated devices, which answer with the wired AND
+/// of their bits and leave once the master writes the other value
+std::vector<one_wire::rom_code> search_devices(
+  std::vector<one_wire::rom_code> const& p_devices)
+{
+  one_wire_rom_search state;
+  std::vector<one_wire::rom_code> found;
+
+  do {
+    state.begin_pass();
+    std::vector<bool> active(p_devices.size(), true);
+    for (std::size_t bit = 0; bit < 64; bit++) {
+      bool id_bit = true;
+      bool complement_bit = true;
+      for (std::size_t i = 0; i < p_devices.size(); i++) {
+        if (active[i]) {
+          id_bit = id_bit && rom_bit(p_devices[i], bit);
+          complement_bit = complement_bit && not rom_bit(p_devices[i], bit);
+        }
+      }
+      auto const direction = state.next_direction(bit, id_bit, complement_bit);
+      if (not direction) {
+        return found;
+      }
+      for (std::size_t i = 0; i < p_devices.size(); i++) {
+        active[i] = active[i] && rom_bit(p_devices[i], bit) == *direction;
+      }
+    }
+    found.push_back(state.rom());
+  } while (state.end_pass());
+
+  return found;
+}
+}  // namespace
+
+void one_wire_test()
+{
+  using namespace boost::ut;
+
+  "crc8_maxim matches the check value"_test = []() {
+    // Setup
+    constexpr std::array<hal::byte, 9> digits{ '1', '2', '3', '4', '5',
+                                               '6', '7', '8', '9' };
+
+    // Exercise + Verify
+    expect(that % 0xA1 == crc8_maxim(digits));
+    expect(that % 0 == crc8_maxim(make_rom(0x28, 0x1234'5678'9ABC)));
+  };
+
+  "one_wire slots carry each byte least significant bit first"_test = []() {
+    // Setup
+    constexpr std::array<hal::byte, 2> bytes{ 0xCC, 0x01 };
+    std::array<hal::byte, 16> slots{};
+    std::array<hal::byte, 2> decoded{};
+
+    // Exercise
+    one_wire_encode_slots(bytes, slots);
+    // A device pulling the bus low in the middle of a slot
+    auto echo = slots;
+    echo[8] = 0xF8;
+    one_wire_decode_slots(slots, decoded);
+    auto const clean = decoded;
+    one_wire_decode_slots(echo, decoded);
+
+    // Verify
+    expect(that % 0x00 == slots[0]);
+    expect(that % 0x00 == slots[1]);
+    expect(that % 0xFF == slots[2]);
+    expect(that % 0xFF == slots[8]);
+    expect(bytes == clean);
+    expect(that % 0x00 == decoded[1]);
+  };
+
+  "one_wire_rom_search finds every device once"_test = []() {
+    // Setup
+    std::vector<one_wire::rom_code> const devices{
+      make_rom(0x28, 0x0000'0000'0001), make_rom(0x28, 0x0000'0000'0003),
+      make_rom(0x28, 0x8000'0000'0001), make_rom(0x10, 0x0000'0000'0001),
+      make_rom(0x28, 0x4242'4242'4242),
+    };
+
+    // Exercise
+    auto const found = search_devices(devices);
+    auto const single = search_devices({ devices[2] });
+    auto const none = search_devices({});
+
+    // Verify
+    expect(that % devices.size() == found.size());
+    for (auto const& device : devices) {
+      expect(that % 1 == std::count(found.begin(), found.end(), device));
+    }
+    expect(that % 1U == single.size());
+    expect(single.front() == devices[2]);
+    expect(none.empty());
+  };
+
+  "one_wire puts the usart into half-duplex mode"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+
+    // Exercise
+    one_wire bus(hal::runtime{}, 1);
+    auto const control3 = usart1->control3;
+    // PA9 is in the upper configuration register, 4 bits per pin
+    auto const tx_config = (gpio_a_reg->crh >> ((9U - 8U) * 4U)) & 0xFU;
+
+    // Verify
+    expect(that % 0U != (control3 & bit_value(0U)
+                                      .set<control_reg::half_duplex_selection>()
+                                      .get()));
+    // Open drain alternate function output, 50 MHz
+    expect(that % 0b1111U == tx_config);
+  };
+}
+}  // namespace hal::stm32f1
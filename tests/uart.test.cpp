@@ -1 +1,477 @@
 #include <libhal-stm32f1/uart.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+#include <boost/ut.hpp>
+#include <libhal/steady_clock.hpp>
+
+#include "dma.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "timer_reg.hpp"
+#include "uart.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Clock that also plays the part of timer1 capturing the falling edges of a
+/// 0x55 sync byte on channel 3. Each edge is reported for exactly one read of
+/// the uptime, as reading the capture register would clear the flag.
+class simulated_capture_clock : public hal::steady_clock
+{
+public:
+  std::array<std::uint32_t, 5> m_edges{};
+  std::size_t m_next = 0;
+  std::uint64_t m_ticks = 0;
+  /// Timer counts per tick of the clock, the counter is left alone if 0
+  std::uint32_t m_counts_per_tick = 0;
+
+private:
+  hal::hertz driver_frequency() override
+  {
+    return 1'000'000.0f;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    constexpr auto channel3_captured = 1UL << 3U;
+    m_ticks++;
+    if (m_counts_per_tick != 0) {
+      timer1_reg->CNT = (m_ticks * m_counts_per_tick) & 0xFFFFU;
+    }
+    timer1_reg->SR = timer1_reg->SR & ~channel3_captured;
+    if (m_next < m_edges.size() && m_ticks >= (m_next + 1U) * 10U) {
+      timer1_reg->CCR[2] = m_edges[m_next++];
+      timer1_reg->SR = timer1_reg->SR | channel3_captured;
+    }
+    return m_ticks;
+  }
+};
+}  // namespace
+
+void uart_test()
+{
+  using namespace boost::ut;
+
+  "uart_pin_map covers each port and remap"_test = []() {
+    // Exercise
+    auto const usart2 = uart_pin_map(2, uart_pins::standard);
+    auto const usart3 = uart_pin_map(3, uart_pins::full_remap);
+    auto const usart1_full = uart_pin_map(1, uart_pins::full_remap);
+    auto const usart4 = uart_pin_map(4, uart_pins::standard);
+
+    // Verify
+    expect(usart2.has_value());
+    expect(that % 'A' == usart2->tx.port);
+    expect(that % 2 == usart2->tx.pin);
+    expect(that % 3 == usart2->rx.pin);
+    expect(that % 0 == usart2->cts.pin);
+    expect(that % 1 == usart2->rts.pin);
+    expect(usart3.has_value());
+    expect(that % 'D' == usart3->tx.port);
+    expect(that % 8 == usart3->tx.pin);
+    expect(that % 12 == usart3->rts.pin);
+    expect(not usart1_full.has_value());
+    expect(not usart4.has_value());
+  };
+
+  "uart_ready_to_receive applies hysteresis around the mark"_test = []() {
+    // Exercise + Verify
+    expect(uart_ready_to_receive(0, 96, true));
+    expect(uart_ready_to_receive(95, 96, true));
+    expect(not uart_ready_to_receive(96, 96, true));
+    expect(not uart_ready_to_receive(49, 96, false));
+    expect(uart_ready_to_receive(48, 96, false));
+  };
+
+  "uart with flow control drives RTS from the fill level"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 256> buffer{};
+    constexpr auto rts_high = 1UL << 12U;
+    constexpr auto rts_low = rts_high << 16U;
+    // USART1 RX uses DMA1 channel 5
+    auto& channel = dma::dma1->channel[5 - 1];
+
+    // Exercise
+    uart driver(hal::runtime{},
+                1,
+                buffer,
+                {},
+                { .flow_control = uart_flow_control::rts_cts,
+                  .high_water_mark = 64 });
+    auto const initial = gpio_a_reg->bsrr;
+    auto const cts = usart1->control3;
+    // The DMA is found to be 100 bytes ahead of the reader
+    channel.transfer_amount = buffer.size() - 100;
+    std::array<hal::byte, 1> one{};
+    (void)driver.read(one);
+    auto const above_mark = gpio_a_reg->bsrr;
+    std::array<hal::byte, 70> many{};
+    (void)driver.read(many);
+    auto const drained = gpio_a_reg->bsrr;
+
+    // Verify
+    expect(that % rts_low == initial);
+    expect(that % 0U !=
+           (cts & bit_value(0U).set<control_reg::cts_enable>().get()));
+    expect(that % rts_high == above_mark);
+    expect(that % rts_low == drained);
+  };
+
+  "uart caps the high water mark at 3/8 of the buffer"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 256> buffer{};
+    constexpr auto rts_high = 1UL << 12U;
+    // USART1 RX uses DMA1 channel 5
+    auto& channel = dma::dma1->channel[5 - 1];
+    uart driver(hal::runtime{},
+                1,
+                buffer,
+                {},
+                { .flow_control = uart_flow_control::rts_cts,
+                  .high_water_mark = 200 });
+
+    // Exercise
+    // 100 bytes are past the 96 byte cap but short of half the buffer
+    channel.transfer_amount = buffer.size() - 101;
+    std::array<hal::byte, 1> one{};
+    (void)driver.read(one);
+
+    // Verify
+    expect(that % rts_high == gpio_a_reg->bsrr);
+  };
+
+  "uart_receive_segment_size splits large buffers evenly"_test = []() {
+    // Exercise + Verify
+    expect(that % 4'096U == uart_receive_segment_size(4'096));
+    expect(that % 65'535U == uart_receive_segment_size(65'535));
+    expect(that % 32'768U == uart_receive_segment_size(65'536));
+    expect(that % 60'000U == uart_receive_segment_size(300'000));
+    expect(that % 65'534U == uart_receive_segment_size(327'670));
+  };
+
+  "segmented receive buffer reads as one ring"_test = []() {
+    // Setup
+    stub_out_registers dma_stub(&dma::dma1);
+    std::vector<hal::byte> buffer(150'001);
+    uart_receive_ring_t ring{
+      .buffer = buffer,
+      .segment_size = uart_receive_segment_size(buffer.size()),
+      .segment = 0,
+      .dma = 5,
+    };
+    auto& channel = dma::dma1->channel[5 - 1];
+    channel.transfer_amount = 50'001;
+
+    // Exercise
+    auto const start = uart_receive_cursor(ring);
+    channel.transfer_amount = 1;
+    auto const within = uart_receive_cursor(ring);
+    // The DMA has filled the segment, its interrupt is still pending
+    channel.transfer_amount = 0;
+    auto const filled = uart_receive_cursor(ring);
+    uart_arm_next_segment(ring);
+    auto const second_length = channel.transfer_amount;
+    auto const second = uart_receive_cursor(ring);
+    uart_arm_next_segment(ring);
+    auto const last_length = channel.transfer_amount;
+    channel.transfer_amount = 0;
+    auto const end = uart_receive_cursor(ring);
+    uart_arm_next_segment(ring);
+
+    // Verify
+    expect(that % 50'001U == ring.segment_size);
+    expect(that % 0U == start);
+    expect(that % 50'000U == within);
+    expect(that % 50'001U == filled);
+    expect(that % 50'001U == second_length);
+    expect(that % 50'001U == second);
+    expect(that % 49'999U == last_length);
+    expect(that % 0U == end);
+    expect(that % 0U == ring.segment);
+    expect(that % 50'001U == channel.transfer_amount);
+    expect(that % 0U !=
+           (channel.configuration & bit_value(0U).set<dma::enable>().get()));
+  };
+
+  "uart splits a large receive buffer into segments"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::vector<hal::byte> buffer(200'000);
+    // USART1 RX uses DMA1 channel 5
+    auto& channel = dma::dma1->channel[5 - 1];
+
+    // Exercise
+    uart driver(hal::runtime{}, 1, buffer);
+    auto const configuration = channel.configuration;
+    channel.transfer_amount = 50'000 - 16;
+    auto const view = driver.receive_view();
+
+    // Verify
+    expect(that % 50'000U == uart_receive_segment_size(buffer.size()));
+    expect(that % 0U == (configuration & bit_value(0U)
+                                           .set<dma::circular_mode>()
+                                           .get()));
+    expect(that % 0U != (configuration &
+                         bit_value(0U)
+                           .set<dma::transfer_complete_interrupt_enable>()
+                           .get()));
+    expect(that % 16U == view[0].size());
+    expect(view[1].empty());
+  };
+
+  "uart stops its DMA channels and usart when destroyed"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::vector<hal::byte> buffer(200'000);
+    // USART1 RX uses DMA1 channel 5 and TX uses channel 4
+    auto& receive_channel = dma::dma1->channel[5 - 1];
+    auto& transmit_channel = dma::dma1->channel[4 - 1];
+    std::uint32_t running_receive = 0;
+
+    // Exercise
+    {
+      uart driver(hal::runtime{}, 1, buffer);
+      running_receive = receive_channel.configuration;
+      // A transmit still in flight
+      transmit_channel.configuration =
+        bit_value(0U)
+          .set<dma::enable>()
+          .set<dma::transfer_complete_interrupt_enable>()
+          .get();
+    }
+
+    // Verify
+    expect(that % 0U != (running_receive &
+                         bit_value(0U).set<dma::enable>().get()));
+    expect(that % 0U == receive_channel.configuration);
+    expect(that % 0U == transmit_channel.configuration);
+    expect(that % 0U == usart1->control3);
+    expect(that % 0U ==
+           (usart1->control1 &
+            bit_value(0U).set<control_reg::usart_enable>().get()));
+    expect(dma::claim_channel(5) == std::errc{});
+    expect(dma::claim_channel(4) == std::errc{});
+    dma::release_channel(5);
+    dma::release_channel(4);
+  };
+
+  "uart::read copies across the end of rings of any size"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    // USART1 RX uses DMA1 channel 5
+    auto& channel = dma::dma1->channel[5 - 1];
+
+    for (std::size_t const size : { 64U, 50U }) {
+      std::vector<hal::byte> buffer(size);
+      for (std::size_t i = 0; i < size; i++) {
+        buffer[i] = static_cast<hal::byte>(i);
+      }
+      uart driver(hal::runtime{}, 1, buffer);
+      channel.transfer_amount = static_cast<std::uint32_t>(size - 40);
+      driver.consume(40);
+      // 20 bytes are waiting, from index 40 across the end to index 9
+      channel.transfer_amount = static_cast<std::uint32_t>(size - 10);
+      std::array<hal::byte, 32> data{};
+
+      // Exercise
+      auto const first = driver.read(std::span(data).first(5)).data;
+      auto const rest = driver.read(data).data;
+
+      // Verify
+      expect(that % 5U == first.size());
+      expect(that % (size - 45 + 10) == rest.size());
+      expect(that % (size - 1) == rest[size - 46]);
+      expect(that % 0U == rest[size - 45]);
+      expect(that % 9U == rest.back());
+      expect(driver.receive_view()[0].empty());
+    }
+  };
+
+  "uart parity lengthens the word to 9 bits"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 64> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    // Word length (M), parity control enable (PCE) and parity selection (PS)
+    constexpr std::uint32_t word_length = 1U << 12U;
+    constexpr std::uint32_t parity_control = 1U << 10U;
+    constexpr std::uint32_t odd_parity = 1U << 9U;
+    constexpr auto format_bits = word_length | parity_control | odd_parity;
+    serial::settings settings{};
+
+    // Exercise
+    settings.parity = serial::settings::parity::even;
+    auto const even_status = driver.try_configure(settings);
+    auto const even = usart1->control1 & format_bits;
+    settings.parity = serial::settings::parity::odd;
+    auto const odd_status = driver.try_configure(settings);
+    auto const odd = usart1->control1 & format_bits;
+    settings.parity = serial::settings::parity::none;
+    auto const none_status = driver.try_configure(settings);
+    auto const none = usart1->control1 & format_bits;
+
+    // Verify
+    expect(std::errc{} == even_status);
+    expect(std::errc{} == odd_status);
+    expect(std::errc{} == none_status);
+    // 8E1 and 8O1 are 8 data bits and a parity bit
+    expect(that % (word_length | parity_control) == even);
+    expect(that % (word_length | parity_control | odd_parity) == odd);
+    // 8N1
+    expect(that % 0U == none);
+  };
+
+  "uart_rx_capture_channel finds the timer of each RX pin"_test = []() {
+    // Exercise
+    auto const usart1 = uart_rx_capture_channel({ .port = 'A', .pin = 10 });
+    auto const usart3 = uart_rx_capture_channel({ .port = 'B', .pin = 11 });
+    auto const usart3_remap =
+      uart_rx_capture_channel({ .port = 'C', .pin = 11 });
+
+    // Verify
+    expect(usart1.has_value());
+    expect(peripheral::timer1 == usart1->timer);
+    expect(that % 3 == usart1->channel);
+    expect(usart3.has_value());
+    expect(peripheral::timer2 == usart3->timer);
+    expect(that % 4 == usart3->channel);
+    expect(that % 0b10 == usart3->timer2_remap);
+    expect(not usart3_remap.has_value());
+  };
+
+  "uart_baud_rate_register rounds to the nearest clock cycle"_test = []() {
+    // Exercise + Verify
+    expect(that % 625 ==
+           uart_baud_rate_register(72'000'000, 115'200).value_or(0));
+    expect(that % 833 ==
+           uart_baud_rate_register(8'000'000, 9'600).value_or(0));
+    // 8 bits measured over 6'667 ticks of an 8 MHz timer
+    expect(that % 833 ==
+           uart_baud_rate_register(8'000'000, 8'000'000ULL * 8, 6'667)
+             .value_or(0));
+    expect(not uart_baud_rate_register(72'000'000, 5'000'000).has_value());
+    expect(not uart_baud_rate_register(72'000'000, 1'000).has_value());
+  };
+
+  "uart::autobaud measures a sync byte and reprograms the divider"_test =
+    []() {
+      // Setup
+      stub_out_registers rcc_stub(&rcc);
+      stub_out_registers afio_stub(&alternative_function_io);
+      stub_out_registers gpio_a_stub(&gpio_a_reg);
+      stub_out_registers dma_stub(&dma::dma1);
+      stub_out_registers usart_stub(&usart1);
+      stub_out_registers timer_stub(&timer1_reg);
+      std::array<hal::byte, 64> buffer{};
+      uart driver(hal::runtime{}, 1, buffer);
+      // The line is idle high once the sync byte has passed
+      gpio_a_reg->idr = 1UL << 10U;
+      simulated_capture_clock clock;
+      // 9600 baud on an 8 MHz timer, an edge every 2 bits starting at 1000
+      clock.m_edges = { 1'000, 2'667, 4'333, 6'000, 7'667 };
+
+      // Exercise
+      auto const detected = driver.autobaud(clock);
+
+      // Verify
+      expect(detected.has_value());
+      expect(that % 9'590.0f < detected.value_or(0.0f));
+      expect(that % 9'610.0f > detected.value_or(0.0f));
+      expect(that % 833U == usart1->baud_rate);
+      expect(that % 0U !=
+             (usart1->control1 &
+              bit_value(0U).set<control_reg::receive_enable>().get()));
+    };
+
+  "uart::autobaud times the stop bit after a start bit"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    stub_out_registers timer_stub(&timer1_reg);
+    std::array<hal::byte, 64> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    gpio_a_reg->idr = 1UL << 10U;
+    simulated_capture_clock clock;
+    // A start bit of 833 ticks at 9600 baud on an 8 MHz timer, the timer
+    // counts 100 ticks per tick of the clock
+    clock.m_edges = { 1'000, 1'833, 0, 0, 0 };
+    clock.m_counts_per_tick = 100;
+
+    // Exercise
+    auto const detected =
+      driver.autobaud(clock, uart_autobaud_pattern::start_bit);
+
+    // Verify
+    expect(detected.has_value());
+    expect(that % 833U == usart1->baud_rate);
+    expect(that % 0U !=
+           (usart1->control1 &
+            bit_value(0U).set<control_reg::receive_enable>().get()));
+    // Half a bit into the stop bit, 1'000 + 9.5 * 833 timer ticks, rather
+    // than after 10 bit times of idle line
+    expect(that % 100U > clock.m_ticks);
+    expect(that % 0U == timer1_reg->CR1);
+  };
+
+  "uart::autobaud refuses a timer in use by another driver"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    stub_out_registers timer_stub(&timer1_reg);
+    std::array<hal::byte, 64> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    auto const running =
+      bit_value(0U).set<timer_control::counter_enable>().to<std::uint32_t>();
+    timer1_reg->CR1 = running;
+    timer1_reg->ARR = 1'234;
+    simulated_capture_clock clock;
+
+    // Exercise
+    auto const detected = driver.autobaud(clock);
+
+    // Verify
+    expect(not detected.has_value());
+    expect(that % running == timer1_reg->CR1);
+    expect(that % 1'234U == timer1_reg->ARR);
+    expect(that % 0U == clock.m_ticks);
+  };
+}
+}  // namespace hal::stm32f1
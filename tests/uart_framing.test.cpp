@@ -0,0 +1,156 @@
+#include <libhal-stm32f1/uart_framing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <boost/ut.hpp>
+
+#include "dma.hpp"
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "uart_reg.hpp"
+
+namespace hal::stm32f1 {
+void uart_framing_test()
+{
+  using namespace boost::ut;
+
+  "crc16_ccitt matches the check value"_test = []() {
+    // Setup
+    constexpr std::array<hal::byte, 9> digits{ '1', '2', '3', '4', '5',
+                                               '6', '7', '8', '9' };
+
+    // Exercise + Verify
+    expect(that % 0x29B1 == crc16_ccitt(digits));
+  };
+
+  "cobs frames survive being split at every byte"_test = []() {
+    // Setup
+    std::array<hal::byte, 300> payload{};
+    for (std::size_t i = 0; i < payload.size(); i++) {
+      // Zeros at irregular distances and a run longer than a COBS block
+      payload[i] = (i % 37 == 0 && i < 200) ? 0 : static_cast<hal::byte>(i);
+    }
+    std::array<hal::byte, max_cobs_frame_size(payload.size())> encoded{};
+    std::array<hal::byte, 320> destination{};
+    auto const frame = cobs_encode(payload, encoded);
+
+    for (std::size_t split = 0; split < frame.size(); split++) {
+      cobs_decoder decoder(destination);
+
+      // Exercise
+      auto const first = decoder.decode(frame.first(split));
+      auto const second = decoder.decode(frame.subspan(split));
+      auto const result = decoder.take_frame();
+
+      // Verify
+      expect(that % split == first);
+      expect(frame.size() - split == second);
+      expect(result.has_value());
+      expect(result->crc_valid);
+      expect(std::ranges::equal(payload, result->payload()));
+    }
+    expect(that % 0 == std::count(frame.begin(), frame.end() - 1, 0));
+  };
+
+  "slip frames survive being split at every byte"_test = []() {
+    // Setup
+    constexpr std::array<hal::byte, 6> payload{ 0x01, 0xC0, 0xDB,
+                                                0xDC, 0xDD, 0xC0 };
+    std::array<hal::byte, max_slip_frame_size(payload.size())> encoded{};
+    std::array<hal::byte, 16> destination{};
+    auto const frame = slip_encode(payload, encoded);
+
+    for (std::size_t split = 0; split < frame.size(); split++) {
+      slip_decoder decoder(destination);
+
+      // Exercise
+      (void)decoder.decode(frame.first(split));
+      (void)decoder.decode(frame.subspan(split));
+      auto const result = decoder.take_frame();
+
+      // Verify
+      expect(result.has_value());
+      expect(result->crc_valid);
+      expect(std::ranges::equal(payload, result->payload()));
+    }
+  };
+
+  "decoders flag frames that are corrupt or too long"_test = []() {
+    // Setup
+    constexpr std::array<hal::byte, 4> payload{ 1, 2, 3, 4 };
+    std::array<hal::byte, 16> encoded{};
+    auto const frame = cobs_encode(payload, encoded);
+    std::array<hal::byte, 16> copy{};
+    std::ranges::copy(frame, copy.begin());
+    copy[2] ^= 0x40;
+    std::array<hal::byte, 16> destination{};
+    std::array<hal::byte, 3> small{};
+    // The block announces 4 data bytes, only 2 arrive
+    constexpr std::array<hal::byte, 4> truncated{ 0x05, 0x01, 0x02, 0x00 };
+    cobs_decoder corrupt_decoder(destination);
+    cobs_decoder small_decoder(small);
+    cobs_decoder truncated_decoder(destination);
+
+    // Exercise
+    (void)corrupt_decoder.decode(std::span(copy).first(frame.size()));
+    (void)small_decoder.decode(frame);
+    (void)truncated_decoder.decode(truncated);
+    auto const corrupt = corrupt_decoder.take_frame();
+    auto const too_long = small_decoder.take_frame();
+    auto const cut = truncated_decoder.take_frame();
+
+    // Verify
+    expect(corrupt.has_value());
+    expect(not corrupt->crc_valid);
+    expect(not corrupt->error);
+    expect(too_long.has_value());
+    expect(too_long->error);
+    expect(that % 3U == too_long->data.size());
+    expect(cut.has_value());
+    expect(cut->error);
+  };
+
+  "read_frame decodes across the wrap of the receive buffer"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma::dma1);
+    stub_out_registers usart_stub(&usart1);
+    std::array<hal::byte, 32> buffer{};
+    uart driver(hal::runtime{}, 1, buffer);
+    // USART1 RX uses DMA1 channel 5
+    auto& channel = dma::dma1->channel[5 - 1];
+    constexpr std::array<hal::byte, 8> payload{ 9, 0, 8, 0, 7, 6, 5, 4 };
+    std::array<hal::byte, max_cobs_frame_size(payload.size())> encoded{};
+    auto const frame = cobs_encode(payload, encoded);
+    std::array<hal::byte, 16> destination{};
+    cobs_decoder decoder(destination);
+
+    // Let the DMA write the frame so that it wraps 4 bytes before its end
+    auto const start = buffer.size() - (frame.size() - 4);
+    channel.transfer_amount = static_cast<std::uint32_t>(buffer.size() - start);
+    driver.consume(start);
+    for (std::size_t i = 0; i < frame.size(); i++) {
+      buffer[(start + i) % buffer.size()] = frame[i];
+    }
+    channel.transfer_amount = static_cast<std::uint32_t>(buffer.size() - 4);
+
+    // Exercise
+    auto const result = read_frame(driver, decoder);
+    auto const next = read_frame(driver, decoder);
+
+    // Verify
+    expect(result.has_value());
+    expect(result->crc_valid);
+    expect(std::ranges::equal(payload, result->payload()));
+    expect(not next.has_value());
+    expect(driver.receive_view()[0].empty());
+  };
+}
+}  // namespace hal::stm32f1
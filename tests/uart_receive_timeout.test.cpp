@@ -0,0 +1,120 @@
+#include <libhal-stm32f1/uart_receive_timeout.hpp>
+
+#include <cstdint>
+#include <system_error>
+
+#include <boost/ut.hpp>
+#include <libhal-stm32f1/clock.hpp>
+
+#include "helper.hpp"
+#include "pin.hpp"
+#include "rcc_reg.hpp"
+#include "timer_reg.hpp"
+
+namespace hal::stm32f1 {
+void uart_receive_timeout_test()
+{
+  using namespace boost::ut;
+
+  "uart_receive_timeout resets the timer on falling edges"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers gpio_b_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer4_reg);
+    uart_receive_timeout timeout;
+    uart_receive_timeout_settings const settings{
+      .baud_rate = 100'000.0f,
+      .silence_bits = 30,
+      .character_bits = 10,
+    };
+
+    // Exercise
+    auto const status = timeout.try_start(settings, {});
+    auto const timer_frequency =
+      static_cast<std::uint64_t>(frequency(peripheral::timer4));
+    // 40 bit times at 100 kBd
+    auto const cycles = (timer_frequency * 400U) / 1'000'000U;
+    auto const period = (timer4_reg->PSC + 1U) * (timer4_reg->ARR + 1U);
+    // PB7 is in the lower configuration register, 4 bits per pin
+    auto const pin_config = (gpio_b_reg->crl >> (7U * 4U)) & 0xFU;
+
+    // Verify
+    expect(that % std::errc{} == status);
+    // Reset mode triggered by the filtered input of channel 2
+    expect(that % 0b110'0'100U == (timer4_reg->SMCR & 0x77U));
+    // Channel 2 as input, falling edges
+    expect(that % 0b01U == ((timer4_reg->CCMR1 >> 8U) & 0b11U));
+    expect(that % (1U << 5U) == timer4_reg->CCER);
+    expect(that % bit_value(0U).set<timer_interrupt_enable::trigger>().get() ==
+           timer4_reg->DIER);
+    expect(that % bit_value(0U)
+                    .set<timer_control::counter_enable>()
+                    .set<timer_control::update_request_source>()
+                    .get() == timer4_reg->CR1);
+    // Within one prescaled tick of the exact period
+    expect(period <= cycles);
+    expect(cycles - period <= timer4_reg->PSC);
+    // Input with pull-up, selected by setting the output data bit
+    expect(that % 0b1000U == pin_config);
+    expect(that % (1U << 7U) == gpio_b_reg->bsrr);
+  };
+
+  "uart_receive_timeout completes a message once per silence"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers gpio_b_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer4_reg);
+    uart_receive_timeout timeout;
+    int calls = 0;
+    auto const update_interrupt =
+      bit_value(0U).set<timer_interrupt_enable::update>().get();
+    auto const trigger_interrupt =
+      bit_value(0U).set<timer_interrupt_enable::trigger>().get();
+    (void)timeout.try_start({}, [&calls]() { calls++; });
+
+    // Exercise
+    timeout.line_active();
+    auto const receiving = timer4_reg->DIER;
+    timeout.silence_elapsed();
+    auto const idle = timer4_reg->DIER;
+    timeout.line_active();
+    timeout.silence_elapsed();
+    timeout.stop();
+    timeout.silence_elapsed();
+
+    // Verify
+    expect(that % update_interrupt == receiving);
+    expect(that % trigger_interrupt == idle);
+    expect(that % 2 == calls);
+    expect(that % 2U == timeout.completed());
+    expect(that % 0U == timer4_reg->DIER);
+  };
+
+  "uart_receive_timeout rejects unusable timers"_test = []() {
+    // Setup
+    stub_out_registers rcc_stub(&rcc);
+    stub_out_registers gpio_a_stub(&gpio_a_reg);
+    stub_out_registers timer_stub(&timer3_reg);
+    uart_receive_timeout first;
+    uart_receive_timeout second;
+    uart_receive_timeout unused;
+
+    // Exercise
+    auto const started = first.try_start({ .timer = peripheral::timer3 }, {});
+    auto const busy = second.try_start({ .timer = peripheral::timer3 }, {});
+    auto const advanced_timer =
+      unused.try_start({ .timer = peripheral::timer1 }, {});
+    auto const channel3 =
+      unused.try_start({ .timer = peripheral::timer3, .channel = 3 }, {});
+    auto const no_baud_rate = unused.try_start(
+      { .baud_rate = 0.0f, .timer = peripheral::timer2, .channel = 1 }, {});
+
+    // Verify
+    expect(that % std::errc{} == started);
+    expect(that % std::errc::device_or_resource_busy == busy);
+    expect(that % std::errc::argument_out_of_domain == advanced_timer);
+    expect(that % std::errc::argument_out_of_domain == channel3);
+    expect(that % std::errc::operation_not_supported == no_baud_rate);
+  };
+}
+}  // namespace hal::stm32f1
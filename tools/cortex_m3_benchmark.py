@@ -0,0 +1,258 @@
+#!/usr/bin/python
+#
+# Copyright 2024 Khalil Estell
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Count the Cortex-M3 instructions and memory accesses of each stm32f1
+driver operation by executing a demo ELF on the unicorn CPU emulator.
+
+Peripheral registers are plain memory with just enough behavior stubbed in
+(ready flags, acknowledge bits, empty transmit registers) for the drivers to
+make progress. Counts are inclusive of callees. Execution stops at the first
+`bkpt` instruction or after --max-instructions.
+
+Usage:
+    pip install -r tools/requirements.txt
+    python tools/cortex_m3_benchmark.py build/stm32f103c8/MinSizeRel/\\
+        driver_benchmark.elf [--baseline old.json]
+"""
+
+import argparse
+import json
+import sys
+from dataclasses import dataclass, field
+
+from elftools.elf.elffile import ELFFile
+from unicorn import (UC_ARCH_ARM, UC_HOOK_CODE, UC_HOOK_MEM_READ,
+                     UC_HOOK_MEM_WRITE, UC_MEM_READ, UC_MODE_MCLASS,
+                     UC_MODE_THUMB, Uc)
+from unicorn.arm_const import (UC_ARM_REG_LR, UC_ARM_REG_SP,
+                               UC_CPU_ARM_CORTEX_M3)
+
+import driver_sizes
+
+FLASH_BASE = 0x0800_0000
+FLASH_SIZE = 1024 * 1024
+SRAM_BASE = 0x2000_0000
+SRAM_SIZE = 128 * 1024
+PERIPHERAL_BASE = 0x4000_0000
+PERIPHERAL_SIZE = 0x3_0000
+SYSTEM_BASE = 0xE000_0000
+SYSTEM_SIZE = 0x10_0000
+
+RCC = 0x4002_1000
+CAN1 = 0x4000_6400
+USARTS = (0x4001_3800, 0x4000_4400, 0x4000_4800, 0x4000_4C00, 0x4000_5000)
+DWT_CYCCNT = 0xE000_1004
+
+BKPT_OPCODE = 0xBE
+
+
+def bit(value, position):
+    return (value >> position) & 1
+
+
+def copy_bit(value, source, source_position, destination_position):
+    value &= ~(1 << destination_position)
+    return value | (bit(source, source_position) << destination_position)
+
+
+@dataclass
+class Frame:
+    name: str
+    return_address: int
+    instructions: int = 0
+    loads: int = 0
+    stores: int = 0
+    peripheral_accesses: int = 0
+
+
+@dataclass
+class Operation:
+    calls: int = 0
+    instructions: int = 0
+    loads: int = 0
+    stores: int = 0
+    peripheral_accesses: int = 0
+
+
+@dataclass
+class Emulator:
+    functions: dict
+    total_instructions: int = 0
+    stack: list = field(default_factory=list)
+    operations: dict = field(default_factory=dict)
+
+    def read_word(self, uc, address):
+        return int.from_bytes(uc.mem_read(address, 4), "little")
+
+    def write_word(self, uc, address, value):
+        uc.mem_write(address, (value & 0xFFFF_FFFF).to_bytes(4, "little"))
+
+    def emulate_register(self, uc, address):
+        """Patch a register right before it is read to emulate hardware."""
+        value = self.read_word(uc, address)
+
+        if address == RCC + 0x00:  # CR: HSIRDY, HSERDY, PLLRDY
+            value = copy_bit(value, value, 0, 1)
+            value = copy_bit(value, value, 16, 17)
+            value = copy_bit(value, value, 24, 25)
+        elif address == RCC + 0x04:  # CFGR: SWS follows SW
+            value = (value & ~0b1100) | ((value & 0b11) << 2)
+        elif address == RCC + 0x20:  # BDCR: LSERDY
+            value = copy_bit(value, value, 0, 1)
+        elif address == CAN1 + 0x04:  # MSR: INAK/SLAK follow INRQ/SLEEP
+            master_control = self.read_word(uc, CAN1)
+            value = copy_bit(value, master_control, 0, 0)
+            value = copy_bit(value, master_control, 1, 1)
+        elif address == CAN1 + 0x08:  # TSR: frames are sent instantly
+            value |= 0b111 << 26
+        elif address in USARTS:  # SR: TXE and TC
+            value |= (1 << 7) | (1 << 6)
+        elif address == DWT_CYCCNT:  # approximate a CPI of 1
+            value = self.total_instructions
+        else:
+            return
+
+        self.write_word(uc, address, value)
+
+    def on_code(self, uc, address, size, _):
+        self.total_instructions += 1
+
+        while self.stack and self.stack[-1].return_address == address:
+            self.retire(self.stack.pop())
+
+        name = self.functions.get(address)
+        if name:
+            return_address = uc.reg_read(UC_ARM_REG_LR) & ~1
+            self.stack.append(Frame(name, return_address))
+
+        for frame in self.stack:
+            frame.instructions += 1
+
+        if size == 2 and uc.mem_read(address + 1, 1)[0] == BKPT_OPCODE:
+            uc.emu_stop()
+
+    def on_memory(self, uc, access, address, size, value, _):
+        is_peripheral = PERIPHERAL_BASE <= address < SYSTEM_BASE + SYSTEM_SIZE
+        if access == UC_MEM_READ and is_peripheral:
+            self.emulate_register(uc, address & ~0b11)
+
+        for frame in self.stack:
+            if access == UC_MEM_READ:
+                frame.loads += 1
+            else:
+                frame.stores += 1
+            if is_peripheral:
+                frame.peripheral_accesses += 1
+
+    def retire(self, frame):
+        operation = self.operations.setdefault(frame.name, Operation())
+        operation.calls += 1
+        operation.instructions += frame.instructions
+        operation.loads += frame.loads
+        operation.stores += frame.stores
+        operation.peripheral_accesses += frame.peripheral_accesses
+
+
+def load_elf(uc, path):
+    with open(path, "rb") as elf_file:
+        elf = ELFFile(elf_file)
+        for segment in elf.iter_segments():
+            if segment["p_type"] != "PT_LOAD" or segment["p_filesz"] == 0:
+                continue
+            # Load at the physical (flash) address, startup code copies .data
+            uc.mem_write(segment["p_paddr"], segment.data())
+
+
+def stm32f1_functions(elf, nm):
+    functions = {}
+    for name, section, address, _, _ in driver_sizes.read_symbols(elf, nm):
+        if section == "text" and "hal::stm32f1::" in name:
+            # Remove the thumb bit
+            functions[address & ~1] = name.split("(")[0]
+    return functions
+
+
+def run(elf, nm, max_instructions):
+    uc = Uc(UC_ARCH_ARM, UC_MODE_THUMB | UC_MODE_MCLASS)
+    uc.ctl_set_cpu_model(UC_CPU_ARM_CORTEX_M3)
+
+    for base, size in ((FLASH_BASE, FLASH_SIZE), (SRAM_BASE, SRAM_SIZE),
+                       (PERIPHERAL_BASE, PERIPHERAL_SIZE),
+                       (SYSTEM_BASE, SYSTEM_SIZE)):
+        uc.mem_map(base, size)
+
+    load_elf(uc, elf)
+
+    emulator = Emulator(functions=stm32f1_functions(elf, nm))
+    uc.hook_add(UC_HOOK_CODE, emulator.on_code)
+    uc.hook_add(UC_HOOK_MEM_READ | UC_HOOK_MEM_WRITE, emulator.on_memory)
+
+    initial_stack = emulator.read_word(uc, FLASH_BASE)
+    reset_handler = emulator.read_word(uc, FLASH_BASE + 4)
+    uc.reg_write(UC_ARM_REG_SP, initial_stack)
+    uc.emu_start(reset_handler | 1, 0xFFFF_FFFF, count=max_instructions)
+
+    return emulator
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="demo application ELF file")
+    parser.add_argument("--nm", default="arm-none-eabi-nm",
+                        help="nm executable to use")
+    parser.add_argument("--baseline",
+                        help="previous JSON output to compute deltas against")
+    parser.add_argument("--max-instructions", type=int, default=50_000_000,
+                        help="stop after this many instructions")
+    args = parser.parse_args()
+
+    emulator = run(args.elf, args.nm, args.max_instructions)
+
+    operations = []
+    for name, operation in sorted(emulator.operations.items(),
+                                  key=lambda item: -item[1].instructions):
+        operations.append({
+            "name": name,
+            "calls": operation.calls,
+            "instructions": operation.instructions,
+            "instructions_per_call": operation.instructions / operation.calls,
+            "loads": operation.loads,
+            "stores": operation.stores,
+            "peripheral_accesses": operation.peripheral_accesses,
+        })
+
+    sizes = driver_sizes.driver_sizes(args.elf, args.nm)
+    for entry in sizes.values():
+        del entry["symbols"]
+
+    report = {
+        "elf": args.elf,
+        "instructions": emulator.total_instructions,
+        "operations": operations,
+        "drivers": sizes,
+    }
+
+    if args.baseline:
+        with open(args.baseline) as baseline_file:
+            baseline = json.load(baseline_file)
+        report["deltas"] = driver_sizes.deltas(sizes, baseline["drivers"])
+
+    json.dump(report, sys.stdout, indent=2)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
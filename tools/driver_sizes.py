@@ -0,0 +1,227 @@
+#!/usr/bin/python
+#
+# Copyright 2024 Khalil Estell
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Attribute the flash and RAM usage of an ELF to each stm32f1 driver.
+
+Symbols are attributed to a driver by the source file they were defined in
+(requires debug info, e.g. -g), falling back to the demangled symbol name.
+Every symbol of hal::stm32f1 that cannot be placed is reported as "other".
+Soft-float and exception runtime support is reported as the "soft-float" and
+"exceptions" entries.
+
+Usage:
+    python tools/driver_sizes.py app.elf [--baseline old.json] [--nm NM]
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+# nm symbol type -> output section class
+SECTION_OF_TYPE = {
+    "t": "text",
+    "w": "text",
+    "r": "rodata",
+    "d": "data",
+    "b": "bss",
+}
+
+SECTIONS = ("text", "rodata", "data", "bss")
+
+# Source files of the library, each one is considered a driver
+DRIVER_SOURCES = ("async", "can", "can_autobaud", "can_schedule",
+                  "can_statistics", "clock", "dma", "input_pin", "interrupt",
+                  "io_multiplexer", "iso_tp", "matrix_scanner", "modbus",
+                  "one_wire", "output_pin", "pin", "power", "timer", "uart",
+                  "uart_autobaud", "uart_framing", "uart_receive",
+                  "uart_receive_timeout")
+
+# Fallback when no debug info is available: free functions and objects that
+# live outside of a driver class, matched by name.
+NAME_TO_DRIVER = [
+    (re.compile(r"\bcan1_reg\b|can_receive_\w+|can_transmit_\w+|"
+                r"read_\w*receive_mailbox|read_transmit_result|"
+                r"transmit_interrupt|status_change_interrupt|"
+                r"receive_line_event"),
+     "can"),
+    (re.compile(r"edge_capture|next_edge|capture_timer|current_tick|"
+                r"uart_rx_capture_channel"),
+     "uart_autobaud"),
+    (re.compile(r"\busart\d\b|\buart\d\b|\buart_(?!receive_timeout)\w+|"
+                r"complete_write"),
+     "uart"),
+    (re.compile(r"detect_baud_rate|listen_at|wait_for_initialization"),
+     "can_autobaud"),
+    (re.compile(r"async_event|async_executor|task_promise|event_list|"
+                r"frame_arena"), "async"),
+    (re.compile(r"\bexti_"), "input_pin"),
+    (re.compile(r"iso_tp"), "iso_tp"),
+    (re.compile(r"can_statistics"), "can_statistics"),
+    (re.compile(r"can_schedule|can_cyclic_frame|schedule_interrupt"),
+     "can_schedule"),
+    (re.compile(r"cobs_\w+|slip_\w+|read_frame|crc16_ccitt"),
+     "uart_framing"),
+    (re.compile(r"modbus|server_timer|running_server"), "modbus"),
+    (re.compile(r"io_multiplexer"), "io_multiplexer"),
+    (re.compile(r"one_wire|crc8_maxim"), "one_wire"),
+    (re.compile(r"receive_timeout|running_timeout"), "uart_receive_timeout"),
+    (re.compile(r"matrix_|scan_dma_channels|scan_resources|running_scanner"),
+     "matrix_scanner"),
+    (re.compile(r"\bdma1\b|claimed_channels|(claim|release)_channel"),
+     "dma"),
+    (re.compile(r"\btimer\d_reg\b|general_purpose_timer|periodic_timer|"
+                r"(claim|release)_timer|claimed_timers"),
+     "timer"),
+    (re.compile(r"configure_clocks|frequency|maximum_speed|clock_rate|"
+                r"stop_mode"),
+     "clock"),
+    (re.compile(r"power_on|power_off|is_on"), "power"),
+    (re.compile(r"configure_pin|remap_pins|gpio|jtag|mco"), "pin"),
+    (re.compile(r"initialize_interrupts"), "interrupt"),
+]
+
+# Toolchain runtime support pulled in by the drivers, reported next to the
+# drivers so that e.g. removing float math from a driver shows up in reports.
+RUNTIME_SUPPORT = [
+    (re.compile(r"^__aeabi_(f|d|[ui]2[fd]|[fd]2)|^__(add|sub|mul|div)[sd]f3|"
+                r"^__(fix|float)\w*[sd]f|^__(eq|ne|lt|le|gt|ge|un)[sd]f2|"
+                r"^__(extend|trunc)\w*f2|^(round|floor|ceil)f?$|^roundf"),
+     "soft-float"),
+    (re.compile(r"^__cxa_|^_Unwind_|^__gxx_personality|^__aeabi_unwind|"
+                r"^__gnu_unwind|^__cxxabiv1|^typeinfo |^vtable for __cxxabiv1|"
+                r"^hal::__except_abi|^__exidx"),
+     "exceptions"),
+]
+
+NM_LINE = re.compile(
+    r"^(?P<address>[0-9a-fA-F]+)\s+(?P<size>[0-9a-fA-F]+)\s+"
+    r"(?P<type>\w)\s+(?P<name>[^\t]+)(\t(?P<location>.+))?$")
+
+
+def driver_of(name, location):
+    """Returns the driver a symbol belongs to or None if not an stm32f1
+    symbol."""
+    if "hal::stm32f1::" not in name:
+        for pattern, runtime in RUNTIME_SUPPORT:
+            if pattern.search(name):
+                return runtime
+        return None
+
+    if location:
+        source = location.rsplit(":", 1)[0]
+        stem = os.path.splitext(os.path.basename(source))[0]
+        if stem in DRIVER_SOURCES:
+            return stem
+
+    scoped = name.split("hal::stm32f1::", 1)[1]
+    scoped = scoped.replace("(anonymous namespace)::", "")
+    owner = scoped.split("(")[0].split("::")[0]
+    if owner in DRIVER_SOURCES and "::" in scoped.split("(")[0]:
+        return owner
+
+    for pattern, driver in NAME_TO_DRIVER:
+        if pattern.search(scoped):
+            return driver
+    return "other"
+
+
+def read_symbols(elf, nm="arm-none-eabi-nm"):
+    """Yields (name, section, address, size, location) for each sized
+    symbol."""
+    output = subprocess.run(
+        [nm, "--demangle", "--print-size", "--line-numbers",
+         "--defined-only", elf],
+        check=True, capture_output=True, text=True).stdout
+
+    for line in output.splitlines():
+        match = NM_LINE.match(line)
+        if not match:
+            continue
+        section = SECTION_OF_TYPE.get(match["type"].lower())
+        if section is None:
+            continue
+        yield (match["name"], section, int(match["address"], 16),
+               int(match["size"], 16), match["location"])
+
+
+def driver_sizes(elf, nm="arm-none-eabi-nm"):
+    """Returns {driver: {text, rodata, data, bss, flash, ram, symbols}}."""
+    drivers = {}
+    for name, section, _, size, location in read_symbols(elf, nm):
+        driver = driver_of(name, location)
+        if driver is None:
+            continue
+        entry = drivers.setdefault(driver, {
+            **{section: 0 for section in SECTIONS},
+            "symbols": {},
+        })
+        entry[section] += size
+        symbol = entry["symbols"].setdefault(
+            name, {section: 0 for section in SECTIONS})
+        symbol[section] += size
+
+    for entry in drivers.values():
+        # .data occupies flash for its initial values and RAM at runtime
+        entry["flash"] = entry["text"] + entry["rodata"] + entry["data"]
+        entry["ram"] = entry["data"] + entry["bss"]
+
+    return drivers
+
+
+def deltas(current, baseline):
+    """Returns {driver: {flash, ram}} differences between two reports."""
+    result = {}
+    for driver in sorted(set(current) | set(baseline)):
+        now = current.get(driver, {})
+        then = baseline.get(driver, {})
+        result[driver] = {
+            key: now.get(key, 0) - then.get(key, 0) for key in ("flash", "ram")
+        }
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="linked application ELF file")
+    parser.add_argument("--nm", default="arm-none-eabi-nm",
+                        help="nm executable to use")
+    parser.add_argument("--baseline",
+                        help="previous JSON output to compute deltas against")
+    parser.add_argument("--symbols", action="store_true",
+                        help="include a per symbol breakdown")
+    args = parser.parse_args()
+
+    sizes = driver_sizes(args.elf, args.nm)
+    if not args.symbols:
+        for entry in sizes.values():
+            del entry["symbols"]
+
+    report = {"elf": args.elf, "drivers": sizes}
+
+    if args.baseline:
+        with open(args.baseline) as baseline_file:
+            baseline = json.load(baseline_file)
+        report["deltas"] = deltas(sizes, baseline["drivers"])
+
+    json.dump(report, sys.stdout, indent=2)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,118 @@
+#!/usr/bin/python
+#
+# Copyright 2024 Khalil Estell
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Report the .text/.rodata/.data/.bss of each stm32f1 driver within each
+demo application and fail if a size budget is exceeded.
+
+The budgets file maps a platform name (or "default") to per driver limits:
+
+    {
+      "default": { "uart": { "flash": 1536, "ram": 16 } },
+      "stm32f103c4": { "soft-float": { "flash": 0 } }
+    }
+
+Platform entries are merged on top of the "default" entry. Drivers without a
+budget are reported but never fail the check.
+
+Usage:
+    python tools/size_report.py --budgets demos/size_budgets.json \\
+        --platform stm32f103c8 blinker.elf uart.elf can.elf
+"""
+
+import argparse
+import json
+import os
+import sys
+
+import driver_sizes
+
+COLUMNS = ("text", "rodata", "data", "bss", "flash", "ram")
+
+
+def load_budgets(path, platform):
+    with open(path) as budgets_file:
+        budgets = json.load(budgets_file)
+
+    merged = {}
+    for key in ("default", platform):
+        for driver, limits in budgets.get(key, {}).items():
+            merged.setdefault(driver, {}).update(limits)
+    return merged
+
+
+def check(application, sizes, budgets):
+    """Returns a list of budget violation messages."""
+    violations = []
+    for driver, limits in budgets.items():
+        for kind, limit in limits.items():
+            used = sizes.get(driver, {}).get(kind, 0)
+            if used > limit:
+                violations.append(
+                    f"{application}: {driver} {kind} is {used} bytes, "
+                    f"budget is {limit} bytes (+{used - limit})")
+    return violations
+
+
+def print_table(application, sizes):
+    print(f"\n{application}")
+    print(f"  {'driver':<12}" + "".join(f"{c:>9}" for c in COLUMNS))
+    for driver in sorted(sizes):
+        row = "".join(f"{sizes[driver][c]:>9}" for c in COLUMNS)
+        print(f"  {driver:<12}{row}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elfs", nargs="+", help="demo application ELF files")
+    parser.add_argument("--budgets", required=True,
+                        help="JSON file with the size budgets")
+    parser.add_argument("--platform", default="default",
+                        help="platform name used to select budgets")
+    parser.add_argument("--nm", default="arm-none-eabi-nm",
+                        help="nm executable to use")
+    parser.add_argument("--json", help="also write the report to this file")
+    args = parser.parse_args()
+
+    budgets = load_budgets(args.budgets, args.platform)
+    report = {"platform": args.platform, "applications": {}}
+    violations = []
+
+    for elf in args.elfs:
+        application = os.path.splitext(os.path.basename(elf))[0]
+        sizes = driver_sizes.driver_sizes(elf, args.nm)
+        for entry in sizes.values():
+            del entry["symbols"]
+
+        report["applications"][application] = sizes
+        print_table(application, sizes)
+        violations += check(application, sizes, budgets)
+
+    if args.json:
+        with open(args.json, "w") as json_file:
+            json.dump(report, json_file, indent=2)
+
+    if violations:
+        print("\nSize budget exceeded:", file=sys.stderr)
+        for violation in violations:
+            print(f"  {violation}", file=sys.stderr)
+        return 1
+
+    print(f"\nAll drivers within the {args.platform} size budget.")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())